@@ -13,25 +13,25 @@ TEMPLATE = app
 SOURCES += main.cpp\
         widget.cpp \
     rfidWidget/IEEE14443ControlWidget.cpp \
-    rfidWidget/IEEE1443Package.cpp \
     rfidWidget/ioportmanager.cpp \
     rfidWidget/xbytearray.cpp \
     rfidWidget/qhexedit_p.cpp \
     rfidWidget/qhexedit.cpp \
     rfidWidget/commands.cpp \
-    rfidWidget/qextserialbase.cpp \
-    rfidWidget/posix_qextserialport.cpp
+    rfidWidget/NotificationBar.cpp \
+    rfidWidget/ParkingTableModel.cpp
 
 HEADERS  += widget.h \
     rfidWidget/IEEE14443ControlWidget.h \
-    rfidWidget/IEEE1443Package.h \
     rfidWidget/ioportManager.h \
     rfidWidget/xbytearray.h \
     rfidWidget/qhexedit_p.h \
     rfidWidget/qhexedit.h \
     rfidWidget/commands.h \
-    rfidWidget/qextserialbase.h \
-    rfidWidget/posix_qextserialport.h
+    rfidWidget/NotificationBar.h \
+    rfidWidget/ParkingTableModel.h
+
+include(rfidWidget/readersession.pri)
 
 FORMS    += widget.ui \
     rfidWidget/IEEE14443ControlWidget.ui
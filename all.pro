@@ -0,0 +1,20 @@
+#-------------------------------------------------
+#
+# 整个工程：界面程序、读卡器会话静态库、无界面闸口程序、读卡器模拟器、收发记录回放和全部基准
+#   qmake all.pro && make
+# 只编界面程序时仍可直接用 RFID_ParkingSystemV2.pro
+#
+#-------------------------------------------------
+
+TEMPLATE = subdirs
+
+SUBDIRS += app \
+    readersession \
+    headless \
+    emulator \
+    replay \
+    benchmarks
+
+# 界面程序的 .pro 和本文件在同一目录，各用各的 Makefile
+app.file = RFID_ParkingSystemV2.pro
+app.makefile = Makefile.app
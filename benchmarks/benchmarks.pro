@@ -0,0 +1,18 @@
+#-------------------------------------------------
+#
+# 全部基准程序，每个子目录一个独立的可执行文件
+#
+#-------------------------------------------------
+
+TEMPLATE = subdirs
+
+SUBDIRS += protocol \
+    framedecoder \
+    prebuiltframe \
+    rxlatency \
+    gatelatency \
+    scheduler \
+    cardtable \
+    journal \
+    tariff \
+    frametrace
@@ -0,0 +1,22 @@
+#-------------------------------------------------
+#
+# 停车记录索引基准：四个 QMap<QString, ...> vs CardUid + CardTable
+#
+#-------------------------------------------------
+
+QT       += core
+QT       -= gui
+
+TARGET = cardtable
+CONFIG   += console
+CONFIG   -= app_bundle
+TEMPLATE = app
+
+INCLUDEPATH += ../..
+
+SOURCES += main.cpp \
+    ../../rfidWidget/CardTable.cpp
+
+HEADERS += ../../rfidWidget/CardUid.h \
+    ../../rfidWidget/CardTable.h \
+    ../../rfidWidget/TagInfo.h
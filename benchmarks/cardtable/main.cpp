@@ -0,0 +1,216 @@
+// 停车记录索引基准
+// 为 N 张卡（随机4字节UID）建立停车记录，比较两种存法：
+//   qmap  —— 原实现：十六进制 QString 卡号做键，入场/历史入场/历史出场/在场信息四个 QMap
+//   table —— CardUid（quint64）做键，一张卡一条记录的开放寻址表 CardTable
+// 分别测：全部入场（插入）、按卡号查在场（命中）、查未登记卡号（未命中）的平均耗时，
+// 以及建表前后堆内存的增量（glibc mallinfo）。
+// 查找都从十六进制字符串开始，把 CardUid::fromHex 的转换也算在内。先打印机器信息，引用结果时一起给出。
+//
+// 构建运行：qmake && make && ./cardtable [卡数] [查找轮数]
+
+#include <QByteArray>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QList>
+#include <QMap>
+#include <QString>
+#include <malloc.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/utsname.h>
+#include <unistd.h>
+#include <rfidWidget/CardUid.h>
+#include <rfidWidget/CardTable.h>
+
+struct Result
+{
+    qint64 insertNs;
+    qint64 hitNs;
+    qint64 missNs;
+    qint64 heapBytes;
+    int found;
+};
+
+static qint64 heapInUse()
+{
+    struct mallinfo mi = mallinfo();
+    return (qint64)(unsigned int)mi.uordblks + (qint64)(unsigned int)mi.hblkhd;
+}
+
+static QString randomUid()
+{
+    QByteArray b(4, 0);
+    for(int i = 0; i < 4; i++)
+        b[i] = (char)(rand() & 0xFF);
+    return QString(b.toHex());
+}
+
+static TagInfo sampleInfo(int i)
+{
+    TagInfo info;
+    info.owner = QString("OWNER%1").arg(i % 1000);
+    info.vehicleType = "Sedan";
+    info.balance = i;
+    info.valid = true;
+    return info;
+}
+
+// 原实现：四个 QMap
+struct MapStore
+{
+    QMap<QString, QDateTime> entryTimeMap;
+    QMap<QString, QDateTime> lastEntryTimeMap;
+    QMap<QString, QDateTime> lastExitTimeMap;
+    QMap<QString, TagInfo> activeInfoMap;
+};
+
+static Result runMaps(const QList<QString> &ids, const QList<QString> &misses, int rounds)
+{
+    Result res;
+    res.found = 0;
+    qint64 heap0 = heapInUse();
+    MapStore *s = new MapStore;
+    QDateTime now = QDateTime::currentDateTime();
+    QElapsedTimer t;
+
+    t.start();
+    for(int i = 0; i < ids.size(); i++)
+    {
+        s->entryTimeMap.insert(ids.at(i), now);
+        s->activeInfoMap.insert(ids.at(i), sampleInfo(i));
+        s->lastEntryTimeMap.insert(ids.at(i), now);
+        s->lastExitTimeMap.insert(ids.at(i), now);
+    }
+    res.insertNs = t.nsecsElapsed() / ids.size();
+    res.heapBytes = heapInUse() - heap0;
+
+    t.start();
+    for(int r = 0; r < rounds; r++)
+        for(int i = 0; i < ids.size(); i++)
+            res.found += s->entryTimeMap.contains(ids.at(i)) ? 1 : 0;
+    res.hitNs = t.nsecsElapsed() / ((qint64)rounds * ids.size());
+
+    t.start();
+    for(int r = 0; r < rounds; r++)
+        for(int i = 0; i < misses.size(); i++)
+            res.found += s->entryTimeMap.contains(misses.at(i)) ? 1 : 0;
+    res.missNs = t.nsecsElapsed() / ((qint64)rounds * misses.size());
+
+    delete s;
+    return res;
+}
+
+static Result runTable(const QList<QString> &ids, const QList<QString> &misses, int rounds)
+{
+    Result res;
+    res.found = 0;
+    qint64 heap0 = heapInUse();
+    CardTable *table = new CardTable;
+    qint64 nowMs = QDateTime::currentDateTime().toMSecsSinceEpoch();
+    QElapsedTimer t;
+
+    t.start();
+    for(int i = 0; i < ids.size(); i++)
+    {
+        CardTable::Record &rec = table->insert(CardUid::fromHex(ids.at(i)));
+        rec.entryMs = nowMs;
+        rec.lastEntryMs = nowMs;
+        rec.lastExitMs = nowMs;
+        rec.info = sampleInfo(i);
+    }
+    res.insertNs = t.nsecsElapsed() / ids.size();
+    res.heapBytes = heapInUse() - heap0;
+
+    t.start();
+    for(int r = 0; r < rounds; r++)
+        for(int i = 0; i < ids.size(); i++)
+        {
+            const CardTable::Record *rec = table->find(CardUid::fromHex(ids.at(i)));
+            res.found += (rec && rec->isParked()) ? 1 : 0;
+        }
+    res.hitNs = t.nsecsElapsed() / ((qint64)rounds * ids.size());
+
+    t.start();
+    for(int r = 0; r < rounds; r++)
+        for(int i = 0; i < misses.size(); i++)
+        {
+            const CardTable::Record *rec = table->find(CardUid::fromHex(misses.at(i)));
+            res.found += (rec && rec->isParked()) ? 1 : 0;
+        }
+    res.missNs = t.nsecsElapsed() / ((qint64)rounds * misses.size());
+
+    delete table;
+    return res;
+}
+
+static void report(const char *name, const Result &res, int cards)
+{
+    printf("%-6s insert %6lld ns  hit %6lld ns  miss %6lld ns  heap %8.2f MB (%lld B/card)\n",
+           name, (long long)res.insertNs, (long long)res.hitNs, (long long)res.missNs,
+           res.heapBytes / (1024.0 * 1024.0), (long long)(res.heapBytes / cards));
+}
+
+// 功能：打印机器信息（CPU 型号、内核、核数），引用结果时连同机器一起给出。
+static void printMachine()
+{
+    char cpu[256] = "unknown";
+    FILE *f = fopen("/proc/cpuinfo", "r");
+    if(f)
+    {
+        char line[256];
+        while(fgets(line, sizeof(line), f))
+        {
+            const char *colon = strchr(line, ':');
+            if(strncmp(line, "model name", 10) == 0 && colon)
+            {
+                snprintf(cpu, sizeof(cpu), "%s", colon + 2);
+                cpu[strcspn(cpu, "\n")] = '\0';
+                break;
+            }
+        }
+        fclose(f);
+    }
+    struct utsname u;
+    if(uname(&u) != 0)
+        memset(&u, 0, sizeof(u));
+    printf("machine: %s, %s %s %s, %ld cpus\n", cpu, u.sysname, u.release, u.machine, sysconf(_SC_NPROCESSORS_ONLN));
+}
+
+int main(int argc, char *argv[])
+{
+    int cards = argc > 1 ? atoi(argv[1]) : 50000;
+    int rounds = argc > 2 ? atoi(argv[2]) : 20;
+    if(cards <= 0)
+        cards = 50000;
+    if(rounds <= 0)
+        rounds = 20;
+    srand(14443);
+
+    //卡号和未登记卡号事先生成好，两种实现用同一组字符串
+    QList<QString> ids;
+    QList<QString> misses;
+    for(int i = 0; i < cards; i++)
+        ids.append(randomUid());
+    for(int i = 0; i < cards; i++)
+        misses.append(randomUid());
+    printMachine();
+    printf("cards: %d, lookup rounds: %d\n", cards, rounds);
+
+    Result maps = runMaps(ids, misses, rounds);
+    Result table = runTable(ids, misses, rounds);
+    report("qmap", maps, cards);
+    report("table", table, cards);
+    //随机卡号可能重复或撞上“未登记”卡号，两种实现只要结果一致即可
+    if(maps.found != table.found)
+    {
+        fprintf(stderr, "lookup results differ: qmap %d, table %d\n", maps.found, table.found);
+        return 1;
+    }
+    printf("speedup  insert %.2fx  hit %.2fx  miss %.2fx  memory %.2fx\n",
+           (double)maps.insertNs / qMax<qint64>(1, table.insertNs),
+           (double)maps.hitNs / qMax<qint64>(1, table.hitNs),
+           (double)maps.missNs / qMax<qint64>(1, table.missNs),
+           (double)maps.heapBytes / qMax<qint64>(1, table.heapBytes));
+    return 0;
+}
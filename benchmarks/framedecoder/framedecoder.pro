@@ -0,0 +1,24 @@
+#-------------------------------------------------
+#
+# 拆帧吞吐基准：逐字节recvStatus循环 vs FrameDecoder
+#
+#-------------------------------------------------
+
+QT       += core
+QT       -= gui
+
+TARGET = framedecoder
+CONFIG   += console
+CONFIG   -= app_bundle
+TEMPLATE = app
+
+INCLUDEPATH += ../..
+
+SOURCES += main.cpp \
+    ../../rfidWidget/IEEE1443Package.cpp \
+    ../../rfidWidget/FrameDecoder.cpp \
+    ../../rfidWidget/EscapeKernel.cpp
+
+HEADERS += ../../rfidWidget/IEEE1443Package.h \
+    ../../rfidWidget/FrameDecoder.h \
+    ../../rfidWidget/EscapeKernel.h
@@ -0,0 +1,216 @@
+// 拆帧吞吐基准
+// 生成一段模拟读卡器回包的字节流（寻卡/防冲突/选卡/认证/读块/写块混合，读块数据随机、含转义），
+// 按每次64字节（接近一次tty read）喂给：
+//   legacy  —— 原 onPortDataReady 的 recvStatus 逐字节 append + 拷贝整帧 + IEEE1443Package(QByteArray)
+//   decoder —— FrameDecoder 帧视图 + IEEE1443Package(const quint8 *, int)
+// 输出 MB/s 与每秒帧数。
+//
+// 构建运行：qmake && make && ./framedecoder [流大小MB] [轮数]
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QList>
+#include <stdio.h>
+#include <stdlib.h>
+#include <rfidWidget/IEEE1443Package.h>
+#include <rfidWidget/FrameDecoder.h>
+
+static const int kChunk = 64;
+
+// 功能：构造读卡器回包（长度不含同步尾）。
+static QByteArray buildReply(quint8 cmd, const QByteArray &data)
+{
+    QByteArray content;
+    content.append((char)0x00);
+    content.append((char)0x00);
+    content.append((char)(data.size() + 2));
+    content.append((char)cmd);
+    content.append(data);
+    quint8 chksum = 0;
+    for(int i = 0; i < content.size(); i++)
+        chksum += (quint8)content.at(i);
+    content.append((char)chksum);
+    QByteArray raw;
+    raw.append(IEEE1443_START_CODE);
+    raw.append(IEEE1443Package::getRawPackage(content));
+    raw.append(IEEE1443_STOP_CODE);
+    return raw;
+}
+
+static QByteArray randomBytes(int n)
+{
+    QByteArray b(n, 0);
+    for(int i = 0; i < n; i++)
+        b[i] = (char)(rand() & 0xFF);
+    return b;
+}
+
+// 功能：按一次刷卡的回包比例生成字节流。
+static QByteArray buildStream(int targetSize, int &frameCount)
+{
+    QByteArray stream;
+    stream.reserve(targetSize + 64);
+    frameCount = 0;
+    while(stream.size() < targetSize)
+    {
+        stream.append(buildReply(IEEE1443Package::SearchCard, QByteArray::fromHex("000400")));
+        stream.append(buildReply(IEEE1443Package::AntiColl, QByteArray(1, 0) + randomBytes(4)));
+        stream.append(buildReply(IEEE1443Package::SelectCard, QByteArray::fromHex("0008")));
+        stream.append(buildReply(IEEE1443Package::Authentication, QByteArray(1, 0)));
+        stream.append(buildReply(IEEE1443Package::ReadCard, QByteArray(1, 0) + randomBytes(16)));
+        stream.append(buildReply(IEEE1443Package::ReadCard, QByteArray(1, 0) + randomBytes(16)));
+        stream.append(buildReply(IEEE1443Package::WriteCard, QByteArray(1, 0)));
+        frameCount += 7;
+    }
+    return stream;
+}
+
+// 原实现：逐字节状态机
+class LegacyDecoder
+{
+public:
+    LegacyDecoder() : recvStatus(0), frames(0), checksum(0) {}
+
+    void feed(const char *p, int len)
+    {
+        while(len--)
+        {
+            switch(recvStatus)
+            {
+            case 0:
+                if(*p == 0x02)
+                {
+                    recvStatus = 1;
+                    lastRecvPackage.clear();
+                    lastRecvPackage.append(*p);
+                }
+                p++;
+                break;
+            case 1:
+                if(*p == 0x10)
+                    recvStatus = 2;
+                else if(*p == 0x03)
+                {
+                    lastRecvPackage.append(*p);
+                    onRecvedPackage(QByteArray(lastRecvPackage.constData(), lastRecvPackage.size()));
+                    recvStatus = 0;
+                }
+                else
+                    lastRecvPackage.append(*p);
+                p++;
+                break;
+            case 2:
+                lastRecvPackage.append(*p++);
+                recvStatus = 1;
+                break;
+            }
+        }
+    }
+
+    int recvStatus;
+    QByteArray lastRecvPackage;
+    int frames;
+    quint32 checksum;
+
+private:
+    // 排队信号会拷贝一份QByteArray，这里用显式拷贝模拟
+    void onRecvedPackage(QByteArray pkg)
+    {
+        IEEE1443Package p(pkg);
+        if(p.isValid())
+        {
+            frames++;
+            checksum += p.command() + p.dataLen();
+        }
+    }
+};
+
+struct Result
+{
+    qint64 nsecs;
+    int frames;
+    quint32 checksum;
+};
+
+static Result runLegacy(const QByteArray &stream, int rounds)
+{
+    LegacyDecoder d;
+    QElapsedTimer t;
+    t.start();
+    for(int r = 0; r < rounds; r++)
+    {
+        for(int off = 0; off < stream.size(); off += kChunk)
+            d.feed(stream.constData() + off, qMin(kChunk, stream.size() - off));
+    }
+    Result res;
+    res.nsecs = t.nsecsElapsed();
+    res.frames = d.frames;
+    res.checksum = d.checksum;
+    return res;
+}
+
+static Result runDecoder(const QByteArray &stream, int rounds)
+{
+    FrameDecoder d;
+    Result res;
+    res.frames = 0;
+    res.checksum = 0;
+    QElapsedTimer t;
+    t.start();
+    for(int r = 0; r < rounds; r++)
+    {
+        for(int off = 0; off < stream.size(); off += kChunk)
+        {
+            d.push(stream.constData() + off, qMin(kChunk, stream.size() - off));
+            FrameDecoder::Frame f;
+            while(d.next(f))
+            {
+                IEEE1443Package p(f.data, f.size);
+                if(p.isValid())
+                {
+                    res.frames++;
+                    res.checksum += p.command() + p.dataLen();
+                }
+            }
+        }
+    }
+    res.nsecs = t.nsecsElapsed();
+    return res;
+}
+
+static void report(const char *name, const Result &res, qint64 bytes)
+{
+    double secs = res.nsecs / 1e9;
+    printf("%-8s %8.1f MB/s  %8.2f Mframes/s  %6.1f ns/frame  (frames=%d sum=%u)\n",
+           name, bytes / secs / (1024.0 * 1024.0), res.frames / secs / 1e6,
+           (double)res.nsecs / res.frames, res.frames, res.checksum);
+}
+
+int main(int argc, char *argv[])
+{
+    int mb = argc > 1 ? atoi(argv[1]) : 8;
+    int rounds = argc > 2 ? atoi(argv[2]) : 5;
+    if(mb <= 0)
+        mb = 8;
+    if(rounds <= 0)
+        rounds = 5;
+    srand(14443);
+
+    int frameCount = 0;
+    QByteArray stream = buildStream(mb * 1024 * 1024, frameCount);
+    printf("stream: %d bytes, %d frames, %d rounds, %d-byte reads\n",
+           stream.size(), frameCount, rounds, kChunk);
+
+    qint64 bytes = (qint64)stream.size() * rounds;
+    Result legacy = runLegacy(stream, rounds);
+    Result decoder = runDecoder(stream, rounds);
+    report("legacy", legacy, bytes);
+    report("decoder", decoder, bytes);
+    if(legacy.frames != decoder.frames || legacy.checksum != decoder.checksum)
+    {
+        fprintf(stderr, "decoder output differs from legacy loop\n");
+        return 1;
+    }
+    printf("speedup  %.2fx\n", (double)legacy.nsecs / decoder.nsecs);
+    return 0;
+}
@@ -0,0 +1,20 @@
+#-------------------------------------------------
+#
+# 逐帧日志开销基准：qDebug 时间串 + 十六进制 vs FrameTrace 定长记录
+#
+#-------------------------------------------------
+
+QT       += core
+QT       -= gui
+
+TARGET = frametrace
+CONFIG   += console
+CONFIG   -= app_bundle
+TEMPLATE = app
+
+INCLUDEPATH += ../..
+
+SOURCES += main.cpp \
+    ../../rfidWidget/FrameTrace.cpp
+
+HEADERS += ../../rfidWidget/FrameTrace.h
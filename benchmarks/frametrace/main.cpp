@@ -0,0 +1,89 @@
+// 逐帧日志开销基准
+// 一次刷卡的7个发送帧和7个回包帧轮流“记日志”：
+//   qdebug —— 原 dispatchNext()/commandReplied() 的写法：QDateTime 时间串 + toHex + qDebug
+//             （消息处理函数直接丢弃，只算格式化，不算终端输出，是原写法开销的下限）
+//   trace  —— FrameTrace::record()：单调时钟 + 定长槽位拷贝
+// 输出每帧纳秒数；最后把环导出到临时文件，给出导出耗时（只在按需/出错时发生）。
+//
+// 构建运行：qmake && make && ./frametrace [帧数]
+
+#include <QCoreApplication>
+#include <QByteArray>
+#include <QDateTime>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QList>
+#include <QString>
+#include <stdio.h>
+#include <stdlib.h>
+#include <rfidWidget/FrameTrace.h>
+
+static void discardMessage(QtMsgType, const char *)
+{
+}
+
+static QByteArray randomFrame(int n)
+{
+    QByteArray b(n, 0);
+    b[0] = 0x02;
+    for(int i = 1; i < n - 1; i++)
+        b[i] = (char)(rand() & 0xFF);
+    b[n - 1] = 0x03;
+    return b;
+}
+
+int main(int argc, char *argv[])
+{
+    int count = argc > 1 ? atoi(argv[1]) : 200000;
+    if(count <= 0)
+        count = 200000;
+    srand(14443);
+
+    //1.一次刷卡的帧长：寻卡、防冲突、选卡、认证、读块×2、写块，发送和回包各7帧
+    const int sizes[] = { 8, 8, 11, 15, 8, 8, 26, 10, 13, 9, 8, 24, 24, 8 };
+    QList<QByteArray> frames;
+    for(int i = 0; i < 14; i++)
+        frames.append(randomFrame(sizes[i]));
+
+    //2.原写法
+    qInstallMsgHandler(discardMessage);
+    QElapsedTimer t;
+    t.start();
+    for(int i = 0; i < count; i++)
+    {
+        const QByteArray &f = frames.at(i % frames.size());
+        qDebug() << QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss")
+                 << QString("send %1").arg(QString(f.toHex()));
+    }
+    qint64 debugNs = t.nsecsElapsed();
+    qInstallMsgHandler(0);
+
+    //3.定长记录
+    FrameTrace trace;
+    t.start();
+    for(int i = 0; i < count; i++)
+    {
+        const QByteArray &f = frames.at(i % frames.size());
+        trace.record((i % frames.size()) < 7 ? FrameTrace::Tx : FrameTrace::Rx, f.constData(), f.size());
+    }
+    qint64 traceNs = t.nsecsElapsed();
+
+    printf("frames: %d\n", count);
+    printf("qdebug %8.1f ns/frame\n", (double)debugNs / count);
+    printf("trace  %8.1f ns/frame\n", (double)traceNs / count);
+    printf("speedup %.1fx\n", (double)debugNs / qMax<qint64>(1, traceNs));
+
+    //4.导出整个环
+    QString path = QString("/tmp/frametrace-%1.trace").arg(QCoreApplication::applicationPid());
+    t.start();
+    QString error;
+    if(!trace.dump(path, "benchmark", &error))
+    {
+        fprintf(stderr, "dump: %s\n", error.toLocal8Bit().constData());
+        return 1;
+    }
+    printf("dump   %8.2f ms for %d records\n", t.nsecsElapsed() / 1e6, trace.entries().size());
+    QFile::remove(path);
+    return 0;
+}
@@ -0,0 +1,17 @@
+#-------------------------------------------------
+#
+# 刷卡到闸口判定的端到端延迟：伪终端读卡器替身 + 真实 ReaderSession，分阶段 p50/p95/p99
+#
+#-------------------------------------------------
+
+QT       += core
+QT       -= gui
+
+TARGET = gatelatency
+CONFIG   += console
+CONFIG   -= app_bundle
+TEMPLATE = app
+
+SOURCES += main.cpp
+
+include(../../rfidWidget/readersession.pri)
@@ -0,0 +1,433 @@
+// 刷卡到闸口判定的端到端延迟基准
+// 伪终端一端是内置的读卡器替身（收发线程里按协议应答，卡片可“放上”“拿走”，写块真正改卡内容），
+// 另一端是真实的 ReaderSession（收发线程、命令调度、自动寻卡、寻卡链、卡内容缓存）
+// 加上与无界面闸口相同的进出场判定（ParkingStore + Tariff）。
+// 每次刷卡：放卡 -> 自动寻卡识别 -> 读块 -> 判定（入场记录；出场扣费写两块、写成功记出场）-> 拿走卡，
+// 若干张卡轮流刷，每张卡入场、出场交替。
+// 输出每个阶段（寻卡、防冲突、选卡、认证、读块、写块：上一阶段完成到本阶段回包处理完）
+// 和整次刷卡（放卡到判定）的 p50/p95/p99。
+//
+// 构建运行：qmake && make && ./gatelatency [刷卡次数] [卡数]
+
+#include <QCoreApplication>
+#include <QAtomicInt>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QThread>
+#include <QTimer>
+#include <QVector>
+#include <QtAlgorithms>
+#include <stdio.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+#include <rfidWidget/IEEE1443Package.h>
+#include <rfidWidget/FrameDecoder.h>
+#include <rfidWidget/ReaderSession.h>
+#include <rfidWidget/ParkingStore.h>
+#include <rfidWidget/TagInfo.h>
+#include <rfidWidget/Tariff.h>
+
+//一次刷卡没有进展超过这个时间就算失败，拿走卡继续下一次
+static const int kTapTimeoutMs = 3000;
+
+// 会话的调试日志（空回包等）基准里丢掉，警告照常打印
+static void quietHandler(QtMsgType type, const char *msg)
+{
+    if(type != QtDebugMsg)
+        fprintf(stderr, "%s\n", msg);
+}
+
+// 功能：构造读卡器回包（长度不含同步尾）。
+static QByteArray buildReply(quint8 cmd, const QByteArray &data)
+{
+    QByteArray content;
+    content.append((char)0x00);
+    content.append((char)0x00);
+    content.append((char)(data.size() + 2));
+    content.append((char)cmd);
+    content.append(data);
+    quint8 chksum = 0;
+    for(int i = 0; i < content.size(); i++)
+        chksum += (quint8)content.at(i);
+    content.append((char)chksum);
+    QByteArray raw;
+    raw.append(IEEE1443_START_CODE);
+    raw.append(IEEE1443Package::getRawPackage(content));
+    raw.append(IEEE1443_STOP_CODE);
+    return raw;
+}
+
+
+// === 读卡器替身 ===
+// 在伪终端主端按协议应答；放上的卡由主线程经 place()/removeCard() 切换。
+class ReaderStandIn : public QThread
+{
+public:
+    struct Card
+    {
+        QByteArray uid;
+        QByteArray blocks[4];
+    };
+
+    ReaderStandIn(int fd, const QVector<Card> &cards) :
+        masterFd(fd), cards(cards), present(-1), stopRequested(false) {}
+
+    void place(int card) {
+        present = card;
+    }
+    void removeCard() {
+        present = -1;
+    }
+    void requestStop() {
+        stopRequested = true;
+    }
+
+protected:
+    void run()
+    {
+        FrameDecoder decoder;
+        FrameDecoder::Frame f;
+        char buf[256];
+        while(!stopRequested)
+        {
+            struct pollfd pfd;
+            pfd.fd = masterFd;
+            pfd.events = POLLIN;
+            pfd.revents = 0;
+            if(::poll(&pfd, 1, 50) <= 0)
+                continue;
+            int n = ::read(masterFd, buf, sizeof(buf));
+            if(n <= 0)
+                continue;
+            decoder.push(buf, n);
+            while(decoder.next(f))
+                answer(IEEE1443Package(f.data, f.size));
+        }
+    }
+
+private:
+    // 功能：状态 0 成功；无卡时寻卡回 1，其余命令回 1。
+    void answer(const IEEE1443Package &pkg)
+    {
+        if(!pkg.isValid())
+            return;
+        int card = present;
+        QByteArray data;
+        if(card < 0)
+        {
+            data.append((char)0x01);
+        }
+        else
+        {
+            Card &c = cards[card];
+            data.append((char)0x00);
+            switch(pkg.command())
+            {
+            case IEEE1443Package::SearchCard:
+                data.append(QByteArray::fromHex("0400"));
+                break;
+            case IEEE1443Package::AntiColl:
+                data.append(c.uid);
+                break;
+            case IEEE1443Package::SelectCard:
+                data.append((char)0x08);
+                break;
+            case IEEE1443Package::ReadCard:
+                data.append(c.blocks[(quint8)pkg.data().at(0) & 3]);
+                break;
+            case IEEE1443Package::WriteCard:
+                c.blocks[(quint8)pkg.data().at(0) & 3] = pkg.data().mid(1, 16);
+                break;
+            default:
+                break;
+            }
+        }
+        QByteArray raw = buildReply(pkg.command(), data);
+        ssize_t w = ::write(masterFd, raw.constData(), raw.size());
+        (void)w;
+    }
+
+    int masterFd;
+    QVector<Card> cards;// 只在本线程里读写
+    QAtomicInt present;
+    volatile bool stopRequested;
+};
+
+
+// === 闸口侧 ===
+// 与无界面闸口相同的判定，外加分阶段计时。
+class GateBench : public QObject
+{
+    Q_OBJECT
+
+public:
+    GateBench(ReaderSession *s, ReaderStandIn *r, int taps, int cards) :
+        failures(0), session(s), reader(r), tapsLeft(taps), cardCount(cards), nextCard(0),
+        tapActive(false), closing(false), writing(false), removing(false)
+    {
+        connect(session, SIGNAL(commandCompleted(quint8,quint8,QByteArray)),
+                this, SLOT(onCommandCompleted(quint8,quint8,QByteArray)));
+        connect(session, SIGNAL(cardRead(QString,QByteArray,QByteArray)),
+                this, SLOT(onCardRead(QString,QByteArray,QByteArray)));
+        connect(session, SIGNAL(writeFinished(bool)), this, SLOT(onWriteFinished(bool)));
+        connect(session, SIGNAL(commandFailed(quint8)), this, SLOT(onCommandFailed(quint8)));
+        connect(session, SIGNAL(cardLost()), this, SLOT(onCardLost()));
+        watchdog.setSingleShot(true);
+        connect(&watchdog, SIGNAL(timeout()), this, SLOT(onTapTimeout()));
+        clock.start();
+    }
+
+    QHash<int, QVector<qint64> > phases;// 命令码 -> 各次耗时（纳秒）
+    QVector<qint64> totals;
+    QVector<qint64> entries;
+    QVector<qint64> exits;
+    int failures;
+
+public slots:
+    // 功能：放上下一张卡，开始计时。
+    void beginTap()
+    {
+        if(tapsLeft <= 0)
+        {
+            QCoreApplication::instance()->quit();
+            return;
+        }
+        tapsLeft--;
+        tapActive = true;
+        writing = false;
+        tapStartNs = clock.nsecsElapsed();
+        lastMarkNs = tapStartNs;
+        reader->place(nextCard);
+        nextCard = (nextCard + 1) % cardCount;
+        watchdog.start(kTapTimeoutMs);
+    }
+
+private slots:
+    // cardRead()/writeFinished() 在同一条回包的 commandCompleted() 之前发出，
+    // 判定完成后紧跟的这一条仍算本次刷卡的最后一个阶段
+    void onCommandCompleted(quint8 command, quint8 status, const QByteArray &)
+    {
+        if((!tapActive && !closing) || status != 0)
+            return;
+        closing = false;
+        qint64 now = clock.nsecsElapsed();
+        phases[command].append(now - lastMarkNs);
+        lastMarkNs = now;
+    }
+
+    void onCardRead(const QString &cardId, const QByteArray &block1, const QByteArray &block2)
+    {
+        if(!tapActive || writing)
+            return;
+        TagInfo info;
+        if(!decodeTagInfo(block1, block2, info))
+        {
+            abortTap();
+            return;
+        }
+        QDateTime now = QDateTime::currentDateTime();
+        //在场——出场：扣费写卡，写成功才算判定完成
+        if(store.isParked(cardId))
+        {
+            info.balance -= tariff.fee(store.entryTime(cardId), now, info.vehicleType);
+            QByteArray b1;
+            QByteArray b2;
+            encodeTagInfo(info, b1, b2);
+            writingCardId = cardId;
+            writing = true;
+            if(!session->writeUserBlocks(b1, b2))
+                onWriteFinished(false);
+            return;
+        }
+        //不在场——入场
+        store.recordEntry(cardId, now, info);
+        finishTap(cardId, &entries);
+    }
+
+    void onWriteFinished(bool ok)
+    {
+        if(!tapActive || !writing)
+            return;
+        if(!ok)
+        {
+            abortTap();
+            return;
+        }
+        store.recordExit(writingCardId, QDateTime::currentDateTime());
+        finishTap(writingCardId, &exits);
+    }
+
+    void onCommandFailed(quint8 command)
+    {
+        if(tapActive && command != IEEE1443Package::SearchCard)
+            abortTap();
+    }
+
+    void onTapTimeout()
+    {
+        if(tapActive)
+            abortTap();
+    }
+
+    // 卡拿走后（寻卡无卡）开始下一次
+    void onCardLost()
+    {
+        if(!tapActive && removing)
+        {
+            removing = false;
+            QTimer::singleShot(0, this, SLOT(beginTap()));
+        }
+    }
+
+private:
+    void finishTap(const QString &cardId, QVector<qint64> *kind)
+    {
+        qint64 ns = clock.nsecsElapsed() - tapStartNs;
+        totals.append(ns);
+        kind->append(ns);
+        session->setAwaitingRemoval(cardId);
+        endTap();
+        closing = true;
+    }
+
+    void abortTap()
+    {
+        failures++;
+        endTap();
+    }
+
+    void endTap()
+    {
+        watchdog.stop();
+        tapActive = false;
+        closing = false;
+        writing = false;
+        writingCardId.clear();
+        removing = true;
+        reader->removeCard();
+    }
+
+    ReaderSession *session;
+    ReaderStandIn *reader;
+    ParkingStore store;
+    Tariff tariff;
+    int tapsLeft;
+    int cardCount;
+    int nextCard;
+    bool tapActive;
+    bool closing;//判定刚完成，还差本条回包的 commandCompleted()
+    bool writing;
+    bool removing;//卡已拿走，等寻卡无卡后开始下一次
+    QString writingCardId;
+    QElapsedTimer clock;
+    qint64 tapStartNs;
+    qint64 lastMarkNs;
+    QTimer watchdog;
+};
+
+// 功能：打印一组耗时的分位数（毫秒）。
+static void report(const char *name, QVector<qint64> samples)
+{
+    if(samples.isEmpty())
+    {
+        printf("%-9s %7d\n", name, 0);
+        return;
+    }
+    qSort(samples);
+    qint64 sum = 0;
+    for(int i = 0; i < samples.size(); i++)
+        sum += samples.at(i);
+    int n = samples.size();
+    printf("%-9s %7d %9.3f %9.3f %9.3f %9.3f %9.3f\n", name, n,
+           sum / 1e6 / n,
+           samples.at(n / 2) / 1e6,
+           samples.at(qMin(n - 1, n * 95 / 100)) / 1e6,
+           samples.at(qMin(n - 1, n * 99 / 100)) / 1e6,
+           samples.at(n - 1) / 1e6);
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    qInstallMsgHandler(quietHandler);
+    int taps = argc > 1 ? atoi(argv[1]) : 2000;
+    int cardCount = argc > 2 ? atoi(argv[2]) : 16;
+    if(taps <= 0)
+        taps = 2000;
+    if(cardCount <= 0)
+        cardCount = 16;
+
+    //1.伪终端
+    int masterFd = ::posix_openpt(O_RDWR | O_NOCTTY);
+    if(masterFd < 0 || ::grantpt(masterFd) != 0 || ::unlockpt(masterFd) != 0)
+    {
+        perror("posix_openpt");
+        return 1;
+    }
+    struct termios tio;
+    ::tcgetattr(masterFd, &tio);
+    ::cfmakeraw(&tio);
+    ::tcsetattr(masterFd, TCSANOW, &tio);
+    QString slaveName = QString::fromLocal8Bit(::ptsname(masterFd));
+
+    //2.已注册的卡，余额足够出场扣费
+    QVector<ReaderStandIn::Card> cards(cardCount);
+    for(int i = 0; i < cardCount; i++)
+    {
+        TagInfo info;
+        info.owner = QString("BENCH%1").arg(i);
+        info.vehicleType = "Sedan";
+        info.balance = 1000000;
+        info.valid = true;
+        cards[i].uid = QByteArray::fromHex("c0de0000");
+        cards[i].uid[2] = (char)(i >> 8);
+        cards[i].uid[3] = (char)i;
+        for(int b = 0; b < 4; b++)
+            cards[i].blocks[b] = QByteArray(16, 0);
+        encodeTagInfo(info, cards[i].blocks[1], cards[i].blocks[2]);
+    }
+    ReaderStandIn reader(masterFd, cards);
+    reader.start();
+
+    //3.真实会话：自适应寻卡，有卡后按下限连续寻卡
+    ReaderSession session;
+    if(!session.open(slaveName))
+    {
+        fprintf(stderr, "failed to open %s\n", qPrintable(slaveName));
+        reader.requestStop();
+        reader.wait();
+        return 1;
+    }
+    session.setAutoSearchCadence(0, 1000);
+    GateBench bench(&session, &reader, taps, cardCount);
+    session.startAutoSearch();
+    QTimer::singleShot(0, &bench, SLOT(beginTap()));
+    QElapsedTimer wall;
+    wall.start();
+    app.exec();
+    qint64 wallMs = wall.elapsed();
+
+    session.close();
+    reader.requestStop();
+    reader.wait();
+    ::close(masterFd);
+
+    //4.报告
+    printf("taps: %d, cards: %d, failures: %d, wall %.1f s\n", taps, cardCount, bench.failures, wallMs / 1000.0);
+    printf("%-9s %7s %9s %9s %9s %9s %9s   (ms)\n", "phase", "n", "mean", "p50", "p95", "p99", "max");
+    report("search", bench.phases.value(IEEE1443Package::SearchCard));
+    report("anticoll", bench.phases.value(IEEE1443Package::AntiColl));
+    report("select", bench.phases.value(IEEE1443Package::SelectCard));
+    report("auth", bench.phases.value(IEEE1443Package::Authentication));
+    report("read", bench.phases.value(IEEE1443Package::ReadCard));
+    report("write", bench.phases.value(IEEE1443Package::WriteCard));
+    report("entry", bench.entries);
+    report("exit", bench.exits);
+    report("total", bench.totals);
+    return 0;
+}
+
+#include "main.moc"
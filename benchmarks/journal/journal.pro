@@ -0,0 +1,27 @@
+#-------------------------------------------------
+#
+# 停车记录预写日志基准：追加对进出场判定的额外耗时、组提交批量、重放速度
+#
+#-------------------------------------------------
+
+QT       += core
+QT       -= gui
+
+TARGET = journal
+CONFIG   += console
+CONFIG   -= app_bundle
+TEMPLATE = app
+
+INCLUDEPATH += ../..
+
+SOURCES += main.cpp \
+    ../../rfidWidget/TagInfo.cpp \
+    ../../rfidWidget/CardTable.cpp \
+    ../../rfidWidget/ParkingStore.cpp \
+    ../../rfidWidget/ParkingJournal.cpp
+
+HEADERS += ../../rfidWidget/TagInfo.h \
+    ../../rfidWidget/CardUid.h \
+    ../../rfidWidget/CardTable.h \
+    ../../rfidWidget/ParkingStore.h \
+    ../../rfidWidget/ParkingJournal.h
@@ -0,0 +1,164 @@
+// 停车记录预写日志基准
+// 按“入场-出场”交替为一批卡号生成进出场事件，写入 ParkingStore：
+//   memory  —— 不开日志，只更新内存中的表（原实现）
+//   journal —— 打开预写日志，每次更新在锁内追加事件，写盘线程组提交
+// 比较两者每次 recordEntry/recordExit 的平均/最大耗时（闸口判定路径上多出来的时间），
+// 输出 fdatasync 次数和最大批量；然后用新的 ParkingStore 重放整个日志，输出重放耗时，
+// 并核对重放后在场车辆与原表一致。先打印机器信息，引用结果时一起给出。
+//
+// 构建运行：qmake && make && ./journal [事件数] [卡数] [日志路径]
+
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QString>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/utsname.h>
+#include <unistd.h>
+#include <rfidWidget/ParkingStore.h>
+#include <rfidWidget/ParkingJournal.h>
+
+struct Result
+{
+    qint64 nsecsTotal;
+    qint64 nsecsMax;
+    int events;
+};
+
+// 功能：对 store 依次做 events 次进出场，统计每次调用的耗时。
+static Result run(ParkingStore &store, int events, int cards)
+{
+    TagInfo info;
+    info.owner = "BENCH";
+    info.vehicleType = "Sedan";
+    info.balance = 1000;
+    info.valid = true;
+    QDateTime base = QDateTime::currentDateTime();
+
+    Result res;
+    res.nsecsTotal = 0;
+    res.nsecsMax = 0;
+    res.events = events;
+    QElapsedTimer t;
+    for(int i = 0; i < events; i++)
+    {
+        QString cardId = QString("%1").arg(i % cards, 8, 16, QChar('0'));
+        QDateTime now = base.addSecs(i);
+        t.start();
+        if(store.isParked(cardId))
+            store.recordExit(cardId, now);
+        else
+            store.recordEntry(cardId, now, info);
+        qint64 ns = t.nsecsElapsed();
+        res.nsecsTotal += ns;
+        if(ns > res.nsecsMax)
+            res.nsecsMax = ns;
+    }
+    return res;
+}
+
+static void report(const char *name, const Result &res)
+{
+    printf("%-8s %8.0f ns/event  max %8.1f us  (events=%d)\n",
+           name, (double)res.nsecsTotal / res.events, res.nsecsMax / 1000.0, res.events);
+}
+
+// 功能：打印机器信息（CPU 型号、内核、核数），引用结果时连同机器一起给出。
+static void printMachine()
+{
+    char cpu[256] = "unknown";
+    FILE *f = fopen("/proc/cpuinfo", "r");
+    if(f)
+    {
+        char line[256];
+        while(fgets(line, sizeof(line), f))
+        {
+            const char *colon = strchr(line, ':');
+            if(strncmp(line, "model name", 10) == 0 && colon)
+            {
+                snprintf(cpu, sizeof(cpu), "%s", colon + 2);
+                cpu[strcspn(cpu, "\n")] = '\0';
+                break;
+            }
+        }
+        fclose(f);
+    }
+    struct utsname u;
+    if(uname(&u) != 0)
+        memset(&u, 0, sizeof(u));
+    printf("machine: %s, %s %s %s, %ld cpus\n", cpu, u.sysname, u.release, u.machine, sysconf(_SC_NPROCESSORS_ONLN));
+}
+
+int main(int argc, char *argv[])
+{
+    int events = argc > 1 ? atoi(argv[1]) : 1000000;
+    int cards = argc > 2 ? atoi(argv[2]) : 5000;
+    QString path = argc > 3 ? QString::fromLocal8Bit(argv[3]) : QString("/tmp/rfid-journal-bench.journal");
+    if(events <= 0)
+        events = 1000000;
+    if(cards <= 0)
+        cards = 5000;
+    QFile::remove(path);
+    printMachine();
+    printf("events: %d, cards: %d, journal: %s\n", events, cards, path.toLocal8Bit().constData());
+
+    //1.只有内存表
+    ParkingStore memory;
+    Result mem = run(memory, events, cards);
+    report("memory", mem);
+
+    //2.打开日志
+    ParkingStore journaled;
+    if(journaled.openJournal(path) < 0)
+    {
+        fprintf(stderr, "cannot open journal %s\n", path.toLocal8Bit().constData());
+        return 1;
+    }
+    Result jr = run(journaled, events, cards);
+    report("journal", jr);
+    QElapsedTimer flushTimer;
+    flushTimer.start();
+    bool durable = journaled.journal()->flush();
+    ParkingJournal::Stats js = journaled.journal()->stats();
+    if(!durable)
+    {
+        fprintf(stderr, "journal write failed, errno %d\n", js.lastError);
+        return 1;
+    }
+    printf("flush    %8lld ms  commits=%u  maxBatch=%u  bytes=%lld  (%.1f events/commit)\n",
+           (long long)flushTimer.elapsed(), js.commits, js.maxBatch, (long long)js.bytes,
+           js.commits ? (double)js.appended / js.commits : 0.0);
+    journaled.closeJournal();
+
+    //3.重放
+    ParkingStore restored;
+    QElapsedTimer replayTimer;
+    replayTimer.start();
+    qint64 replayed = restored.openJournal(path);
+    qint64 replayMs = replayTimer.elapsed();
+    restored.closeJournal();
+    printf("replay   %8lld ms  events=%lld  (%.2f Mevents/s)\n",
+           (long long)replayMs, (long long)replayed,
+           replayMs ? replayed / (replayMs / 1000.0) / 1e6 : 0.0);
+
+    //4.核对
+    QList<ParkingStore::ParkedVehicle> a = journaled.parkedVehicles();
+    QList<ParkingStore::ParkedVehicle> b = restored.parkedVehicles();
+    bool same = (replayed == events && a.size() == b.size());
+    for(int i = 0; same && i < a.size(); i++)
+    {
+        same = a.at(i).cardId == b.at(i).cardId &&
+               a.at(i).entryTime.toMSecsSinceEpoch() == b.at(i).entryTime.toMSecsSinceEpoch() &&
+               a.at(i).info.balance == b.at(i).info.balance;
+    }
+    if(!same)
+    {
+        fprintf(stderr, "replayed state differs from the journaled store\n");
+        return 1;
+    }
+    printf("parked   %d vehicles restored\n", b.size());
+    QFile::remove(path);
+    return 0;
+}
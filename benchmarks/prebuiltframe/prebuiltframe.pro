@@ -0,0 +1,25 @@
+#-------------------------------------------------
+#
+# 固定命令帧每次轮询的开销：原 toPurePackage 往返 / encodeRaw / 编译期预生成帧
+#
+#-------------------------------------------------
+
+QT       += core
+QT       -= gui
+
+TARGET = prebuiltframe
+CONFIG   += console
+CONFIG   -= app_bundle
+TEMPLATE = app
+
+INCLUDEPATH += ../..
+
+SOURCES += main.cpp \
+    ../../rfidWidget/IEEE1443Package.cpp \
+    ../../rfidWidget/EscapeKernel.cpp \
+    ../../rfidWidget/PrebuiltFrame.cpp
+
+HEADERS += ../../rfidWidget/IEEE1443Package.h \
+    ../../rfidWidget/EscapeKernel.h \
+    ../../rfidWidget/PrebuiltFrame.h \
+    ../../rfidWidget/SpscRing.h
@@ -0,0 +1,358 @@
+// 协议热点基准（QTest QBENCHMARK）
+// 按一次刷卡的真实帧比例（发送：寻卡/防冲突/选卡/认证/读块×2/写块；回包同样7帧）测：
+//   construct    —— IEEE1443Package(addr, cmd, data) 构造发送包 + IEEE1443Package(raw, size) 解析回包
+//   toRawPackage —— 发送包编码成线路帧（返回 QByteArray）
+//   encodeRaw    —— 发送包编码进调用者的缓冲区（CommandScheduler 的路径）
+//   getRawPackage—— 内容区转义
+//   decode       —— FrameDecoder 按64字节一段拆回包并构造 IEEE1443Package（收发线程的路径）
+//   tagInfo      —— decodeTagInfo + encodeTagInfo（读块后解析、出场写卡前编码）
+// QBENCHMARK 给出每轮耗时；另外再跑一遍统计每帧纳秒数和每帧堆分配次数，
+// 在最后按“名称 ns/frame allocs/frame”列表输出，便于协议改动前后对比。
+// 堆分配次数通过替换 malloc/calloc/realloc（转调 glibc 的 __libc_*）计数，只适用于 glibc。
+//
+// 构建运行：qmake && make && ./protocol [QTest 参数，如 -iterations 1000]
+
+#include <QtTest/QtTest>
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QList>
+#include <QVector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <rfidWidget/IEEE1443Package.h>
+#include <rfidWidget/FrameDecoder.h>
+#include <rfidWidget/TagInfo.h>
+
+// === 堆分配计数 ===
+extern "C" void *__libc_malloc(size_t size);
+extern "C" void *__libc_calloc(size_t n, size_t size);
+extern "C" void *__libc_realloc(void *p, size_t size);
+
+static volatile unsigned long long heapCalls = 0;
+
+extern "C" void *malloc(size_t size) __THROW
+{
+    heapCalls++;
+    return __libc_malloc(size);
+}
+
+extern "C" void *calloc(size_t n, size_t size) __THROW
+{
+    heapCalls++;
+    return __libc_calloc(n, size);
+}
+
+extern "C" void *realloc(void *p, size_t size) __THROW
+{
+    heapCalls++;
+    return __libc_realloc(p, size);
+}
+
+//拆帧时每次喂入的字节数（接近一次tty read）
+static const int kChunk = 64;
+//统计 ns/frame、allocs/frame 时重复的轮数
+static const int kRounds = 2000;
+
+// 功能：构造读卡器回包线路帧（长度不含同步尾）。
+static QByteArray buildReply(quint8 cmd, const QByteArray &data)
+{
+    QByteArray content;
+    content.append((char)0x00);
+    content.append((char)0x00);
+    content.append((char)(data.size() + 2));
+    content.append((char)cmd);
+    content.append(data);
+    quint8 chksum = 0;
+    for(int i = 0; i < content.size(); i++)
+        chksum += (quint8)content.at(i);
+    content.append((char)chksum);
+    QByteArray raw;
+    raw.append(IEEE1443_START_CODE);
+    raw.append(IEEE1443Package::getRawPackage(content));
+    raw.append(IEEE1443_STOP_CODE);
+    return raw;
+}
+
+static QByteArray randomBytes(int n)
+{
+    QByteArray b(n, 0);
+    for(int i = 0; i < n; i++)
+        b[i] = (char)(rand() & 0xFF);
+    return b;
+}
+
+struct Command
+{
+    quint8 cmd;
+    QByteArray data;
+};
+
+struct Measurement
+{
+    const char *name;
+    double nsPerFrame;
+    double allocsPerFrame;
+};
+
+class ProtocolBench : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void construct();
+    void toRawPackage();
+    void encodeRaw();
+    void getRawPackage();
+    void decode();
+    void tagInfo();
+    void cleanupTestCase();
+
+private:
+    // 每个 runXxx() 处理一遍帧组合，返回处理的帧数
+    typedef int (ProtocolBench::*Pass)();
+    int runConstruct();
+    int runToRawPackage();
+    int runEncodeRaw();
+    int runGetRawPackage();
+    int runDecode();
+    int runTagInfo();
+    void measure(const char *name, Pass pass);
+
+    QList<Command> sends;           // 一次刷卡的发送命令
+    QList<IEEE1443Package> packages;// 同上，已构造好
+    QList<QByteArray> replies;      // 一次刷卡的回包线路帧
+    QList<QByteArray> frames;       // 同上，去转义后的整帧
+    QList<QByteArray> contents;     // 回包内容区（未转义）
+    QByteArray stream;              // 若干次刷卡的回包字节流
+    int streamFrames;
+    QList<QByteArray> block1s;      // 块1：已注册和未注册卡混合
+    QList<QByteArray> block2s;
+    quint32 sink;                   // 防止结果被优化掉
+    QVector<Measurement> results;
+};
+
+void ProtocolBench::initTestCase()
+{
+    srand(14443);
+    sink = 0;
+    //1.发送：选卡UID随机，认证用默认Key，写块16字节随机（含需转义的字节）
+    quint8 sendCmds[] = { IEEE1443Package::SearchCard, IEEE1443Package::AntiColl, IEEE1443Package::SelectCard,
+                          IEEE1443Package::Authentication, IEEE1443Package::ReadCard, IEEE1443Package::ReadCard,
+                          IEEE1443Package::WriteCard };
+    for(int i = 0; i < 7; i++)
+    {
+        Command c;
+        c.cmd = sendCmds[i];
+        switch(c.cmd)
+        {
+        case IEEE1443Package::SearchCard:
+            c.data = QByteArray(1, 0x52);
+            break;
+        case IEEE1443Package::AntiColl:
+            c.data = QByteArray(1, 0x04);
+            break;
+        case IEEE1443Package::SelectCard:
+            c.data = randomBytes(4);
+            break;
+        case IEEE1443Package::Authentication:
+            c.data = QByteArray::fromHex("6001ffffffffffff");
+            break;
+        case IEEE1443Package::ReadCard:
+            c.data = QByteArray(1, (char)(i == 4 ? 1 : 2));
+            break;
+        default:
+            c.data = QByteArray(1, 0x02) + randomBytes(16);
+            break;
+        }
+        sends.append(c);
+        packages.append(IEEE1443Package(0, c.cmd, c.data));
+    }
+    //2.回包
+    replies.append(buildReply(IEEE1443Package::SearchCard, QByteArray::fromHex("000400")));
+    replies.append(buildReply(IEEE1443Package::AntiColl, QByteArray(1, 0) + randomBytes(4)));
+    replies.append(buildReply(IEEE1443Package::SelectCard, QByteArray::fromHex("0008")));
+    replies.append(buildReply(IEEE1443Package::Authentication, QByteArray(1, 0)));
+    replies.append(buildReply(IEEE1443Package::ReadCard, QByteArray(1, 0) + randomBytes(16)));
+    replies.append(buildReply(IEEE1443Package::ReadCard, QByteArray(1, 0) + randomBytes(16)));
+    replies.append(buildReply(IEEE1443Package::WriteCard, QByteArray(1, 0)));
+    //去转义后的整帧（收发线程交给 IEEE1443Package 的形式）和去掉同步头、尾的内容区
+    FrameDecoder decoder;
+    FrameDecoder::Frame f;
+    for(int i = 0; i < replies.size(); i++)
+    {
+        decoder.push(replies.at(i).constData(), replies.at(i).size());
+        QVERIFY(decoder.next(f));
+        frames.append(QByteArray(reinterpret_cast<const char *>(f.data), f.size));
+        contents.append(QByteArray(reinterpret_cast<const char *>(f.data) + 1, f.size - 2));
+    }
+    //3.字节流：64次刷卡
+    streamFrames = 0;
+    for(int n = 0; n < 64; n++)
+    {
+        for(int i = 0; i < replies.size(); i++)
+            stream.append(replies.at(i));
+        streamFrames += replies.size();
+    }
+    //4.卡内容：3/4 为已注册卡
+    for(int i = 0; i < 8; i++)
+    {
+        TagInfo info;
+        info.owner = QString("OWNER%1").arg(i);
+        info.vehicleType = "Sedan";
+        info.balance = 100 * i;
+        info.valid = true;
+        QByteArray b1;
+        QByteArray b2;
+        encodeTagInfo(info, b1, b2);
+        if(i % 4 == 3)
+            b1 = randomBytes(16);
+        block1s.append(b1);
+        block2s.append(b2);
+    }
+}
+
+// === 各项处理 ===
+int ProtocolBench::runConstruct()
+{
+    for(int i = 0; i < sends.size(); i++)
+    {
+        IEEE1443Package pkg(0, sends.at(i).cmd, sends.at(i).data);
+        sink += pkg.checkSum();
+    }
+    for(int i = 0; i < frames.size(); i++)
+    {
+        const QByteArray &raw = frames.at(i);
+        IEEE1443Package pkg(reinterpret_cast<const quint8 *>(raw.constData()), raw.size());
+        sink += pkg.dataLen();
+    }
+    return sends.size() + frames.size();
+}
+
+int ProtocolBench::runToRawPackage()
+{
+    for(int i = 0; i < packages.size(); i++)
+        sink += packages.at(i).toRawPackage().size();
+    return packages.size();
+}
+
+int ProtocolBench::runEncodeRaw()
+{
+    char buf[FrameDecoder::MaxFrameSize * 2];
+    for(int i = 0; i < packages.size(); i++)
+        sink += packages.at(i).encodeRaw(buf);
+    return packages.size();
+}
+
+int ProtocolBench::runGetRawPackage()
+{
+    for(int i = 0; i < contents.size(); i++)
+        sink += IEEE1443Package::getRawPackage(contents.at(i)).size();
+    return contents.size();
+}
+
+int ProtocolBench::runDecode()
+{
+    FrameDecoder decoder;
+    FrameDecoder::Frame f;
+    const char *p = stream.constData();
+    int left = stream.size();
+    while(left > 0)
+    {
+        int n = qMin(left, kChunk);
+        decoder.push(p, n);
+        while(decoder.next(f))
+        {
+            IEEE1443Package pkg(f.data, f.size);
+            if(pkg.isValid())
+                sink += pkg.command() + pkg.dataLen();
+        }
+        p += n;
+        left -= n;
+    }
+    return streamFrames;
+}
+
+int ProtocolBench::runTagInfo()
+{
+    QByteArray b1;
+    QByteArray b2;
+    for(int i = 0; i < block1s.size(); i++)
+    {
+        TagInfo info;
+        if(decodeTagInfo(block1s.at(i), block2s.at(i), info))
+        {
+            info.balance -= 5;
+            encodeTagInfo(info, b1, b2);
+            sink += b2.size();
+        }
+    }
+    return block1s.size();
+}
+
+// 功能：QBENCHMARK 测一遍，再固定轮数统计每帧耗时和分配次数。
+void ProtocolBench::measure(const char *name, Pass pass)
+{
+    QBENCHMARK {
+        (this->*pass)();
+    }
+    //先跑一遍，让一次性的初始化（静态表、共享空串）不计入
+    (this->*pass)();
+    qint64 frames = 0;
+    unsigned long long calls0 = heapCalls;
+    QElapsedTimer t;
+    t.start();
+    for(int r = 0; r < kRounds; r++)
+        frames += (this->*pass)();
+    qint64 ns = t.nsecsElapsed();
+    Measurement m;
+    m.name = name;
+    m.nsPerFrame = (double)ns / frames;
+    m.allocsPerFrame = (double)(heapCalls - calls0) / frames;
+    results.append(m);
+}
+
+void ProtocolBench::construct()
+{
+    measure("construct", &ProtocolBench::runConstruct);
+}
+
+void ProtocolBench::toRawPackage()
+{
+    measure("toRawPackage", &ProtocolBench::runToRawPackage);
+}
+
+void ProtocolBench::encodeRaw()
+{
+    measure("encodeRaw", &ProtocolBench::runEncodeRaw);
+}
+
+void ProtocolBench::getRawPackage()
+{
+    measure("getRawPackage", &ProtocolBench::runGetRawPackage);
+}
+
+void ProtocolBench::decode()
+{
+    measure("decode", &ProtocolBench::runDecode);
+}
+
+void ProtocolBench::tagInfo()
+{
+    measure("tagInfo", &ProtocolBench::runTagInfo);
+}
+
+void ProtocolBench::cleanupTestCase()
+{
+    printf("\n%-14s %10s %12s\n", "function", "ns/frame", "allocs/frame");
+    for(int i = 0; i < results.size(); i++)
+    {
+        const Measurement &m = results.at(i);
+        printf("%-14s %10.1f %12.2f\n", m.name, m.nsPerFrame, m.allocsPerFrame);
+    }
+    printf("(checksum %u)\n", sink);
+}
+
+QTEST_APPLESS_MAIN(ProtocolBench)
+
+#include "main.moc"
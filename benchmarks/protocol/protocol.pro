@@ -0,0 +1,26 @@
+#-------------------------------------------------
+#
+# 协议热点基准（QTest QBENCHMARK）：组包、编码、转义、拆帧、卡内容解析，输出 ns/frame 和 allocs/frame
+#
+#-------------------------------------------------
+
+QT       += core testlib
+QT       -= gui
+
+TARGET = protocol
+CONFIG   += console
+CONFIG   -= app_bundle
+TEMPLATE = app
+
+INCLUDEPATH += ../..
+
+SOURCES += main.cpp \
+    ../../rfidWidget/IEEE1443Package.cpp \
+    ../../rfidWidget/FrameDecoder.cpp \
+    ../../rfidWidget/EscapeKernel.cpp \
+    ../../rfidWidget/TagInfo.cpp
+
+HEADERS += ../../rfidWidget/IEEE1443Package.h \
+    ../../rfidWidget/FrameDecoder.h \
+    ../../rfidWidget/EscapeKernel.h \
+    ../../rfidWidget/TagInfo.h
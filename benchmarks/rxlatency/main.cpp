@@ -0,0 +1,304 @@
+// 刷卡到判定延迟基准
+// 用伪终端对模拟读卡器，依次跑 Search→AntiColl→Select→Auth→Read→Read 六步，
+// 分别测量 100ms 定时轮询（旧方式）和 EventDriven（QSocketNotifier）下每次刷卡的总耗时。
+//
+// 构建运行：qmake && make && ./rxlatency [刷卡次数]
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QThread>
+#include <QTimer>
+#include <QVector>
+#include <QStringList>
+#include <QtAlgorithms>
+#include <stdio.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+#include <rfidWidget/IEEE1443Package.h>
+#include <rfidWidget/posix_qextserialport.h>
+
+// 功能：构造读卡器回包（长度不含同步尾，和发送包不同）。
+static QByteArray buildReply(quint8 cmd, const QByteArray &data)
+{
+    QByteArray content;
+    content.append((char)0x00);
+    content.append((char)0x00);
+    content.append((char)(data.size() + 2));
+    content.append((char)cmd);
+    content.append(data);
+    quint8 chksum = 0;
+    for(int i = 0; i < content.size(); i++)
+        chksum += (quint8)content.at(i);
+    content.append((char)chksum);
+    QByteArray raw;
+    raw.append(IEEE1443_START_CODE);
+    raw.append(IEEE1443Package::getRawPackage(content));
+    raw.append(IEEE1443_STOP_CODE);
+    return raw;
+}
+
+// 读卡器替身：在伪终端主端收命令、立即回包
+class ReaderStandIn : public QThread
+{
+public:
+    explicit ReaderStandIn(int fd) : masterFd(fd), stopRequested(false) {}
+    void requestStop() { stopRequested = true; }
+
+protected:
+    void run()
+    {
+        QByteArray frame;
+        int status = 0;
+        char buf[256];
+        while(!stopRequested)
+        {
+            struct pollfd pfd;
+            pfd.fd = masterFd;
+            pfd.events = POLLIN;
+            pfd.revents = 0;
+            if(::poll(&pfd, 1, 50) <= 0)
+                continue;
+            int n = ::read(masterFd, buf, sizeof(buf));
+            for(int i = 0; i < n; i++)
+            {
+                char c = buf[i];
+                if(status == 0)
+                {
+                    if(c == IEEE1443_START_CODE)
+                    {
+                        frame.clear();
+                        frame.append(c);
+                        status = 1;
+                    }
+                }
+                else if(status == 2)
+                {
+                    frame.append(c);
+                    status = 1;
+                }
+                else if(c == IEEE1443_ESCAPE_CHAR)
+                    status = 2;
+                else
+                {
+                    frame.append(c);
+                    if(c == IEEE1443_STOP_CODE)
+                    {
+                        status = 0;
+                        answer(IEEE1443Package(frame));
+                    }
+                }
+            }
+        }
+    }
+
+private:
+    void answer(const IEEE1443Package &pkg)
+    {
+        QByteArray data;
+        data.append((char)0x00);
+        switch(pkg.command())
+        {
+        case IEEE1443Package::SearchCard:
+            data.append((char)0x04);
+            data.append((char)0x00);
+            break;
+        case IEEE1443Package::AntiColl:
+            data.append(QByteArray::fromHex("a1b2c3d4"));
+            break;
+        case IEEE1443Package::SelectCard:
+            data.append((char)0x08);
+            break;
+        case IEEE1443Package::ReadCard:
+            data.append(QByteArray(16, 0x5A));
+            break;
+        default:
+            break;
+        }
+        QByteArray raw = buildReply(pkg.command(), data);
+        ::write(masterFd, raw.constData(), raw.size());
+    }
+
+    int masterFd;
+    volatile bool stopRequested;
+};
+
+// 上位机侧：按六步链路发包，收到回包立即发下一步
+class TapRunner : public QObject
+{
+    Q_OBJECT
+public:
+    TapRunner(Posix_QextSerialPort *port, int taps)
+        : commPort(port), tapsLeft(taps), step(0), recvStatus(0)
+    {
+        chain << IEEE1443Package(0, IEEE1443Package::SearchCard, 0x52).toRawPackage()
+              << IEEE1443Package(0, IEEE1443Package::AntiColl, 0x04).toRawPackage()
+              << IEEE1443Package(0, IEEE1443Package::SelectCard, QByteArray::fromHex("a1b2c3d4")).toRawPackage()
+              << IEEE1443Package(0, IEEE1443Package::Authentication, QByteArray::fromHex("6001ffffffffffff")).toRawPackage()
+              << IEEE1443Package(0, IEEE1443Package::ReadCard, 0x01).toRawPackage()
+              << IEEE1443Package(0, IEEE1443Package::ReadCard, 0x02).toRawPackage();
+    }
+
+    QVector<qint64> samples;
+
+public slots:
+    void begin()
+    {
+        tapTimer.start();
+        step = 0;
+        commPort->write(chain.at(step));
+    }
+
+    void onPortDataReady()
+    {
+        qint64 a = commPort->bytesAvailable();
+        if(a <= 0)
+            return;
+        QByteArray bytes((int)a, 0);
+        int len = commPort->read(bytes.data(), bytes.size());
+        const char *p = bytes.constData();
+        while(len-- > 0)
+        {
+            char c = *p++;
+            switch(recvStatus)
+            {
+            case 0:
+                if(c == IEEE1443_START_CODE)
+                {
+                    recvStatus = 1;
+                    lastRecvPackage.clear();
+                    lastRecvPackage.append(c);
+                }
+                break;
+            case 1:
+                if(c == IEEE1443_ESCAPE_CHAR)
+                    recvStatus = 2;
+                else
+                {
+                    lastRecvPackage.append(c);
+                    if(c == IEEE1443_STOP_CODE)
+                    {
+                        recvStatus = 0;
+                        onFrame();
+                    }
+                }
+                break;
+            case 2:
+                lastRecvPackage.append(c);
+                recvStatus = 1;
+                break;
+            }
+        }
+    }
+
+private:
+    void onFrame()
+    {
+        if(!IEEE1443Package(lastRecvPackage).isValid())
+            return;
+        if(++step < chain.size())
+        {
+            commPort->write(chain.at(step));
+            return;
+        }
+        samples.append(tapTimer.nsecsElapsed());
+        if(--tapsLeft > 0)
+            begin();
+        else
+            QCoreApplication::instance()->quit();
+    }
+
+    Posix_QextSerialPort *commPort;
+    QList<QByteArray> chain;
+    int tapsLeft;
+    int step;
+    int recvStatus;
+    QByteArray lastRecvPackage;
+    QElapsedTimer tapTimer;
+};
+
+// 功能：按一种接收方式跑完 taps 次刷卡，返回每次耗时（纳秒）。
+static QVector<qint64> runMode(const QString &slaveName, QextSerialBase::QueryMode mode, int taps)
+{
+    Posix_QextSerialPort port(slaveName, mode);
+    port.setBaudRate(BAUD19200);
+    port.setFlowControl(FLOW_OFF);
+    port.setParity(PAR_NONE);
+    port.setDataBits(DATA_8);
+    port.setStopBits(STOP_1);
+    if(!port.open(QIODevice::ReadWrite))
+    {
+        fprintf(stderr, "failed to open %s\n", qPrintable(slaveName));
+        return QVector<qint64>();
+    }
+
+    TapRunner runner(&port, taps);
+    QTimer readTimer;
+    if(mode == QextSerialBase::EventDriven)
+        QObject::connect(&port, SIGNAL(readyRead()), &runner, SLOT(onPortDataReady()));
+    else
+    {
+        QObject::connect(&readTimer, SIGNAL(timeout()), &runner, SLOT(onPortDataReady()));
+        readTimer.start(100);
+    }
+    QTimer::singleShot(0, &runner, SLOT(begin()));
+    QCoreApplication::exec();
+    port.close();
+    return runner.samples;
+}
+
+// 功能：打印一种模式的延迟统计（毫秒）。
+static void report(const char *name, QVector<qint64> samples)
+{
+    if(samples.isEmpty())
+        return;
+    qSort(samples);
+    qint64 sum = 0;
+    for(int i = 0; i < samples.size(); i++)
+        sum += samples.at(i);
+    int n = samples.size();
+    printf("%-12s taps=%-5d mean=%8.3f ms  p50=%8.3f ms  p95=%8.3f ms  max=%8.3f ms\n",
+           name, n,
+           sum / 1e6 / n,
+           samples.at(n / 2) / 1e6,
+           samples.at(qMin(n - 1, n * 95 / 100)) / 1e6,
+           samples.at(n - 1) / 1e6);
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    int taps = argc > 1 ? atoi(argv[1]) : 50;
+    if(taps <= 0)
+        taps = 50;
+
+    int masterFd = ::posix_openpt(O_RDWR | O_NOCTTY);
+    if(masterFd < 0 || ::grantpt(masterFd) != 0 || ::unlockpt(masterFd) != 0)
+    {
+        perror("posix_openpt");
+        return 1;
+    }
+    struct termios tio;
+    ::tcgetattr(masterFd, &tio);
+    ::cfmakeraw(&tio);
+    ::tcsetattr(masterFd, TCSANOW, &tio);
+    QString slaveName = QString::fromLocal8Bit(::ptsname(masterFd));
+
+    ReaderStandIn reader(masterFd);
+    reader.start();
+
+    QVector<qint64> polling = runMode(slaveName, QextSerialBase::Polling, taps);
+    QVector<qint64> eventDriven = runMode(slaveName, QextSerialBase::EventDriven, taps);
+
+    reader.requestStop();
+    reader.wait();
+    ::close(masterFd);
+
+    report("polling", polling);
+    report("event", eventDriven);
+    return 0;
+}
+
+#include "main.moc"
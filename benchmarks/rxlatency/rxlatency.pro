@@ -0,0 +1,24 @@
+#-------------------------------------------------
+#
+# 刷卡到判定延迟基准：轮询(100ms) vs 事件驱动接收
+#
+#-------------------------------------------------
+
+QT       += core
+QT       -= gui
+
+TARGET = rxlatency
+CONFIG   += console
+CONFIG   -= app_bundle
+TEMPLATE = app
+
+INCLUDEPATH += ../..
+
+SOURCES += main.cpp \
+    ../../rfidWidget/IEEE1443Package.cpp \
+    ../../rfidWidget/qextserialbase.cpp \
+    ../../rfidWidget/posix_qextserialport.cpp
+
+HEADERS += ../../rfidWidget/IEEE1443Package.h \
+    ../../rfidWidget/qextserialbase.h \
+    ../../rfidWidget/posix_qextserialport.h
@@ -0,0 +1,509 @@
+// 命令间空档基准
+// 用伪终端对模拟读卡器，经 ReaderIoThread 收发，比较两种发命令方式下“回包到达 -> 下一条命令发出”的空档：
+//   slot      —— 原方式：只有一个 waitingReply 槽。流程内的下一步在回包处理里直接发；
+//                注册写卡这类等待中的工作挂在标志位上，回包处理末尾检查；
+//                读卡器忙时提交的独立命令被丢弃，只能等定时器下一次触发再发（同自动寻卡定时器）。
+//   scheduler —— CommandScheduler：所有命令排队，回包到达后立即发下一条。
+// 两个场景：
+//   tap   —— 寻卡→防冲突→选卡→认证→读块1→读块2，认证成功时界面提交写块1/写块2
+//   burst —— 界面一次提交 N 条读块命令
+// 输出每个场景的平均耗时与平均/最大空档。
+//
+// 构建运行：qmake && make && ./scheduler [次数] [定时器间隔ms] [burst条数]
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QThread>
+#include <QTimer>
+#include <QList>
+#include <stdio.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+#include <rfidWidget/IEEE1443Package.h>
+#include <rfidWidget/PrebuiltFrame.h>
+#include <rfidWidget/ReaderIoThread.h>
+#include <rfidWidget/CommandScheduler.h>
+#include <rfidWidget/posix_qextserialport.h>
+
+// 功能：构造读卡器回包（长度不含同步尾，和发送包不同）。
+static QByteArray buildReply(quint8 cmd, const QByteArray &data)
+{
+    QByteArray content;
+    content.append((char)0x00);
+    content.append((char)0x00);
+    content.append((char)(data.size() + 2));
+    content.append((char)cmd);
+    content.append(data);
+    quint8 chksum = 0;
+    for(int i = 0; i < content.size(); i++)
+        chksum += (quint8)content.at(i);
+    content.append((char)chksum);
+    QByteArray raw;
+    raw.append(IEEE1443_START_CODE);
+    raw.append(IEEE1443Package::getRawPackage(content));
+    raw.append(IEEE1443_STOP_CODE);
+    return raw;
+}
+
+// 读卡器替身：在伪终端主端收命令、立即回包
+class ReaderStandIn : public QThread
+{
+public:
+    explicit ReaderStandIn(int fd) : masterFd(fd), stopRequested(false), replySeq(0) {}
+    void requestStop() { stopRequested = true; }
+
+protected:
+    void run()
+    {
+        QByteArray frame;
+        int status = 0;
+        char buf[256];
+        while(!stopRequested)
+        {
+            struct pollfd pfd;
+            pfd.fd = masterFd;
+            pfd.events = POLLIN;
+            pfd.revents = 0;
+            if(::poll(&pfd, 1, 50) <= 0)
+                continue;
+            int n = ::read(masterFd, buf, sizeof(buf));
+            for(int i = 0; i < n; i++)
+            {
+                char c = buf[i];
+                if(status == 0)
+                {
+                    if(c == IEEE1443_START_CODE)
+                    {
+                        frame.clear();
+                        frame.append(c);
+                        status = 1;
+                    }
+                }
+                else if(status == 2)
+                {
+                    frame.append(c);
+                    status = 1;
+                }
+                else if(c == IEEE1443_ESCAPE_CHAR)
+                    status = 2;
+                else
+                {
+                    frame.append(c);
+                    if(c == IEEE1443_STOP_CODE)
+                    {
+                        status = 0;
+                        answer(IEEE1443Package(frame));
+                    }
+                }
+            }
+        }
+    }
+
+private:
+    void answer(const IEEE1443Package &pkg)
+    {
+        QByteArray data;
+        data.append((char)0x00);
+        switch(pkg.command())
+        {
+        case IEEE1443Package::SearchCard:
+            data.append((char)0x04);
+            data.append((char)0x00);
+            break;
+        case IEEE1443Package::AntiColl:
+            data.append(QByteArray::fromHex("a1b2c3d4"));
+            break;
+        case IEEE1443Package::SelectCard:
+            data.append((char)0x08);
+            break;
+        case IEEE1443Package::ReadCard:
+            data.append(QByteArray(14, 0x5A));
+            break;
+        default:
+            break;
+        }
+        // 末尾附加序号，每次回包内容不同，避免连续多轮时被重复包过滤
+        data.append((const char *)&replySeq, sizeof(replySeq));
+        replySeq++;
+        QByteArray raw = buildReply(pkg.command(), data);
+        ::write(masterFd, raw.constData(), raw.size());
+    }
+
+    int masterFd;
+    volatile bool stopRequested;
+    quint16 replySeq;
+};
+
+enum Scenario {
+    Tap,
+    Burst
+};
+
+struct Result
+{
+    qint64 totalNs;
+    quint32 gaps;
+    qint64 gapNsTotal;
+    qint64 gapNsMax;
+    Result() : totalNs(0), gaps(0), gapNsTotal(0), gapNsMax(0) {}
+};
+
+static QByteArray readFrame(int block)
+{
+    return IEEE1443Package(0, IEEE1443Package::ReadCard, (quint8)block).toRawPackage();
+}
+
+static QByteArray writeFrame(int block)
+{
+    QByteArray info;
+    info.append((char)block);
+    info.append(QByteArray(16, (char)(0x30 + block)));
+    return IEEE1443Package(0, IEEE1443Package::WriteCard, info).toRawPackage();
+}
+
+// 原方式：单槽 + 标志位 + 定时器重试
+class SlotRunner : public QObject
+{
+    Q_OBJECT
+public:
+    SlotRunner(ReaderIoThread *io, Scenario s, int runs, int tickMs, int burst)
+        : readerIo(io), scenario(s), runsLeft(runs), burstSize(burst),
+          waitingReply(false), pendingCommand(0), writePending(false), step(0), replyLanded(false)
+    {
+        tick.setInterval(tickMs);
+        connect(&tick, SIGNAL(timeout()), this, SLOT(onTick()));
+        connect(readerIo, SIGNAL(framesAvailable()), this, SLOT(onFrames()));
+    }
+
+    Result result;
+
+public slots:
+    void begin()
+    {
+        tick.start();
+        sessionTimer.start();
+        step = 0;
+        if(scenario == Tap)
+            sendData(PrebuiltFrame::searchCard(), IEEE1443Package::SearchCard);
+        else
+        {
+            // 界面一次提交多条，读卡器忙时只能等下次定时器再试
+            todo.clear();
+            for(int i = 0; i < burstSize; i++)
+                todo.append(4 + i);
+            onTick();
+        }
+    }
+
+    void onTick()
+    {
+        if(waitingReply || todo.isEmpty())
+            return;
+        sendData(readFrame(todo.takeFirst()), IEEE1443Package::ReadCard);
+    }
+
+    void requestWrites()
+    {
+        // 原 startRegistrationFlow：忙时挂标志位，等回包处理末尾再发
+        if(waitingReply)
+        {
+            writePending = true;
+            return;
+        }
+        sendData(writeFrame(1), IEEE1443Package::WriteCard);
+    }
+
+    void onFrames()
+    {
+        readerIo->rearmNotify();
+        IEEE1443Package p;
+        while(readerIo->takeFrame(p))
+            onRecvedPackage(p);
+    }
+
+private:
+    void sendData(const QByteArray &raw, quint8 cmd)
+    {
+        if(replyLanded)
+        {
+            qint64 gap = gapTimer.nsecsElapsed();
+            result.gaps++;
+            result.gapNsTotal += gap;
+            if(gap > result.gapNsMax)
+                result.gapNsMax = gap;
+            replyLanded = false;
+        }
+        readerIo->send(raw);
+        waitingReply = true;
+        pendingCommand = cmd;
+    }
+
+    void onRecvedPackage(const IEEE1443Package &p)
+    {
+        if(!waitingReply || p.command() != pendingCommand)
+            return;
+        waitingReply = false;
+        gapTimer.start();
+        replyLanded = true;
+
+        if(scenario == Tap)
+        {
+            switch(p.command())
+            {
+            case IEEE1443Package::SearchCard:
+                sendData(PrebuiltFrame::antiColl(), IEEE1443Package::AntiColl);
+                break;
+            case IEEE1443Package::AntiColl:
+                sendData(IEEE1443Package(0, IEEE1443Package::SelectCard,
+                                         QByteArray::fromHex("a1b2c3d4")).toRawPackage(),
+                         IEEE1443Package::SelectCard);
+                break;
+            case IEEE1443Package::SelectCard:
+                sendData(PrebuiltFrame::authDefaultKey(1), IEEE1443Package::Authentication);
+                break;
+            case IEEE1443Package::Authentication:
+                QTimer::singleShot(0, this, SLOT(requestWrites()));
+                sendData(readFrame(1), IEEE1443Package::ReadCard);
+                break;
+            case IEEE1443Package::ReadCard:
+                if(++step == 1)
+                    sendData(readFrame(2), IEEE1443Package::ReadCard);
+                break;
+            case IEEE1443Package::WriteCard:
+                if(++step == 3)
+                    sendData(writeFrame(2), IEEE1443Package::WriteCard);
+                else
+                    finishSession();
+                break;
+            }
+            if(writePending && !waitingReply)
+            {
+                writePending = false;
+                step = 2;
+                sendData(writeFrame(1), IEEE1443Package::WriteCard);
+            }
+            return;
+        }
+
+        if(todo.isEmpty())
+            finishSession();
+    }
+
+    void finishSession()
+    {
+        replyLanded = false;
+        result.totalNs += sessionTimer.nsecsElapsed();
+        tick.stop();
+        if(--runsLeft > 0)
+            QTimer::singleShot(0, this, SLOT(begin()));
+        else
+            QCoreApplication::instance()->quit();
+    }
+
+    ReaderIoThread *readerIo;
+    Scenario scenario;
+    int runsLeft;
+    int burstSize;
+    bool waitingReply;
+    quint8 pendingCommand;
+    bool writePending;
+    int step;
+    QList<int> todo;
+    QTimer tick;
+    QElapsedTimer sessionTimer;
+    QElapsedTimer gapTimer;
+    bool replyLanded;
+};
+
+// 新方式：全部交给 CommandScheduler
+class QueueRunner : public QObject, private CommandScheduler::Handler
+{
+    Q_OBJECT
+public:
+    QueueRunner(ReaderIoThread *io, Scenario s, int runs, int burst)
+        : scenario(s), runsLeft(runs), burstSize(burst), remaining(0), totalNs(0)
+    {
+        scheduler.attach(io);
+    }
+
+    Result result()
+    {
+        Result r;
+        CommandScheduler::Stats st = scheduler.stats();
+        r.totalNs = totalNs;
+        r.gaps = st.gaps;
+        r.gapNsTotal = st.gapNsTotal;
+        r.gapNsMax = st.gapNsMax;
+        return r;
+    }
+
+public slots:
+    void begin()
+    {
+        sessionTimer.start();
+        if(scenario == Tap)
+        {
+            remaining = 8;
+            scheduler.submit(PrebuiltFrame::searchCard(), IEEE1443Package::SearchCard, this);
+        }
+        else
+        {
+            remaining = burstSize;
+            for(int i = 0; i < burstSize; i++)
+                scheduler.submit(readFrame(4 + i), IEEE1443Package::ReadCard, this, 4 + i);
+        }
+    }
+
+    void requestWrites()
+    {
+        scheduler.submit(writeFrame(1), IEEE1443Package::WriteCard, this, 1);
+    }
+
+private:
+    void commandReplied(quint8 command, int tag, const IEEE1443Package &)
+    {
+        if(scenario == Tap)
+        {
+            switch(command)
+            {
+            case IEEE1443Package::SearchCard:
+                scheduler.submit(PrebuiltFrame::antiColl(), IEEE1443Package::AntiColl, this);
+                break;
+            case IEEE1443Package::AntiColl:
+                scheduler.submit(IEEE1443Package(0, IEEE1443Package::SelectCard,
+                                                 QByteArray::fromHex("a1b2c3d4")), this);
+                break;
+            case IEEE1443Package::SelectCard:
+                scheduler.submit(PrebuiltFrame::authDefaultKey(1), IEEE1443Package::Authentication, this, 1);
+                break;
+            case IEEE1443Package::Authentication:
+                QTimer::singleShot(0, this, SLOT(requestWrites()));
+                scheduler.submit(readFrame(1), IEEE1443Package::ReadCard, this, 1);
+                break;
+            case IEEE1443Package::ReadCard:
+                if(tag == 1)
+                    scheduler.submit(readFrame(2), IEEE1443Package::ReadCard, this, 2);
+                break;
+            case IEEE1443Package::WriteCard:
+                if(tag == 1)
+                    scheduler.submit(writeFrame(2), IEEE1443Package::WriteCard, this, 2);
+                break;
+            }
+        }
+        if(--remaining == 0)
+            finishSession();
+    }
+
+    void commandTimedOut(quint8 command, int)
+    {
+        fprintf(stderr, "command 0x%02x timed out\n", command);
+        if(--remaining == 0)
+            finishSession();
+    }
+
+    void finishSession()
+    {
+        totalNs += sessionTimer.nsecsElapsed();
+        if(--runsLeft > 0)
+            QTimer::singleShot(0, this, SLOT(begin()));
+        else
+            QCoreApplication::instance()->quit();
+    }
+
+    CommandScheduler scheduler;
+    Scenario scenario;
+    int runsLeft;
+    int burstSize;
+    int remaining;
+    QElapsedTimer sessionTimer;
+    qint64 totalNs;
+};
+
+// 功能：打开伪终端从端并启动收发线程，跑完一种方式后关闭。
+static Result runMode(const QString &slaveName, bool queued, Scenario s, int runs, int tickMs, int burst)
+{
+    Posix_QextSerialPort port(slaveName, QextSerialBase::Polling);
+    port.setBaudRate(BAUD19200);
+    port.setFlowControl(FLOW_OFF);
+    port.setParity(PAR_NONE);
+    port.setDataBits(DATA_8);
+    port.setStopBits(STOP_1);
+    if(!port.open(QIODevice::ReadWrite))
+    {
+        fprintf(stderr, "failed to open %s\n", qPrintable(slaveName));
+        return Result();
+    }
+    ReaderIoThread io(&port);
+    io.start();
+
+    Result res;
+    if(queued)
+    {
+        QueueRunner runner(&io, s, runs, burst);
+        QTimer::singleShot(0, &runner, SLOT(begin()));
+        QCoreApplication::exec();
+        res = runner.result();
+    }
+    else
+    {
+        SlotRunner runner(&io, s, runs, tickMs, burst);
+        QTimer::singleShot(0, &runner, SLOT(begin()));
+        QCoreApplication::exec();
+        res = runner.result;
+    }
+    io.stop();
+    port.close();
+    return res;
+}
+
+static void report(const char *scenario, const char *name, const Result &r, int runs)
+{
+    printf("%-6s %-10s %9.3f ms/run  gaps=%-6u mean gap=%9.3f us  max gap=%9.3f us\n",
+           scenario, name, r.totalNs / 1e6 / runs, r.gaps,
+           r.gaps ? r.gapNsTotal / 1e3 / r.gaps : 0.0, r.gapNsMax / 1e3);
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    int runs = argc > 1 ? atoi(argv[1]) : 50;
+    int tickMs = argc > 2 ? atoi(argv[2]) : 100;
+    int burst = argc > 3 ? atoi(argv[3]) : 8;
+    if(runs <= 0)
+        runs = 50;
+    if(tickMs <= 0)
+        tickMs = 100;
+    if(burst <= 0)
+        burst = 8;
+
+    int masterFd = ::posix_openpt(O_RDWR | O_NOCTTY);
+    if(masterFd < 0 || ::grantpt(masterFd) != 0 || ::unlockpt(masterFd) != 0)
+    {
+        perror("posix_openpt");
+        return 1;
+    }
+    struct termios tio;
+    ::tcgetattr(masterFd, &tio);
+    ::cfmakeraw(&tio);
+    ::tcsetattr(masterFd, TCSANOW, &tio);
+    QString slaveName = QString::fromLocal8Bit(::ptsname(masterFd));
+
+    ReaderStandIn reader(masterFd);
+    reader.start();
+
+    printf("%d runs, slot retry tick %d ms, burst of %d\n", runs, tickMs, burst);
+    report("tap", "slot", runMode(slaveName, false, Tap, runs, tickMs, burst), runs);
+    report("tap", "scheduler", runMode(slaveName, true, Tap, runs, tickMs, burst), runs);
+    report("burst", "slot", runMode(slaveName, false, Burst, runs, tickMs, burst), runs);
+    report("burst", "scheduler", runMode(slaveName, true, Burst, runs, tickMs, burst), runs);
+
+    reader.requestStop();
+    reader.wait();
+    ::close(masterFd);
+    return 0;
+}
+
+#include "main.moc"
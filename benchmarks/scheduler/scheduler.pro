@@ -0,0 +1,39 @@
+#-------------------------------------------------
+#
+# 命令间空档基准：单槽等待+标志位 vs CommandScheduler 队列
+#
+#-------------------------------------------------
+
+QT       += core
+QT       -= gui
+
+TARGET = scheduler
+CONFIG   += console
+CONFIG   -= app_bundle
+TEMPLATE = app
+
+INCLUDEPATH += ../..
+
+SOURCES += main.cpp \
+    ../../rfidWidget/IEEE1443Package.cpp \
+    ../../rfidWidget/EscapeKernel.cpp \
+    ../../rfidWidget/FrameDecoder.cpp \
+    ../../rfidWidget/PrebuiltFrame.cpp \
+    ../../rfidWidget/FrameTrace.cpp \
+    ../../rfidWidget/ReaderIoThread.cpp \
+    ../../rfidWidget/LaneMetrics.cpp \
+    ../../rfidWidget/CommandScheduler.cpp \
+    ../../rfidWidget/qextserialbase.cpp \
+    ../../rfidWidget/posix_qextserialport.cpp
+
+HEADERS += ../../rfidWidget/IEEE1443Package.h \
+    ../../rfidWidget/EscapeKernel.h \
+    ../../rfidWidget/FrameDecoder.h \
+    ../../rfidWidget/PrebuiltFrame.h \
+    ../../rfidWidget/SpscRing.h \
+    ../../rfidWidget/FrameTrace.h \
+    ../../rfidWidget/ReaderIoThread.h \
+    ../../rfidWidget/LaneMetrics.h \
+    ../../rfidWidget/CommandScheduler.h \
+    ../../rfidWidget/qextserialbase.h \
+    ../../rfidWidget/posix_qextserialport.h
@@ -0,0 +1,124 @@
+// 计费基准
+// 用一张日/夜分时、免费时长、每日封顶、分车型的规则表，为 N 条随机停车记录（0~7天）计费：
+//   naive —— 逐个计费单位找时段单价、按天累加再封顶（规则的直接写法）
+//   table —— Tariff::feeBatch()，查编好的前缀和表
+// 输出两种写法每条记录的平均耗时和总额，并核对逐条结果一致。
+//
+// 构建运行：qmake && make && ./tariff [记录数]
+
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QStringList>
+#include <QVector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <rfidWidget/Tariff.h>
+
+static const char kRules[] =
+    "# 车型  单位  免费  封顶  时段\n"
+    "*        60   15    60   08:00=5 20:00=2\n"
+    "SUV      30   15    90   08:00=4 20:00=1\n"
+    "Truck    60    0   200   00:00=12 06:00=15 22:00=12\n"
+    "Electric 15   30     0   08:00=1 20:00=0\n";
+
+// 功能：规则的直接写法：逐个计费单位取单价，按单位开始的日期累加、封顶。
+static int naiveFee(const QHash<QString, Tariff::Rule> &rules, const Tariff::Session &s)
+{
+    Tariff::Rule r = rules.value(s.vehicleType, rules.value("*"));
+    qint64 minutes = qMax<qint64>(0, s.entry.secsTo(s.exit)) / 60;
+    if(minutes <= r.graceMinutes)
+        return 0;
+    int e = s.entry.time().hour() * 60 + s.entry.time().minute();
+    qint64 units = (minutes + r.unitMinutes - 1) / r.unitMinutes;
+    qint64 total = 0;
+    qint64 day = 0;
+    qint64 dayCost = 0;
+    for(qint64 k = 0; k < units; k++)
+    {
+        qint64 m = e + k * r.unitMinutes;
+        if(m / 1440 != day)
+        {
+            total += (r.dailyCap > 0 && dayCost > r.dailyCap) ? r.dailyCap : dayCost;
+            day = m / 1440;
+            dayCost = 0;
+        }
+        int mm = (int)(m % 1440);
+        int rate = r.bands.last().second;
+        for(int b = 0; b < r.bands.size() && r.bands.at(b).first <= mm; b++)
+            rate = r.bands.at(b).second;
+        dayCost += rate;
+    }
+    total += (r.dailyCap > 0 && dayCost > r.dailyCap) ? r.dailyCap : dayCost;
+    return (int)total;
+}
+
+int main(int argc, char *argv[])
+{
+    int count = argc > 1 ? atoi(argv[1]) : 200000;
+    if(count <= 0)
+        count = 200000;
+    srand(14443);
+
+    //1.编译规则表
+    QList<Tariff::Rule> rules;
+    QString error;
+    Tariff tariff;
+    if(!Tariff::parse(QString::fromUtf8(kRules), &rules, &error) || !tariff.compile(rules, &error))
+    {
+        fprintf(stderr, "bad rules: %s\n", error.toLatin1().constData());
+        return 1;
+    }
+    QHash<QString, Tariff::Rule> byType;
+    for(int i = 0; i < rules.size(); i++)
+        byType.insert(rules.at(i).vehicleType, rules.at(i));
+
+    //2.随机停车记录：多数几小时，少数停好几天
+    QStringList types;
+    types << "Sedan" << "SUV" << "Truck" << "Electric" << "Other";
+    QDateTime base = QDateTime::currentDateTime();
+    QVector<Tariff::Session> sessions(count);
+    for(int i = 0; i < count; i++)
+    {
+        Tariff::Session &s = sessions[i];
+        s.entry = base.addSecs(-(rand() % (30 * 86400)));
+        int secs = (rand() % 8 == 0) ? rand() % (7 * 86400) : rand() % (6 * 3600);
+        s.exit = s.entry.addSecs(secs);
+        s.vehicleType = types.at(rand() % types.size());
+    }
+    printf("sessions: %d\n", count);
+
+    //3.逐单位累加
+    QElapsedTimer t;
+    QVector<int> expected(count);
+    qint64 naiveTotal = 0;
+    t.start();
+    for(int i = 0; i < count; i++)
+    {
+        expected[i] = naiveFee(byType, sessions.at(i));
+        naiveTotal += expected[i];
+    }
+    qint64 naiveNs = t.nsecsElapsed();
+
+    //4.查表批量计费
+    QVector<int> fees;
+    t.start();
+    qint64 tableTotal = tariff.feeBatch(sessions, &fees);
+    qint64 tableNs = t.nsecsElapsed();
+
+    printf("naive  %8.1f ns/session  total %lld\n", (double)naiveNs / count, (long long)naiveTotal);
+    printf("table  %8.1f ns/session  total %lld\n", (double)tableNs / count, (long long)tableTotal);
+    for(int i = 0; i < count; i++)
+    {
+        if(fees.at(i) != expected.at(i))
+        {
+            fprintf(stderr, "session %d (%s, %s, %d s): table %d, naive %d\n", i,
+                    sessions.at(i).vehicleType.toLatin1().constData(),
+                    sessions.at(i).entry.toString("yyyy-MM-dd hh:mm").toLatin1().constData(),
+                    sessions.at(i).entry.secsTo(sessions.at(i).exit), fees.at(i), expected.at(i));
+            return 1;
+        }
+    }
+    printf("speedup %.1fx\n", (double)naiveNs / qMax<qint64>(1, tableNs));
+    return 0;
+}
@@ -0,0 +1,20 @@
+#-------------------------------------------------
+#
+# 计费基准：逐个计费单位累加 vs Tariff 前缀和表，批量日结
+#
+#-------------------------------------------------
+
+QT       += core
+QT       -= gui
+
+TARGET = tariff
+CONFIG   += console
+CONFIG   -= app_bundle
+TEMPLATE = app
+
+INCLUDEPATH += ../..
+
+SOURCES += main.cpp \
+    ../../rfidWidget/Tariff.cpp
+
+HEADERS += ../../rfidWidget/Tariff.h
@@ -0,0 +1,236 @@
+#include "CardField.h"
+#include <rfidWidget/IEEE1443Package.h>
+#include <string.h>
+
+//状态字节
+static const quint8 kOk = 0x00;
+static const quint8 kFail = 0x01;
+static const quint8 kKeyFail = 0x02;
+static const quint8 kBadBlock = 0x03;
+static const quint8 kUnknown = 0x7F;
+//寻卡回的卡类型（0x0400 = Mifare One S50），选卡回的容量字节
+static const quint8 kTagType[2] = { 0x04, 0x00 };
+static const quint8 kS50Size = 0x08;
+
+S50Card::S50Card() :
+    authedSectors(0),
+    present(false),
+    enabled(true)
+{
+    memset(uid, 0, sizeof(uid));
+    memset(keyA, 0xFF, sizeof(keyA));
+    memset(blocks, 0, sizeof(blocks));
+    //和 Python 模拟器一样的演示数据（块1/块2）
+    memcpy(blocks[1], "HELLO_RFID_BLOCK1", BlockSize);
+    memcpy(blocks[2], "DEMO_DATA_BLOCK2!", BlockSize);
+}
+
+CardField::CardField() :
+    mode(RoundRobin),
+    fixedIndex(0),
+    rrIndex(0),
+    selected(-1)
+{
+}
+
+
+// === 卡片 ===
+int CardField::addCard(const QByteArray &uid, const QByteArray &keyA)
+{
+    if(uid.size() != 4 || find(uid) >= 0)
+        return -1;
+    S50Card c;
+    memcpy(c.uid, uid.constData(), 4);
+    if(keyA.size() == 6)
+        memcpy(c.keyA, keyA.constData(), 6);
+    cards.append(c);
+    return cards.size() - 1;
+}
+
+int CardField::find(const QByteArray &uid) const
+{
+    if(uid.size() != 4)
+        return -1;
+    for(int i = 0; i < cards.size(); i++)
+    {
+        if(memcmp(cards.at(i).uid, uid.constData(), 4) == 0)
+            return i;
+    }
+    return -1;
+}
+
+void CardField::setPresent(int i, bool present)
+{
+    if(i < 0 || i >= cards.size())
+        return;
+    cards[i].present = present;
+    if(!present)
+    {
+        cards[i].authedSectors = 0;
+        if(selected == i)
+            selected = -1;
+    }
+}
+
+void CardField::setAllPresent(bool present)
+{
+    for(int i = 0; i < cards.size(); i++)
+        setPresent(i, present);
+}
+
+bool CardField::hasActiveCard() const
+{
+    for(int i = 0; i < cards.size(); i++)
+    {
+        if(isActive(i))
+            return true;
+    }
+    return false;
+}
+
+void CardField::setAnticollMode(AnticollMode m, int index)
+{
+    mode = m;
+    fixedIndex = index;
+    rrIndex = 0;
+}
+
+// 功能：在“启用且在场”的卡里按模式选一张。
+int CardField::chooseForAnticoll(quint32 &rng)
+{
+    int active[64];
+    int n = 0;
+    for(int i = 0; i < cards.size() && n < 64; i++)
+    {
+        if(isActive(i))
+            active[n++] = i;
+    }
+    if(n == 0)
+        return -1;
+    switch(mode)
+    {
+    case Random:
+        return active[nextRandom(rng) % n];
+    case Fixed:
+        return active[qBound(0, fixedIndex, n - 1)];
+    default:
+        {
+            int i = active[rrIndex % n];
+            rrIndex = (rrIndex + 1) % n;
+            return i;
+        }
+    }
+}
+
+int CardField::findActive(const quint8 *uid) const
+{
+    for(int i = 0; i < cards.size(); i++)
+    {
+        if(isActive(i) && memcmp(cards.at(i).uid, uid, 4) == 0)
+            return i;
+    }
+    return -1;
+}
+
+
+// === 应答 ===
+// 功能：按命令字应答，数据长度或流程不对时回 0x01。
+void CardField::handle(quint8 cmd, const quint8 *data, int len, QByteArray &reply, quint32 &rng)
+{
+    reply.clear();
+    //1.没有“启用且在场”的卡
+    if(!hasActiveCard())
+    {
+        reply.append((char)kFail);
+        return;
+    }
+    switch(cmd)
+    {
+    //2.寻卡：回卡类型
+    case IEEE1443Package::SearchCard:
+        reply.append((char)kOk);
+        reply.append(reinterpret_cast<const char *>(kTagType), 2);
+        return;
+    //3.防冲突：参数 0x04，回一张卡的UID
+    case IEEE1443Package::AntiColl:
+        {
+            int i = (len >= 1 && data[0] == 0x04) ? chooseForAnticoll(rng) : -1;
+            if(i < 0)
+            {
+                reply.append((char)kFail);
+                return;
+            }
+            reply.append((char)kOk);
+            reply.append(reinterpret_cast<const char *>(cards.at(i).uid), 4);
+            return;
+        }
+    //4.选卡：锁定该卡，认证重新开始
+    case IEEE1443Package::SelectCard:
+        {
+            int i = (len == 4) ? findActive(data) : -1;
+            if(i < 0)
+            {
+                reply.append((char)kFail);
+                return;
+            }
+            selected = i;
+            cards[i].authedSectors = 0;
+            reply.append((char)kOk);
+            reply.append((char)kS50Size);
+            return;
+        }
+    default:
+        break;
+    }
+    //5.认证/读/写：只对选中的卡
+    if(cmd != IEEE1443Package::Authentication && cmd != IEEE1443Package::ReadCard && cmd != IEEE1443Package::WriteCard)
+    {
+        reply.append((char)kUnknown);
+        return;
+    }
+    if(selected < 0 || !isActive(selected))
+    {
+        reply.append((char)kFail);
+        return;
+    }
+    S50Card &c = cards[selected];
+    if(cmd == IEEE1443Package::Authentication)
+    {
+        //模式(只支持KeyA 0x60) + 块号 + 6字节Key
+        if(len != 8 || data[0] != 0x60)
+            reply.append((char)kFail);
+        else if(data[1] >= S50Card::Blocks)
+            reply.append((char)kBadBlock);
+        else if(memcmp(data + 2, c.keyA, 6) != 0)
+            reply.append((char)kKeyFail);
+        else
+        {
+            c.authedSectors |= (quint16)(1 << (data[1] / 4));
+            reply.append((char)kOk);
+        }
+        return;
+    }
+    //读：块号；写：块号 + 16字节
+    int expected = (cmd == IEEE1443Package::ReadCard) ? 1 : 1 + S50Card::BlockSize;
+    if(len != expected)
+    {
+        reply.append((char)kFail);
+        return;
+    }
+    quint8 block = data[0];
+    if(block >= S50Card::Blocks)
+    {
+        reply.append((char)kBadBlock);
+        return;
+    }
+    if(!(c.authedSectors & (1 << (block / 4))))
+    {
+        reply.append((char)kKeyFail);
+        return;
+    }
+    reply.append((char)kOk);
+    if(cmd == IEEE1443Package::ReadCard)
+        reply.append(reinterpret_cast<const char *>(c.blocks[block]), S50Card::BlockSize);
+    else
+        memcpy(c.blocks[block], data + 1, S50Card::BlockSize);
+}
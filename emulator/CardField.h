@@ -0,0 +1,84 @@
+#ifndef CARDFIELD_H
+#define CARDFIELD_H
+
+#include <QByteArray>
+#include <QVector>
+
+// xorshift32：每个通道一个状态（非0），脚本给定种子时防冲突选卡和链路异常都可复现
+inline quint32 nextRandom(quint32 &s)
+{
+    s ^= s << 13;
+    s ^= s >> 17;
+    s ^= s << 5;
+    return s;
+}
+
+// 一张 Mifare One (S50) 卡：4字节UID、每张卡自己的 KeyA、64块×16字节，块1/块2带演示数据。
+// 认证按扇区（4块）记录，重新选卡或拿走时清掉。
+struct S50Card
+{
+    enum { Blocks = 64, BlockSize = 16 };
+
+    quint8 uid[4];
+    quint8 keyA[6];
+    quint8 blocks[Blocks][BlockSize];
+    quint16 authedSectors;  // 已认证扇区位图
+    bool present;           // 在天线区
+    bool enabled;           // 参与防冲突/选卡
+
+    S50Card();
+    QByteArray uidBytes() const {
+        return QByteArray(reinterpret_cast<const char *>(uid), 4);
+    }
+};
+
+// 一个读卡器天线区里的卡片集合，按 tools/ 下 Python 模拟器的多卡模型应答命令：
+//   寻卡/防冲突只看“启用且在场”的卡，防冲突按轮询/随机/固定选一张返回；
+//   选卡成功后锁定该卡，之后的认证/读/写只作用于它；
+//   无卡时任何命令都回状态 0x01（是否沉默由调用者决定），未知命令回 0x7F。
+// 不加锁，只在模拟器的事件循环里使用。
+class CardField
+{
+public:
+    enum AnticollMode
+    {
+        RoundRobin = 0,
+        Random,
+        Fixed
+    };
+
+    CardField();
+
+    // === 卡片 ===
+    int addCard(const QByteArray &uid, const QByteArray &keyA);//返回下标，UID不是4字节返回-1
+    int find(const QByteArray &uid) const;//任意状态的卡，没有返回-1
+    int cardCount() const {
+        return cards.size();
+    }
+    S50Card &card(int i) {
+        return cards[i];
+    }
+    void setPresent(int i, bool present);//拿走时清选卡锁定和认证
+    void setAllPresent(bool present);
+    bool hasActiveCard() const;
+    void setAnticollMode(AnticollMode mode, int fixedIndex = 0);
+
+    // === 应答 ===
+    // 处理一条命令，reply 填入数据域（状态字节 + 数据）
+    void handle(quint8 cmd, const quint8 *data, int len, QByteArray &reply, quint32 &rng);
+
+private:
+    bool isActive(int i) const {
+        return cards.at(i).present && cards.at(i).enabled;
+    }
+    int chooseForAnticoll(quint32 &rng);
+    int findActive(const quint8 *uid) const;
+
+    QVector<S50Card> cards;
+    AnticollMode mode;
+    int fixedIndex;
+    int rrIndex;
+    int selected;//选卡锁定的卡，-1没有
+};
+
+#endif // CARDFIELD_H
@@ -0,0 +1,281 @@
+#include "EmulatorScript.h"
+#include <QFile>
+#include <QRegExp>
+#include <QtAlgorithms>
+
+//没有 lanes 行也没有 -n 时的通道数
+static const int kDefaultLanes = 1;
+//通道数上限（每通道占两个文件描述符）
+static const int kMaxLanes = 1024;
+//没有 card 行的通道用的缺省卡，和 Python 模拟器的 DEFAULT_UIDS 一致
+static const char *const kDefaultUids[] = { "B7D2FF79", "11223344", "A1B2C3D4" };
+
+EmulatorScript::Impairment::Impairment() :
+    delayMs(0),
+    jitterMs(0),
+    drop(0.0),
+    reorder(0.0),
+    dup(0.0),
+    rxDrop(0.0),
+    silent(false)
+{
+}
+
+EmulatorScript::EmulatorScript() :
+    seed(14443),
+    repeatMs(0)
+{
+}
+
+// 功能：通道写法 * / 3 / 0,2,5 / 4-7 / 0-3,8 展开成下标列表。
+bool EmulatorScript::parseLanes(const QString &spec, int laneCount, QVector<int> *out)
+{
+    out->clear();
+    if(spec == "*")
+    {
+        for(int i = 0; i < laneCount; i++)
+            out->append(i);
+        return true;
+    }
+    QStringList parts = spec.split(',');
+    for(int i = 0; i < parts.size(); i++)
+    {
+        QStringList range = parts.at(i).split('-');
+        bool ok1 = false;
+        bool ok2 = false;
+        int first = range.at(0).toInt(&ok1);
+        int last = (range.size() == 2) ? range.at(1).toInt(&ok2) : first;
+        if(range.size() == 1)
+            ok2 = ok1;
+        if(!ok1 || !ok2 || range.size() > 2 || first < 0 || last < first || last >= laneCount)
+            return false;
+        for(int n = first; n <= last; n++)
+            out->append(n);
+    }
+    return true;
+}
+
+static bool parseUid(const QString &text, QByteArray *uid)
+{
+    QRegExp hex("[0-9A-Fa-f]{8}");
+    if(!hex.exactMatch(text))
+        return false;
+    *uid = QByteArray::fromHex(text.toLatin1());
+    return true;
+}
+
+bool EmulatorScript::applyImpairment(Impairment *imp, const QStringList &settings, QString *error)
+{
+    for(int i = 0; i < settings.size(); i++)
+    {
+        QStringList kv = settings.at(i).split('=');
+        bool ok = false;
+        double v = (kv.size() == 2) ? kv.at(1).toDouble(&ok) : 0.0;
+        QString key = kv.at(0);
+        bool isRate = (key == "drop" || key == "reorder" || key == "dup" || key == "rxdrop");
+        if(!ok || v < 0 || (isRate && v > 1.0))
+        {
+            if(error)
+                *error = QString("bad impairment '%1'").arg(settings.at(i));
+            return false;
+        }
+        if(key == "delay")
+            imp->delayMs = (int)v;
+        else if(key == "jitter")
+            imp->jitterMs = (int)v;
+        else if(key == "drop")
+            imp->drop = v;
+        else if(key == "reorder")
+            imp->reorder = v;
+        else if(key == "dup")
+            imp->dup = v;
+        else if(key == "rxdrop")
+            imp->rxDrop = v;
+        else if(key == "silent")
+            imp->silent = (v != 0);
+        else
+        {
+            if(error)
+                *error = QString("unknown impairment '%1'").arg(key);
+            return false;
+        }
+    }
+    return true;
+}
+
+bool EmulatorScript::load(const QString &path, int laneCount, QString *error)
+{
+    QFile file(path);
+    if(!file.open(QIODevice::ReadOnly | QIODevice::Text))
+    {
+        if(error)
+            *error = QString("cannot open %1").arg(path);
+        return false;
+    }
+    return parse(QString::fromUtf8(file.readAll()), laneCount, error);
+}
+
+bool EmulatorScript::parse(const QString &text, int laneCount, QString *error)
+{
+    //1.去注释、分词；先找 lanes，后面的通道写法要按通道数展开
+    QList<QStringList> rows;
+    QList<int> lineNumbers;
+    QStringList lines = text.split('\n');
+    int scriptLanes = kDefaultLanes;
+    for(int n = 0; n < lines.size(); n++)
+    {
+        QString line = lines.at(n);
+        int hash = line.indexOf('#');
+        if(hash >= 0)
+            line.truncate(hash);
+        QStringList f = line.split(QRegExp("\\s+"), QString::SkipEmptyParts);
+        if(f.isEmpty())
+            continue;
+        if(f.at(0) == "lanes")
+        {
+            bool ok = false;
+            scriptLanes = (f.size() == 2) ? f.at(1).toInt(&ok) : 0;
+            if(!ok || scriptLanes <= 0 || scriptLanes > kMaxLanes)
+            {
+                if(error)
+                    *error = QString("line %1: lanes must be 1..%2").arg(n + 1).arg(kMaxLanes);
+                return false;
+            }
+            continue;
+        }
+        rows.append(f);
+        lineNumbers.append(n + 1);
+    }
+    if(laneCount <= 0)
+        laneCount = scriptLanes;
+    if(laneCount > kMaxLanes)
+        laneCount = kMaxLanes;
+
+    //2.逐行解析
+    QVector<Lane> out(laneCount);
+    QVector<bool> hasCards(laneCount, false);
+    QList<Event> timeline;
+    quint32 newSeed = seed;
+    qint64 newRepeat = 0;
+    for(int r = 0; r < rows.size(); r++)
+    {
+        const QStringList &f = rows.at(r);
+        const QString &op = f.at(0);
+        QString problem;
+        QVector<int> which;
+        bool ok = false;
+        if(op == "seed" || op == "repeat")
+        {
+            qlonglong v = (f.size() == 2) ? f.at(1).toLongLong(&ok) : 0;
+            if(!ok || v < 0)
+                problem = QString("%1 needs a non-negative integer").arg(op);
+            else if(op == "seed")
+                newSeed = (quint32)v;
+            else
+                newRepeat = v;
+        }
+        else if(op == "card")
+        {
+            CardSpec c;
+            c.present = true;
+            if(f.size() < 3 || f.size() > 5 || !parseLanes(f.at(1), laneCount, &which))
+                problem = "expected card <lanes> UID [KeyA] [absent]";
+            else if(!parseUid(f.at(2), &c.uid))
+                problem = QString("bad UID '%1'").arg(f.at(2));
+            for(int i = 3; problem.isEmpty() && i < f.size(); i++)
+            {
+                if(f.at(i) == "absent")
+                    c.present = false;
+                else if(QRegExp("[0-9A-Fa-f]{12}").exactMatch(f.at(i)))
+                    c.keyA = QByteArray::fromHex(f.at(i).toLatin1());
+                else
+                    problem = QString("bad KeyA '%1'").arg(f.at(i));
+            }
+            for(int i = 0; problem.isEmpty() && i < which.size(); i++)
+            {
+                out[which.at(i)].cards.append(c);
+                hasCards[which.at(i)] = true;
+            }
+        }
+        else if(op == "anticoll")
+        {
+            CardField::AnticollMode mode = CardField::RoundRobin;
+            int index = (f.size() == 4) ? f.at(3).toInt(&ok) : 0;
+            if(f.size() < 3 || f.size() > 4 || !parseLanes(f.at(1), laneCount, &which) || (f.size() == 4 && !ok))
+                problem = "expected anticoll <lanes> roundrobin|random|fixed [index]";
+            else if(f.at(2) == "random")
+                mode = CardField::Random;
+            else if(f.at(2) == "fixed")
+                mode = CardField::Fixed;
+            else if(f.at(2) != "roundrobin")
+                problem = QString("unknown anticoll mode '%1'").arg(f.at(2));
+            for(int i = 0; problem.isEmpty() && i < which.size(); i++)
+            {
+                out[which.at(i)].anticoll = mode;
+                out[which.at(i)].fixedIndex = index;
+            }
+        }
+        else if(op == "impair")
+        {
+            if(f.size() < 3 || !parseLanes(f.at(1), laneCount, &which))
+                problem = "expected impair <lanes> key=value ...";
+            for(int i = 0; problem.isEmpty() && i < which.size(); i++)
+                applyImpairment(&out[which.at(i)].impairment, f.mid(2), &problem);
+        }
+        else if(op == "at")
+        {
+            Event e;
+            e.atMs = (f.size() >= 4) ? f.at(1).toLongLong(&ok) : 0;
+            if(f.size() < 4 || !ok || e.atMs < 0 || !parseLanes(f.at(2), laneCount, &e.lanes))
+                problem = "expected at <ms> <lanes> place|remove|impair ...";
+            else if(f.at(3) == "place" || f.at(3) == "remove")
+            {
+                e.action = (f.at(3) == "place") ? Event::Place : Event::Remove;
+                if(f.size() != 5 || (f.at(4) != "*" && !parseUid(f.at(4), &e.uid)))
+                    problem = QString("expected %1 UID|*").arg(f.at(3));
+            }
+            else if(f.at(3) == "impair")
+            {
+                Impairment check;
+                e.action = Event::Impair;
+                e.settings = f.mid(4);
+                if(e.settings.isEmpty())
+                    problem = "impair needs key=value";
+                else
+                    applyImpairment(&check, e.settings, &problem);
+            }
+            else
+                problem = QString("unknown action '%1'").arg(f.at(3));
+            if(problem.isEmpty())
+                timeline.append(e);
+        }
+        else
+            problem = QString("unknown directive '%1'").arg(op);
+        if(!problem.isEmpty())
+        {
+            if(error)
+                *error = QString("line %1: %2").arg(lineNumbers.at(r)).arg(problem);
+            return false;
+        }
+    }
+
+    //3.没有 card 行的通道放缺省卡
+    for(int i = 0; i < laneCount; i++)
+    {
+        if(hasCards.at(i))
+            continue;
+        for(int k = 0; k < 3; k++)
+        {
+            CardSpec c;
+            c.uid = QByteArray::fromHex(kDefaultUids[k]);
+            c.present = (k == 0);
+            out[i].cards.append(c);
+        }
+    }
+    qStableSort(timeline.begin(), timeline.end());
+    lanes = out;
+    events = timeline;
+    seed = newSeed;
+    repeatMs = newRepeat;
+    return true;
+}
@@ -0,0 +1,94 @@
+#ifndef EMULATORSCRIPT_H
+#define EMULATORSCRIPT_H
+
+#include <QByteArray>
+#include <QList>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include "CardField.h"
+
+// 模拟器脚本：每个通道（一个伪终端）的卡片、链路异常，以及按时间触发的放卡/收卡/改异常事件。
+// 每行一条指令，# 之后为注释；<通道> 写 * / 3 / 0,2,5 / 4-7 / 0-3,8：
+//   lanes    N                                   通道数（命令行 -n 优先）
+//   seed     N                                   随机种子，通道 i 用 seed + i
+//   repeat   毫秒                                 事件时间线按此周期循环
+//   card     <通道> UID [KeyA] [absent]            加一张卡（缺省在场、KeyA 全 FF）
+//   anticoll <通道> roundrobin|random|fixed [序号]  防冲突选卡方式
+//   impair   <通道> 键=值 ...                       链路异常，键见 applyImpairment()
+//   at 毫秒  <通道> place|remove UID|*              放卡/收卡
+//   at 毫秒  <通道> impair 键=值 ...                 改链路异常
+// 没有任何 card 行的通道用 Python 模拟器的三张缺省卡，第一张在场。
+class EmulatorScript
+{
+public:
+    // 回包链路异常，和 Python 模拟器的 Impairment 一致
+    struct Impairment
+    {
+        int delayMs;        // 回包基础延迟
+        int jitterMs;       // 额外延迟 0~jitter 均匀分布
+        double drop;        // 回包丢弃概率
+        double reorder;     // 和上一个待发回包交换顺序的概率
+        double dup;         // 重复发送（晚 0~50ms）的概率
+        double rxDrop;      // 命令帧当作没收到的概率
+        bool silent;        // 无卡时不回包（否则回 0x01）
+
+        Impairment();
+    };
+
+    struct CardSpec
+    {
+        QByteArray uid;
+        QByteArray keyA;    // 空 = 缺省 FFFFFFFFFFFF
+        bool present;
+    };
+
+    struct Lane
+    {
+        QList<CardSpec> cards;
+        Impairment impairment;
+        CardField::AnticollMode anticoll;
+        int fixedIndex;
+
+        Lane() : anticoll(CardField::RoundRobin), fixedIndex(0) {}
+    };
+
+    struct Event
+    {
+        enum Action
+        {
+            Place = 0,
+            Remove,
+            Impair
+        };
+
+        qint64 atMs;
+        QVector<int> lanes;
+        Action action;
+        QByteArray uid;         // 空 = 该通道全部卡
+        QStringList settings;   // Impair 的 键=值
+
+        bool operator<(const Event &other) const {
+            return atMs < other.atMs;
+        }
+    };
+
+    EmulatorScript();
+
+    // laneCount > 0 时覆盖脚本里的 lanes
+    bool parse(const QString &text, int laneCount, QString *error);
+    bool load(const QString &path, int laneCount, QString *error);
+
+    // 键：delay jitter（毫秒）、drop reorder dup rxdrop（0~1）、silent（0/1）
+    static bool applyImpairment(Impairment *imp, const QStringList &settings, QString *error);
+
+    QVector<Lane> lanes;
+    QList<Event> events;    // 按时间排序
+    quint32 seed;
+    qint64 repeatMs;        // 0 = 不循环
+
+private:
+    static bool parseLanes(const QString &spec, int laneCount, QVector<int> *out);
+};
+
+#endif // EMULATORSCRIPT_H
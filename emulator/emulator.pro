@@ -0,0 +1,30 @@
+#-------------------------------------------------
+#
+# 无界面读卡器模拟器：多个伪终端各一条通道，一个 epoll 循环，脚本控制卡片和链路异常，只链接 QtCore
+#
+#-------------------------------------------------
+
+QT       += core
+QT       -= gui
+
+TARGET = rfid-emulator
+CONFIG   += console
+CONFIG   -= app_bundle
+TEMPLATE = app
+
+INCLUDEPATH += ..
+
+SOURCES += main.cpp \
+    CardField.cpp \
+    EmulatorScript.cpp \
+    ../rfidWidget/IEEE1443Package.cpp \
+    ../rfidWidget/FrameDecoder.cpp \
+    ../rfidWidget/EscapeKernel.cpp
+
+HEADERS += CardField.h \
+    EmulatorScript.h \
+    ../rfidWidget/IEEE1443Package.h \
+    ../rfidWidget/FrameDecoder.h \
+    ../rfidWidget/EscapeKernel.h
+
+OTHER_FILES += example.script
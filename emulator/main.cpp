@@ -0,0 +1,543 @@
+// 无界面读卡器模拟器
+// 和 tools/ 下的 Python 模拟器说同样的帧格式、同样的多卡 S50 模型（每卡 KeyA、64块、选卡锁定），
+// 但一个进程开多个伪终端（每个一条“读卡通道”），全部挂在一个 epoll 循环上：
+//   收：每次 read 整段交给 FrameDecoder 拆帧，不逐字节读；
+//   发：每通道一个按发送时间排队的环形队列（队头到点才发，乱序 = 和上一个待发回包交换），
+//       非阻塞写，写不完的留到 EPOLLOUT；一个 timerfd 定时到最早的待发回包或脚本事件。
+// 卡片、回包延迟/抖动/丢包/乱序/重复、收包丢弃和按时间放卡收卡都来自脚本（格式见 EmulatorScript.h），
+// 用作上位机、无界面闸口程序的压测对端。
+// 启动时每条通道打印一行“通道号  伪终端名”，-l 前缀 另建符号链接 前缀0、前缀1 ...；
+// 收到 SIGINT/SIGTERM 时打印每条通道的收发统计后退出。
+//
+// 构建运行：qmake && make && ./rfid-emulator [-n 通道数] [-l 链接前缀] [脚本]
+
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/timerfd.h>
+#include <rfidWidget/IEEE1443Package.h>
+#include <rfidWidget/FrameDecoder.h>
+#include "CardField.h"
+#include "EmulatorScript.h"
+
+//回包线路帧最大长度：写块回包只有状态字节，读块回包 1+16 字节数据，全部转义也不超过
+static const int kMaxReplySize = 64;
+//重复回包比原回包晚 0~50ms，和 Python 模拟器一致
+static const int kDupSpreadUs = 50000;
+//对端不读时，每通道最多积压的未写出字节，超过丢新回包
+static const int kMaxPendingBytes = 64 * 1024;
+static const int kReadChunk = 4096;
+
+static qint64 nowUs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (qint64)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+// 0~1 的均匀随机数
+static inline double chance(quint32 &rng)
+{
+    return (nextRandom(rng) >> 8) * (1.0 / 16777216.0);
+}
+
+struct TxItem
+{
+    qint64 sendAtUs;
+    int size;
+    char raw[kMaxReplySize];
+};
+
+// 待发回包队列：容量为2的幂的环形缓冲，出队、入队 O(1)，不逐个分配
+class TxQueue
+{
+public:
+    TxQueue() : head(0), count(0) {
+        items.resize(16);
+    }
+    bool isEmpty() const {
+        return count == 0;
+    }
+    int size() const {
+        return count;
+    }
+    const TxItem &front() const {
+        return items.at(head);
+    }
+    void popFront() {
+        head = (head + 1) & (items.size() - 1);
+        count--;
+    }
+    void pushBack(const TxItem &item) {
+        if(count == items.size())
+            grow();
+        items[(head + count) & (items.size() - 1)] = item;
+        count++;
+    }
+    // 最后两个交换：新回包排到上一个待发回包前面
+    void swapLastTwo() {
+        int mask = items.size() - 1;
+        qSwap(items[(head + count - 1) & mask], items[(head + count - 2) & mask]);
+    }
+
+private:
+    void grow() {
+        QVector<TxItem> bigger(items.size() * 2);
+        for(int i = 0; i < count; i++)
+            bigger[i] = items.at((head + i) & (items.size() - 1));
+        items = bigger;
+        head = 0;
+    }
+
+    QVector<TxItem> items;
+    int head;
+    int count;
+};
+
+struct LaneStats
+{
+    quint64 rxFrames;
+    quint64 badFrames;      // 拆出来但不是合法包
+    quint64 rxDropped;
+    quint64 silenced;       // 无卡沉默
+    quint64 replies;        // 进入发送队列的回包（不含重复）
+    quint64 txDropped;
+    quint64 reordered;
+    quint64 duplicated;
+    quint64 sent;
+    quint64 overflows;      // 对端不读、积压超限丢掉的回包
+    int maxQueue;
+
+    LaneStats() { memset(this, 0, sizeof(*this)); }
+};
+
+// 一条通道：一个伪终端主端 + 卡片 + 链路异常 + 收发状态
+struct Lane
+{
+    int index;
+    int masterFd;
+    int slaveFd;            // 自己也开着从端：没人连时主端不会 EPOLLHUP，且串口参数能先设成 raw
+    QString slaveName;
+    CardField field;
+    EmulatorScript::Impairment impairment;
+    quint32 rng;
+    FrameDecoder decoder;
+    TxQueue tx;
+    QByteArray pending;     // 已到点但没写进主端的字节
+    bool busy;              // 在 busyLanes 里
+    LaneStats stats;
+};
+
+static int epollFd = -1;
+static int timerFd = -1;
+static int signalFdNum = -1;
+static QVector<Lane *> lanes;
+static QVector<Lane *> busyLanes;   // 发送队列非空的通道，只扫这些
+static QString linkPrefix;
+
+// === 伪终端 ===
+static Lane *openLane(int index)
+{
+    int master = ::posix_openpt(O_RDWR | O_NOCTTY);
+    if(master < 0 || ::grantpt(master) != 0 || ::unlockpt(master) != 0)
+    {
+        perror("posix_openpt");
+        return 0;
+    }
+    const char *name = ::ptsname(master);
+    int slave = name ? ::open(name, O_RDWR | O_NOCTTY) : -1;
+    if(slave < 0)
+    {
+        perror("open pts");
+        ::close(master);
+        return 0;
+    }
+    struct termios tio;
+    ::tcgetattr(slave, &tio);
+    ::cfmakeraw(&tio);
+    ::tcsetattr(slave, TCSANOW, &tio);
+    ::fcntl(master, F_SETFL, ::fcntl(master, F_GETFL) | O_NONBLOCK);
+
+    Lane *lane = new Lane;
+    lane->index = index;
+    lane->masterFd = master;
+    lane->slaveFd = slave;
+    lane->slaveName = QString::fromLocal8Bit(name);
+    lane->busy = false;
+    return lane;
+}
+
+static void watchLane(Lane *lane, bool wantWrite)
+{
+    struct epoll_event ev;
+    ev.events = EPOLLIN | (wantWrite ? EPOLLOUT : 0);
+    ev.data.ptr = lane;
+    ::epoll_ctl(epollFd, EPOLL_CTL_MOD, lane->masterFd, &ev);
+}
+
+// === 发送 ===
+// 功能：写一帧；前面还有没写完的就排在后面，写不完的等 EPOLLOUT。
+static void writeFrame(Lane *lane, const char *data, int size)
+{
+    if(!lane->pending.isEmpty())
+    {
+        if(lane->pending.size() + size > kMaxPendingBytes)
+        {
+            lane->stats.overflows++;
+            return;
+        }
+        lane->pending.append(data, size);
+        lane->stats.sent++;
+        return;
+    }
+    ssize_t n = ::write(lane->masterFd, data, size);
+    if(n < 0)
+    {
+        if(errno != EAGAIN && errno != EWOULDBLOCK)
+        {
+            lane->stats.overflows++;
+            return;
+        }
+        n = 0;
+    }
+    lane->stats.sent++;
+    if(n < size)
+    {
+        lane->pending.append(data + n, size - (int)n);
+        watchLane(lane, true);
+    }
+}
+
+static void flushPending(Lane *lane)
+{
+    ssize_t n = ::write(lane->masterFd, lane->pending.constData(), lane->pending.size());
+    if(n > 0)
+        lane->pending.remove(0, (int)n);
+    if(lane->pending.isEmpty())
+        watchLane(lane, false);
+}
+
+// 功能：队头到点就发，队头没到点后面的都等（和 Python 模拟器的发送线程一样）。
+static void flushDue(Lane *lane, qint64 now)
+{
+    while(!lane->tx.isEmpty() && lane->tx.front().sendAtUs <= now)
+    {
+        const TxItem &item = lane->tx.front();
+        writeFrame(lane, item.raw, item.size);
+        lane->tx.popFront();
+    }
+}
+
+// 功能：回包按链路异常进发送队列：丢弃 -> 延迟+抖动 -> 乱序 -> 重复。
+static void scheduleReply(Lane *lane, const IEEE1443Package &reply, qint64 now)
+{
+    const EmulatorScript::Impairment &imp = lane->impairment;
+    if(imp.drop > 0 && chance(lane->rng) < imp.drop)
+    {
+        lane->stats.txDropped++;
+        return;
+    }
+    TxItem item;
+    item.sendAtUs = now + (qint64)imp.delayMs * 1000;
+    if(imp.jitterMs > 0)
+        item.sendAtUs += (qint64)(chance(lane->rng) * imp.jitterMs * 1000);
+    item.size = reply.encodeRaw(item.raw);
+    lane->tx.pushBack(item);
+    lane->stats.replies++;
+    if(lane->tx.size() > 1 && imp.reorder > 0 && chance(lane->rng) < imp.reorder)
+    {
+        lane->tx.swapLastTwo();
+        lane->stats.reordered++;
+    }
+    if(imp.dup > 0 && chance(lane->rng) < imp.dup)
+    {
+        item.sendAtUs += (qint64)(chance(lane->rng) * kDupSpreadUs);
+        lane->tx.pushBack(item);
+        lane->stats.duplicated++;
+    }
+    lane->stats.maxQueue = qMax(lane->stats.maxQueue, lane->tx.size());
+    if(!lane->busy && !lane->tx.isEmpty())
+    {
+        lane->busy = true;
+        busyLanes.append(lane);
+    }
+}
+
+// === 接收 ===
+static void readLane(Lane *lane)
+{
+    char buf[kReadChunk];
+    ssize_t n = ::read(lane->masterFd, buf, sizeof(buf));
+    if(n <= 0)
+        return;
+    qint64 now = nowUs();
+    QByteArray reply;
+    lane->decoder.push(buf, (int)n);
+    FrameDecoder::Frame f;
+    while(lane->decoder.next(f))
+    {
+        IEEE1443Package pkg(f.data, f.size);
+        if(!pkg.isValid())
+        {
+            lane->stats.badFrames++;
+            continue;
+        }
+        lane->stats.rxFrames++;
+        //1.命令当作没收到
+        const EmulatorScript::Impairment &imp = lane->impairment;
+        if(imp.rxDrop > 0 && chance(lane->rng) < imp.rxDrop)
+        {
+            lane->stats.rxDropped++;
+            continue;
+        }
+        //2.无卡沉默
+        if(imp.silent && !lane->field.hasActiveCard())
+        {
+            lane->stats.silenced++;
+            continue;
+        }
+        //3.应答
+        lane->field.handle(pkg.command(), reinterpret_cast<const quint8 *>(pkg.data().constData()),
+                           pkg.dataLen(), reply, lane->rng);
+        scheduleReply(lane, IEEE1443Package(pkg.address(), pkg.command(), reply), now);
+    }
+}
+
+// === 脚本事件 ===
+static void applyEvent(const EmulatorScript::Event &e)
+{
+    for(int i = 0; i < e.lanes.size(); i++)
+    {
+        Lane *lane = lanes.at(e.lanes.at(i));
+        if(e.action == EmulatorScript::Event::Impair)
+        {
+            EmulatorScript::applyImpairment(&lane->impairment, e.settings, 0);
+            continue;
+        }
+        bool present = (e.action == EmulatorScript::Event::Place);
+        if(e.uid.isEmpty())
+        {
+            lane->field.setAllPresent(present);
+            continue;
+        }
+        //放一张通道里没有的卡：按缺省 KeyA 加上
+        int k = lane->field.find(e.uid);
+        if(k < 0 && present)
+            k = lane->field.addCard(e.uid, QByteArray());
+        lane->field.setPresent(k, present);
+    }
+}
+
+static void armTimer(qint64 deadlineUs)
+{
+    struct itimerspec its;
+    memset(&its, 0, sizeof(its));
+    if(deadlineUs >= 0)
+    {
+        //绝对时间 0 表示停止，到点的至少给 1ns
+        its.it_value.tv_sec = deadlineUs / 1000000;
+        its.it_value.tv_nsec = (deadlineUs % 1000000) * 1000 + 1;
+    }
+    ::timerfd_settime(timerFd, TFD_TIMER_ABSTIME, &its, 0);
+}
+
+static void printStats()
+{
+    printf("\n%-5s %-12s %9s %6s %7s %7s %9s %7s %7s %7s %9s %6s %6s %6s\n",
+           "lane", "pts", "rx", "bad", "rxdrop", "silent", "replies", "txdrop", "reorder", "dup",
+           "sent", "overfl", "maxq", "resync");
+    for(int i = 0; i < lanes.size(); i++)
+    {
+        const Lane *l = lanes.at(i);
+        const LaneStats &s = l->stats;
+        printf("%-5d %-12s %9llu %6llu %7llu %7llu %9llu %7llu %7llu %7llu %9llu %6llu %6d %6u\n",
+               l->index, l->slaveName.toLocal8Bit().constData(),
+               (unsigned long long)s.rxFrames, (unsigned long long)s.badFrames,
+               (unsigned long long)s.rxDropped, (unsigned long long)s.silenced,
+               (unsigned long long)s.replies, (unsigned long long)s.txDropped,
+               (unsigned long long)s.reordered, (unsigned long long)s.duplicated,
+               (unsigned long long)s.sent, (unsigned long long)s.overflows,
+               s.maxQueue, l->decoder.resyncCount());
+    }
+    fflush(stdout);
+}
+
+static void usage()
+{
+    fprintf(stderr, "usage: rfid-emulator [-n lanes] [-l link-prefix] [script]\n");
+}
+
+int main(int argc, char *argv[])
+{
+    //1.参数和脚本
+    int laneCount = 0;
+    QString scriptPath;
+    for(int i = 1; i < argc; i++)
+    {
+        if(strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+            laneCount = atoi(argv[++i]);
+        else if(strcmp(argv[i], "-l") == 0 && i + 1 < argc)
+            linkPrefix = QString::fromLocal8Bit(argv[++i]);
+        else if(argv[i][0] == '-')
+        {
+            usage();
+            return 2;
+        }
+        else
+            scriptPath = QString::fromLocal8Bit(argv[i]);
+    }
+    EmulatorScript script;
+    QString error;
+    bool ok = scriptPath.isEmpty() ? script.parse(QString(), laneCount, &error)
+                                   : script.load(scriptPath, laneCount, &error);
+    if(!ok)
+    {
+        fprintf(stderr, "%s: %s\n", scriptPath.toLocal8Bit().constData(), error.toLocal8Bit().constData());
+        return 1;
+    }
+
+    //2.SIGINT/SIGTERM 走 signalfd，定时走 timerfd，和各通道一起挂在 epoll 上
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGINT);
+    sigaddset(&mask, SIGTERM);
+    sigprocmask(SIG_BLOCK, &mask, 0);
+    signalFdNum = ::signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+    timerFd = ::timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    epollFd = ::epoll_create1(EPOLL_CLOEXEC);
+    if(signalFdNum < 0 || timerFd < 0 || epollFd < 0)
+    {
+        perror("epoll");
+        return 1;
+    }
+    struct epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.ptr = &signalFdNum;
+    ::epoll_ctl(epollFd, EPOLL_CTL_ADD, signalFdNum, &ev);
+    ev.data.ptr = &timerFd;
+    ::epoll_ctl(epollFd, EPOLL_CTL_ADD, timerFd, &ev);
+
+    //3.每条通道一个伪终端
+    for(int i = 0; i < script.lanes.size(); i++)
+    {
+        Lane *lane = openLane(i);
+        if(!lane)
+            return 1;
+        const EmulatorScript::Lane &setup = script.lanes.at(i);
+        for(int k = 0; k < setup.cards.size(); k++)
+        {
+            int c = lane->field.addCard(setup.cards.at(k).uid, setup.cards.at(k).keyA);
+            lane->field.setPresent(c, setup.cards.at(k).present);
+        }
+        lane->field.setAnticollMode(setup.anticoll, setup.fixedIndex);
+        lane->impairment = setup.impairment;
+        lane->rng = (script.seed + i) ? script.seed + i : 1;
+        lanes.append(lane);
+        ev.events = EPOLLIN;
+        ev.data.ptr = lane;
+        ::epoll_ctl(epollFd, EPOLL_CTL_ADD, lane->masterFd, &ev);
+        QString link;
+        if(!linkPrefix.isEmpty())
+        {
+            link = linkPrefix + QString::number(i);
+            ::unlink(link.toLocal8Bit().constData());
+            if(::symlink(lane->slaveName.toLocal8Bit().constData(), link.toLocal8Bit().constData()) != 0)
+                perror("symlink");
+        }
+        printf("%d\t%s\t%s\n", i, lane->slaveName.toLocal8Bit().constData(), link.toLocal8Bit().constData());
+    }
+    fflush(stdout);
+
+    //4.事件循环
+    qint64 cycleStartUs = nowUs();
+    int nextEvent = 0;
+    bool running = true;
+    struct epoll_event events[64];
+    while(running)
+    {
+        //4.1到点的脚本事件（repeat 时一轮完了从头再来）
+        qint64 now = nowUs();
+        while(nextEvent < script.events.size()
+              && cycleStartUs + script.events.at(nextEvent).atMs * 1000 <= now)
+        {
+            applyEvent(script.events.at(nextEvent));
+            if(++nextEvent == script.events.size() && script.repeatMs > 0)
+            {
+                nextEvent = 0;
+                cycleStartUs += script.repeatMs * 1000;
+            }
+        }
+        //4.2到点的回包，顺便找下一个定时点
+        qint64 deadline = -1;
+        if(nextEvent < script.events.size())
+            deadline = cycleStartUs + script.events.at(nextEvent).atMs * 1000;
+        for(int i = 0; i < busyLanes.size(); )
+        {
+            Lane *lane = busyLanes.at(i);
+            flushDue(lane, now);
+            if(lane->tx.isEmpty())
+            {
+                lane->busy = false;
+                busyLanes[i] = busyLanes.last();
+                busyLanes.removeLast();
+                continue;
+            }
+            qint64 at = lane->tx.front().sendAtUs;
+            if(deadline < 0 || at < deadline)
+                deadline = at;
+            i++;
+        }
+        armTimer(deadline);
+        //4.3等
+        int n = ::epoll_wait(epollFd, events, 64, -1);
+        if(n < 0 && errno != EINTR)
+        {
+            perror("epoll_wait");
+            break;
+        }
+        for(int i = 0; i < n; i++)
+        {
+            void *tag = events[i].data.ptr;
+            if(tag == &signalFdNum)
+            {
+                running = false;
+                continue;
+            }
+            if(tag == &timerFd)
+            {
+                quint64 expirations;
+                ssize_t r = ::read(timerFd, &expirations, sizeof(expirations));
+                (void)r;
+                continue;
+            }
+            Lane *lane = static_cast<Lane *>(tag);
+            if(events[i].events & EPOLLOUT)
+                flushPending(lane);
+            if(events[i].events & EPOLLIN)
+                readLane(lane);
+        }
+    }
+
+    //5.统计、清理
+    printStats();
+    for(int i = 0; i < lanes.size(); i++)
+    {
+        if(!linkPrefix.isEmpty())
+            ::unlink((linkPrefix + QString::number(i)).toLocal8Bit().constData());
+        ::close(lanes.at(i)->slaveFd);
+        ::close(lanes.at(i)->masterFd);
+        delete lanes.at(i);
+    }
+    return 0;
+}
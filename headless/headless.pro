@@ -0,0 +1,17 @@
+#-------------------------------------------------
+#
+# 无界面闸口程序：多个串口各一个 ReaderSession，分布在线程池里，只链接 QtCore
+#
+#-------------------------------------------------
+
+QT       += core
+QT       -= gui
+
+TARGET = rfid-headless
+CONFIG   += console
+CONFIG   -= app_bundle
+TEMPLATE = app
+
+SOURCES += main.cpp
+
+include(../rfidWidget/readersession.pri)
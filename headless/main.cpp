@@ -0,0 +1,335 @@
+// 无界面通道程序
+// 在服务器上驱动多条读卡通道：每个串口一个 ReaderSession，会话分布在 LanePool 线程池里，
+// 所有通道共用一份 ParkingStore。无人值守闸口只做自动进出场：
+//   未登记卡、余额不足只打印提示，不弹窗、不等人；注册和充值仍在界面程序里做。
+// 事件逐行打印到标准输出（制表符分隔），由上层（日志采集、网关进程）按行解析：
+//   时间  通道  entry   卡号  余额
+//   时间  通道  exit    卡号  费用  余额
+//   时间  通道  reject  卡号  原因
+//   时间  通道  timeout 命令码
+// 停车记录写预写日志（RFID_JOURNAL，默认 ./parking.journal），启动时重放，重启不丢在场车辆。
+// 计费规则读 RFID_TARIFF（默认 ./tariff.conf，格式见 Tariff::parse），没有该文件时全天每小时 5。
+// 收到 SIGINT/SIGTERM 时关闭全部通道，打印每条通道的调度统计、寻卡识别耗时、
+// 各命令的往返时间估计和卡内容缓存命中率后退出。
+// 收到 SIGUSR1 时不停机，把每条通道和全部通道合计的通讯统计快照（LaneMetrics::Snapshot::toText）
+// 打印到标准错误，每行前加 “metrics 通道号”（合计为 all）。
+// 收到 SIGUSR2 时把全部通道最近的收发字节按时间合并，追加导出到 RFID_TRACE（默认 ./frames.trace）；
+// 某条通道命令重试用尽时也会单独导出（每通道至多每分钟一次）。
+// 导出的文件可以用 replay/ 的 rfid-replay 回放。
+//
+// 构建运行：qmake && make && ./rfid-headless [串口...]   （或 RFID_PORTS=/dev/ttyS1,/dev/ttyS2）
+
+#include <QCoreApplication>
+#include <QSocketNotifier>
+#include <QDateTime>
+#include <QStringList>
+#include <QElapsedTimer>
+#include <stdio.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <rfidWidget/IEEE1443Package.h>
+#include <rfidWidget/ReaderSession.h>
+#include <rfidWidget/FrameTrace.h>
+#include <rfidWidget/ParkingStore.h>
+#include <rfidWidget/ParkingJournal.h>
+#include <rfidWidget/LanePool.h>
+#include <rfidWidget/TagInfo.h>
+#include <rfidWidget/Tariff.h>
+
+static int signalFd[2] = { -1, -1 };
+
+// 信号处理函数里只写一个字节（信号编号），退出、打印统计放回事件循环
+static void onSignal(int sig)
+{
+    char c = (char)sig;
+    ssize_t n = ::write(signalFd[0], &c, 1);
+    (void)n;
+}
+
+static void printLine(int lane, const QString &line)
+{
+    //printf 自带流锁，多个通道线程同时打印时行不会交错
+    printf("%s\t%d\t%s\n",
+           QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss.zzz").toLatin1().constData(),
+           lane, line.toLatin1().constData());
+    fflush(stdout);
+}
+
+// 一条闸口通道的进出场逻辑，和会话在同一线程里运行
+class GateLane : public QObject
+{
+    Q_OBJECT
+
+public:
+    GateLane(int laneIndex, ReaderSession *s, ParkingStore *parking, const Tariff *rates) :
+        lane(laneIndex),
+        session(s),
+        store(parking),
+        tariff(rates),
+        exitFee(0)
+    {
+        connect(session, SIGNAL(cardRead(QString,QByteArray,QByteArray)),
+                this, SLOT(onCardRead(QString,QByteArray,QByteArray)));
+        connect(session, SIGNAL(cardLost()), this, SLOT(onCardLost()));
+        connect(session, SIGNAL(writeFinished(bool)), this, SLOT(onWriteFinished(bool)));
+        connect(session, SIGNAL(commandFailed(quint8)), this, SLOT(onCommandFailed(quint8)));
+    }
+
+private slots:
+    void onCardRead(const QString &cardId, const QByteArray &block1, const QByteArray &block2)
+    {
+        //1.本通道刚处理过这张卡，等收卡（寻卡失败）之后才再处理
+        if(cardId == handledCardId || !writingCardId.isEmpty())
+            return;
+        //2.解析卡信息
+        TagInfo info;
+        if(!decodeTagInfo(block1, block2, info))
+        {
+            markHandled(cardId);
+            printLine(lane, QString("reject\t%1\tunregistered").arg(cardId));
+            return;
+        }
+        QDateTime now = QDateTime::currentDateTime();
+        //3.1在场——出场：扣费写卡，写成功才记出场
+        if(store->isParked(cardId))
+        {
+            int fee = tariff->fee(store->entryTime(cardId), now, info.vehicleType);
+            if(info.balance < fee)
+            {
+                markHandled(cardId);
+                printLine(lane, QString("reject\t%1\tbalance %2 < fee %3").arg(cardId).arg(info.balance).arg(fee));
+                return;
+            }
+            info.balance -= fee;
+            QByteArray b1;
+            QByteArray b2;
+            encodeTagInfo(info, b1, b2);
+            writingCardId = cardId;
+            writingInfo = info;
+            exitFee = fee;
+            if(!session->writeUserBlocks(b1, b2))
+                onWriteFinished(false);
+            return;
+        }
+        //3.2不在场——入场
+        markHandled(cardId);
+        if(!store->recordEntry(cardId, now, info))
+        {
+            printLine(lane, QString("reject\t%1\tunsupported card id").arg(cardId));
+            return;
+        }
+        printLine(lane, QString("entry\t%1\t%2").arg(cardId).arg(info.balance));
+    }
+
+    void onWriteFinished(bool ok)
+    {
+        if(writingCardId.isEmpty())
+            return;
+        if(ok)
+        {
+            store->recordExit(writingCardId, QDateTime::currentDateTime());
+            markHandled(writingCardId);
+            printLine(lane, QString("exit\t%1\t%2\t%3").arg(writingCardId).arg(exitFee).arg(writingInfo.balance));
+        }
+        else
+            printLine(lane, QString("reject\t%1\twrite failed").arg(writingCardId));
+        writingCardId.clear();
+    }
+
+    void onCardLost()
+    {
+        handledCardId.clear();
+    }
+
+    void onCommandFailed(quint8 command)
+    {
+        //读写块超时已由 writeFinished(false) 等给出结果，这里只打印
+        if(command != IEEE1443Package::SearchCard)
+            printLine(lane, QString("timeout\t0x%1").arg(command, 2, 16, QChar('0')));
+    }
+
+private:
+    // 记下已处理的卡，会话在收卡前也不再为它读块
+    void markHandled(const QString &cardId)
+    {
+        handledCardId = cardId;
+        session->setAwaitingRemoval(cardId);
+    }
+
+    int lane;
+    ReaderSession *session;
+    ParkingStore *store;
+    const Tariff *tariff;//各通道共用，只读
+    QString handledCardId;//已处理、等待收卡的卡号
+    QString writingCardId;//出场写卡中的卡号
+    TagInfo writingInfo;
+    int exitFee;
+};
+
+// 把信号转成事件循环里的读事件，在主线程里关闭线程池
+class QuitHandler : public QObject
+{
+    Q_OBJECT
+
+public:
+    QuitHandler(LanePool *p, ParkingStore *s) :
+        pool(p),
+        store(s)
+    {
+        QSocketNotifier *notifier = new QSocketNotifier(signalFd[1], QSocketNotifier::Read, this);
+        connect(notifier, SIGNAL(activated(int)), this, SLOT(onQuitSignal()));
+    }
+
+private slots:
+    void onQuitSignal()
+    {
+        char c = 0;
+        ssize_t n = ::read(signalFd[1], &c, 1);
+        (void)n;
+        if(c == SIGUSR1)
+        {
+            printMetrics();
+            return;
+        }
+        if(c == SIGUSR2)
+        {
+            dumpTraces();
+            return;
+        }
+        //先停下全部通道：调度器、寻卡、缓存的统计是会话线程里的普通数据，线程结束后才能读
+        printMetrics();
+        pool->halt();
+        for(int i = 0; i < pool->laneCount(); i++)
+        {
+            CommandScheduler::Stats st = pool->session(i)->schedulerStats();
+            TagCache::Stats cs = pool->session(i)->tagCacheStats();
+            fprintf(stderr, "lane %d %s dispatched=%u retried=%u timedOut=%u cacheHitRate=%.2f roundTripsSaved=%u cacheStale=%u\n",
+                    i, pool->port(i).toLatin1().constData(), st.dispatched, st.retried, st.timedOut,
+                    cs.hitRate(), cs.roundTripsSaved, cs.stale);
+            ReaderSession::SearchStats ss = pool->session(i)->searchStats();
+            fprintf(stderr, "  search polls=%u empty=%u detections=%u detectMean=%.1fms detectMax=%lldms interval=%dms\n",
+                    ss.polls, ss.emptyPolls, ss.detections, ss.meanDetectMs(),
+                    (long long)ss.detectMsMax, ss.intervalMs);
+            QList<CommandScheduler::RttEstimate> rtts = pool->session(i)->replyTimeoutEstimates();
+            for(int k = 0; k < rtts.size(); k++)
+            {
+                const CommandScheduler::RttEstimate &e = rtts.at(k);
+                fprintf(stderr, "  cmd 0x%02x srtt=%.1fms rttvar=%.1fms timeout=%dms samples=%u replyTimeouts=%u spurious=%u failures=%u\n",
+                        e.command, e.srttUs / 1000.0, e.rttvarUs / 1000.0, e.timeoutMs,
+                        e.samples, e.replyTimeouts, e.spuriousRetries, e.failures);
+            }
+        }
+        pool->stop();//释放会话
+        //日志写完再退出
+        if(store->journal())
+        {
+            if(!store->journal()->flush())
+                fprintf(stderr, "journal: write failed, events after the last commit may be lost\n");
+            ParkingJournal::Stats js = store->journal()->stats();
+            fprintf(stderr, "journal appended=%u commits=%u maxBatch=%u bytes=%lld failures=%u lastError=%d\n",
+                    js.appended, js.commits, js.maxBatch, (long long)js.bytes, js.failures, js.lastError);
+        }
+        store->closeJournal();
+        QCoreApplication::quit();
+    }
+
+private:
+    // 功能：各通道的原子计数快照，可以在会话线程运行时读取。
+    void printMetrics()
+    {
+        LaneMetrics::Snapshot all;
+        for(int i = 0; i < pool->laneCount(); i++)
+        {
+            LaneMetrics::Snapshot snap = pool->session(i)->metrics().snapshot();
+            printSnapshot(QString::number(i), snap);
+            all.merge(snap);
+        }
+        printSnapshot("all", all);
+    }
+
+    // 功能：各通道的收发字节环按时间合并导出，不停收发线程。
+    void dumpTraces()
+    {
+        QList<const FrameTrace *> traces;
+        for(int i = 0; i < pool->laneCount(); i++)
+            traces.append(&pool->session(i)->trace());
+        QString error;
+        QString path = FrameTrace::configuredPath();
+        if(FrameTrace::dump(traces, path, "SIGUSR2", &error))
+            fprintf(stderr, "trace appended to %s\n", path.toLocal8Bit().constData());
+        else
+            fprintf(stderr, "trace: %s\n", error.toLocal8Bit().constData());
+    }
+
+    static void printSnapshot(const QString &lane, const LaneMetrics::Snapshot &snap)
+    {
+        QStringList lines = snap.toText().split('\n');
+        for(int k = 0; k < lines.size(); k++)
+            fprintf(stderr, "metrics %s %s\n", lane.toLatin1().constData(), lines.at(k).toLatin1().constData());
+    }
+
+    LanePool *pool;
+    ParkingStore *store;
+};
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    //1.信号转成事件循环里的读事件
+    if(::socketpair(AF_UNIX, SOCK_STREAM, 0, signalFd) != 0)
+    {
+        perror("socketpair");
+        return 1;
+    }
+    struct sigaction sa;
+    sa.sa_handler = onSignal;
+    sigemptyset(&sa.sa_mask);
+    sa.sa_flags = SA_RESTART;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+    sigaction(SIGUSR1, &sa, NULL);
+    sigaction(SIGUSR2, &sa, NULL);
+
+    //2.每个串口一条通道，共用一份停车记录；先重放预写日志恢复在场车辆
+    ParkingStore store;
+    QString journalPath = ParkingJournal::configuredPath();
+    QElapsedTimer replayTimer;
+    replayTimer.start();
+    qint64 replayed = store.openJournal(journalPath);
+    if(replayed < 0)
+        fprintf(stderr, "journal %s unavailable, parking records will not survive a restart\n",
+                journalPath.toLocal8Bit().constData());
+    else
+        fprintf(stderr, "journal %s: %lld events replayed in %lld ms, %d vehicles parked\n",
+                journalPath.toLocal8Bit().constData(), (long long)replayed,
+                (long long)replayTimer.elapsed(), store.parkedCount());
+    //计费规则编好后只读，各通道线程共用
+    Tariff tariff;
+    QString tariffError;
+    if(!tariff.load(Tariff::configuredPath(), &tariffError))
+        fprintf(stderr, "tariff %s: %s, using the default rate\n",
+                Tariff::configuredPath().toLocal8Bit().constData(), tariffError.toLocal8Bit().constData());
+    LanePool pool;
+    QStringList ports = LanePool::configuredPorts(app.arguments().mid(1));
+    for(int i = 0; i < ports.size(); i++)
+    {
+        int lane = pool.addLane(ports.at(i));
+        pool.bindToLane(lane, new GateLane(lane, pool.session(lane), &store, &tariff));
+    }
+    QuitHandler quit(&pool, &store);
+
+    //3.打开全部通道并开始自动寻卡
+    int opened = pool.start();
+    fprintf(stderr, "%d/%d lanes open on %d threads\n", opened, pool.laneCount(), pool.threadCount());
+    if(opened == 0)
+    {
+        pool.stop();
+        return 1;
+    }
+
+    return app.exec();
+}
+
+#include "main.moc"
@@ -1,6 +1,7 @@
 #include <QtGui/QApplication>
 #include <QTextCodec>
 #include "widget.h"
+#include <rfidWidget/LanePool.h>
 
 int main(int argc, char *argv[])
 {
@@ -8,7 +9,8 @@ int main(int argc, char *argv[])
     QTextCodec::setCodecForTr(QTextCodec::codecForName("UTF-8"));
     QTextCodec::setCodecForCStrings(QTextCodec::codecForName("UTF-8"));
     QTextCodec::setCodecForLocale(QTextCodec::codecForName("UTF-8"));
-    Widget w;
+    //串口列表：命令行参数 > 环境变量 RFID_PORTS > /dev/ttyS0
+    Widget w(LanePool::configuredPorts(a.arguments().mid(1)));
     w.show();
 
     return a.exec();
@@ -0,0 +1,14 @@
+#-------------------------------------------------
+#
+# 读卡器会话静态库（QtCore），供界面程序以外的通道程序链接
+#
+#-------------------------------------------------
+
+QT       += core
+QT       -= gui
+
+TARGET = readersession
+TEMPLATE = lib
+CONFIG   += staticlib
+
+include(../rfidWidget/readersession.pri)
@@ -0,0 +1,546 @@
+// 收发记录回放
+// 读回 FrameTrace 导出的文件（ReaderSession 收发线程记下的原始字节，单调时钟纳秒时间戳），
+// 驱动拆帧器和读卡器会话，复现现场问题、测状态机吞吐：
+//   realtime —— 伪终端一端是真实的 ReaderSession（收发线程、命令调度、自动寻卡、寻卡链），
+//               另一端按记录应答：会话发出一帧，与记录里的下一条 tx 比对，
+//               再把随后的 rx 按记录里与该 tx 的时间差写回
+//   fast     —— 同上，但 rx 立即写回、自动寻卡间隔为0：按事件推进记录的时间线（虚拟时间），
+//               空闲等待全部省掉，输出记录时长与实际耗时之比
+//   decode   —— 不经会话，把记录里的 rx 按原来的分段喂给 FrameDecoder + IEEE1443Package，
+//               重复若干轮，输出 MB/s 与每秒帧数
+// 会话发出的帧与记录对不上时（例如回放时卡内容缓存为空、没有闸口判定去设置“等待拿走”），
+// 依次尝试：往后若干条 tx 里找相同的帧；找相同命令码的（寻卡则一直找到末尾）；
+// 都没有则不应答，由会话自己超时重发。各种情况分别计数。
+// 命令超时仍由会话里的 QTimer 按实际时间计，所以只有应答及时的部分能真正加速。
+//
+// 构建运行：qmake && make && ./rfid-replay [-m realtime|fast|decode] [-l 通道] [-r 轮数]
+//          [-o 回放记录] [-v] 收发记录
+
+#include <QCoreApplication>
+#include <QAtomicInt>
+#include <QElapsedTimer>
+#include <QMap>
+#include <QStringList>
+#include <QThread>
+#include <QVector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+#include <rfidWidget/IEEE1443Package.h>
+#include <rfidWidget/FrameDecoder.h>
+#include <rfidWidget/FrameTrace.h>
+#include <rfidWidget/ReaderSession.h>
+
+//对不上时往后找相同帧、相同命令码的范围（tx 条数）
+static const int kResyncWindow = 16;
+
+// 会话的调试日志回放时丢掉，警告照常打印
+static void quietHandler(QtMsgType type, const char *msg)
+{
+    if(type != QtDebugMsg)
+        fprintf(stderr, "%s\n", msg);
+}
+
+static void usage()
+{
+    fprintf(stderr, "usage: rfid-replay [-m realtime|fast|decode] [-l lane] [-r rounds] [-o out.trace] [-v] trace\n");
+}
+
+
+// === 记录应答方 ===
+// 在伪终端主端拆出会话发来的帧，按记录找到对应的 tx，把其后的 rx 写回。
+class TracePlayer : public QThread
+{
+public:
+    struct Step
+    {
+        qint64 timeNs;
+        FrameTrace::Direction dir;
+        QByteArray bytes;       // 原始线路字节
+        QByteArray frame;       // tx：去转义后的整帧，用于比对
+        quint8 command;         // tx：命令码，解不出为0
+    };
+
+    struct Counts
+    {
+        int matched;            // 与记录的下一条 tx 相同
+        int resynced;           // 往后找到相同的帧
+        int substituted;        // 只找到相同命令码的，用它的回包
+        int unanswered;         // 没有可用的回包
+        int skippedTx;          // 跳过的记录 tx 条数
+        int rxWrites;
+        qint64 rxBytes;
+        Counts() : matched(0), resynced(0), substituted(0), unanswered(0), skippedTx(0),
+            rxWrites(0), rxBytes(0) {}
+    };
+
+    TracePlayer(int fd, const QVector<Step> &steps, bool fast) :
+        masterFd(fd), steps(steps), fast(fast), cursor(0), virtualMs(0), stopRequested(false)
+    {
+        //第一条 tx 之前的 rx 属于导出窗口之外的命令，丢掉
+        while(cursor < steps.size() && steps.at(cursor).dir != FrameTrace::Tx)
+            cursor++;
+        startNs = cursor < steps.size() ? steps.at(cursor).timeNs : 0;
+    }
+
+    void requestStop() {
+        stopRequested = true;
+    }
+    // 已推进到的记录时间（相对第一条 tx），任意线程可读
+    int virtualElapsedMs() const {
+        return const_cast<QAtomicInt &>(virtualMs).fetchAndAddRelaxed(0);
+    }
+    // 以下在线程结束后读
+    Counts counts() const {
+        return _counts;
+    }
+
+protected:
+    void run()
+    {
+        FrameDecoder decoder;
+        FrameDecoder::Frame f;
+        char buf[256];
+        while(!stopRequested)
+        {
+            //1.记录用完、回包都写出后结束
+            if(cursor >= steps.size() && pending.isEmpty())
+                break;
+            int waitMs = 50;
+            if(!pending.isEmpty())
+                waitMs = (int)qBound((qint64)0, (pending.first().dueNs - FrameTrace::monotonicNs()) / 1000000, (qint64)50);
+            struct pollfd pfd;
+            pfd.fd = masterFd;
+            pfd.events = POLLIN;
+            pfd.revents = 0;
+            if(::poll(&pfd, 1, waitMs) > 0)
+            {
+                int n = ::read(masterFd, buf, sizeof(buf));
+                if(n > 0)
+                {
+                    decoder.push(buf, n);
+                    while(decoder.next(f))
+                        answer(QByteArray((const char *)f.data, f.size));
+                }
+            }
+            //2.到时的回包按记录的分段写出
+            qint64 now = FrameTrace::monotonicNs();
+            while(!pending.isEmpty() && pending.first().dueNs <= now)
+            {
+                const QByteArray &raw = pending.first().bytes;
+                ssize_t w = ::write(masterFd, raw.constData(), raw.size());
+                (void)w;
+                _counts.rxWrites++;
+                _counts.rxBytes += raw.size();
+                pending.removeFirst();
+            }
+        }
+    }
+
+private:
+    struct Pending
+    {
+        qint64 dueNs;
+        QByteArray bytes;
+    };
+
+    // 功能：下一条 tx 的下标，没有则 -1。
+    int nextTx(int from) const
+    {
+        for(int i = from; i < steps.size(); i++)
+        {
+            if(steps.at(i).dir == FrameTrace::Tx)
+                return i;
+        }
+        return -1;
+    }
+
+    // 功能：为会话发来的一帧找记录里对应的 tx。
+    int locate(const QByteArray &frame, quint8 command)
+    {
+        //1.下一条，或窗口内相同的帧
+        int i = nextTx(cursor);
+        for(int n = 0; i >= 0 && n < kResyncWindow; n++, i = nextTx(i + 1))
+        {
+            if(steps.at(i).frame == frame)
+            {
+                if(n == 0)
+                    _counts.matched++;
+                else
+                    _counts.resynced++;
+                return i;
+            }
+        }
+        //2.相同命令码；寻卡是每条寻卡链的起点，一直找到末尾
+        i = nextTx(cursor);
+        for(int n = 0; i >= 0 && (n < kResyncWindow || command == IEEE1443Package::SearchCard);
+            n++, i = nextTx(i + 1))
+        {
+            if(steps.at(i).command == command)
+            {
+                _counts.substituted++;
+                return i;
+            }
+        }
+        return -1;
+    }
+
+    // 功能：应答一帧：排上记录里这条 tx 之后、下一条 tx 之前的全部 rx。
+    void answer(const QByteArray &frame)
+    {
+        IEEE1443Package pkg((const quint8 *)frame.constData(), frame.size());
+        quint8 command = pkg.isValid() ? pkg.command() : 0;
+        int k = locate(frame, command);
+        if(k < 0)
+        {
+            _counts.unanswered++;
+            //后面已经没有寻卡：记录放完了
+            if(command == IEEE1443Package::SearchCard)
+                cursor = steps.size();
+            return;
+        }
+        for(int i = nextTx(cursor); i >= 0 && i < k; i = nextTx(i + 1))
+            _counts.skippedTx++;
+        const Step &tx = steps.at(k);
+        virtualMs.fetchAndStoreRelaxed((int)((tx.timeNs - startNs) / 1000000));
+        qint64 now = FrameTrace::monotonicNs();
+        cursor = k + 1;
+        while(cursor < steps.size() && steps.at(cursor).dir == FrameTrace::Rx)
+        {
+            const Step &rx = steps.at(cursor++);
+            Pending p;
+            p.dueNs = fast ? now : now + (rx.timeNs - tx.timeNs);
+            p.bytes = rx.bytes;
+            //会话重发时前一组回包可能还没写出，按到期时间插入
+            int at = pending.size();
+            while(at > 0 && pending.at(at - 1).dueNs > p.dueNs)
+                at--;
+            pending.insert(at, p);
+        }
+    }
+
+    int masterFd;
+    QVector<Step> steps;
+    bool fast;
+    int cursor;                 // 下一条未用的记录
+    qint64 startNs;
+    QList<Pending> pending;
+    Counts _counts;
+    QAtomicInt virtualMs;
+    volatile bool stopRequested;
+};
+
+
+// === 会话侧 ===
+// 统计会话给出的结果，-v 时逐条打印（带记录时间），便于与现场日志对照。
+class ReplayMonitor : public QObject
+{
+    Q_OBJECT
+
+public:
+    ReplayMonitor(ReaderSession *s, TracePlayer *p, bool verbose) :
+        cardsDetected(0), cardsLost(0), cardsRead(0), readFailures(0), writesOk(0), writesFailed(0),
+        commandFailures(0), player(p), verbose(verbose)
+    {
+        connect(s, SIGNAL(cardDetected(QString)), this, SLOT(onCardDetected(QString)));
+        connect(s, SIGNAL(cardLost()), this, SLOT(onCardLost()));
+        connect(s, SIGNAL(cardRead(QString,QByteArray,QByteArray)),
+                this, SLOT(onCardRead(QString,QByteArray,QByteArray)));
+        connect(s, SIGNAL(readFailed()), this, SLOT(onReadFailed()));
+        connect(s, SIGNAL(writeFinished(bool)), this, SLOT(onWriteFinished(bool)));
+        connect(s, SIGNAL(commandFailed(quint8)), this, SLOT(onCommandFailed(quint8)));
+    }
+
+    int cardsDetected;
+    int cardsLost;
+    int cardsRead;
+    int readFailures;
+    int writesOk;
+    int writesFailed;
+    int commandFailures;
+
+private slots:
+    void onCardDetected(const QString &cardId)
+    {
+        cardsDetected++;
+        log(QString("cardDetected %1").arg(cardId));
+    }
+
+    void onCardLost()
+    {
+        cardsLost++;
+        log("cardLost");
+    }
+
+    void onCardRead(const QString &cardId, const QByteArray &block1, const QByteArray &block2)
+    {
+        cardsRead++;
+        log(QString("cardRead %1 %2 %3").arg(cardId)
+            .arg(QString(block1.toHex())).arg(QString(block2.toHex())));
+    }
+
+    void onReadFailed()
+    {
+        readFailures++;
+        log("readFailed");
+    }
+
+    void onWriteFinished(bool ok)
+    {
+        if(ok)
+            writesOk++;
+        else
+            writesFailed++;
+        log(QString("writeFinished %1").arg(ok ? "ok" : "failed"));
+    }
+
+    void onCommandFailed(quint8 command)
+    {
+        commandFailures++;
+        log(QString("commandFailed 0x%1").arg(command, 2, 16, QChar('0')));
+    }
+
+private:
+    void log(const QString &event)
+    {
+        if(verbose)
+            printf("%10.3f %s\n", player->virtualElapsedMs() / 1000.0, qPrintable(event));
+    }
+
+    TracePlayer *player;
+    bool verbose;
+};
+
+
+// === 只拆帧 ===
+// 功能：各通道的 rx 分段按原顺序喂给各自的拆帧器，重复 rounds 轮。
+static int runDecode(const QList<FrameTrace::Entry> &entries, int rounds)
+{
+    QMap<int, QList<QByteArray> > chunks;
+    qint64 bytes = 0;
+    for(int i = 0; i < entries.size(); i++)
+    {
+        const FrameTrace::Entry &e = entries.at(i);
+        if(e.dir != FrameTrace::Rx)
+            continue;
+        chunks[e.lane].append(e.bytes);
+        bytes += e.bytes.size();
+    }
+    if(bytes == 0)
+    {
+        fprintf(stderr, "no rx records\n");
+        return 1;
+    }
+    qint64 frames = 0;
+    qint64 invalid = 0;
+    quint32 resyncs = 0;
+    quint32 overflows = 0;
+    quint32 checksum = 0;
+    QElapsedTimer t;
+    t.start();
+    for(int r = 0; r < rounds; r++)
+    {
+        QMap<int, QList<QByteArray> >::const_iterator it;
+        for(it = chunks.constBegin(); it != chunks.constEnd(); ++it)
+        {
+            FrameDecoder d;
+            FrameDecoder::Frame f;
+            const QList<QByteArray> &lane = it.value();
+            for(int i = 0; i < lane.size(); i++)
+            {
+                d.push(lane.at(i).constData(), lane.at(i).size());
+                while(d.next(f))
+                {
+                    IEEE1443Package p(f.data, f.size);
+                    if(!p.isValid())
+                    {
+                        invalid++;
+                        continue;
+                    }
+                    frames++;
+                    checksum += p.command() + p.dataLen();
+                }
+            }
+            resyncs += d.resyncCount();
+            overflows += d.overflowCount();
+        }
+    }
+    qint64 ns = t.nsecsElapsed();
+    double secs = ns / 1e9;
+    printf("lanes: %d, rx bytes: %lld, rounds: %d\n", chunks.size(), (long long)bytes, rounds);
+    printf("decode %8.1f MB/s  %8.2f Mframes/s  %6.1f ns/frame  (frames=%lld invalid=%lld resyncs=%u overflows=%u sum=%u)\n",
+           bytes * rounds / secs / (1024.0 * 1024.0), frames / secs / 1e6,
+           frames ? (double)ns / frames : 0.0, (long long)frames, (long long)invalid,
+           resyncs, overflows, checksum);
+    return 0;
+}
+
+// 功能：取出一条通道的记录，tx 预先拆帧以便比对。
+static QVector<TracePlayer::Step> laneSteps(const QList<FrameTrace::Entry> &entries, int lane)
+{
+    QVector<TracePlayer::Step> steps;
+    FrameDecoder d;
+    FrameDecoder::Frame f;
+    for(int i = 0; i < entries.size(); i++)
+    {
+        const FrameTrace::Entry &e = entries.at(i);
+        if(e.lane != lane)
+            continue;
+        TracePlayer::Step s;
+        s.timeNs = e.timeNs;
+        s.dir = e.dir;
+        s.bytes = e.bytes;
+        s.command = 0;
+        if(e.dir == FrameTrace::Tx)
+        {
+            //一次写出的就是一整帧
+            d.reset();
+            d.push(e.bytes.constData(), e.bytes.size());
+            if(d.next(f))
+            {
+                s.frame = QByteArray((const char *)f.data, f.size);
+                IEEE1443Package p(f.data, f.size);
+                if(p.isValid())
+                    s.command = p.command();
+            }
+        }
+        steps.append(s);
+    }
+    return steps;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    qInstallMsgHandler(quietHandler);
+
+    //1.参数
+    QString mode = "fast";
+    QString tracePath;
+    QString outPath;
+    int lane = -1;
+    int rounds = 20;
+    bool verbose = false;
+    QStringList args = app.arguments();
+    for(int i = 1; i < args.size(); i++)
+    {
+        const QString &a = args.at(i);
+        if(a == "-m" && i + 1 < args.size())
+            mode = args.at(++i);
+        else if(a == "-l" && i + 1 < args.size())
+            lane = args.at(++i).toInt();
+        else if(a == "-r" && i + 1 < args.size())
+            rounds = args.at(++i).toInt();
+        else if(a == "-o" && i + 1 < args.size())
+            outPath = args.at(++i);
+        else if(a == "-v")
+            verbose = true;
+        else if(!a.startsWith("-") && tracePath.isEmpty())
+            tracePath = a;
+        else
+        {
+            usage();
+            return 2;
+        }
+    }
+    if(tracePath.isEmpty() || (mode != "realtime" && mode != "fast" && mode != "decode"))
+    {
+        usage();
+        return 2;
+    }
+    if(rounds <= 0)
+        rounds = 20;
+
+    QList<FrameTrace::Entry> entries;
+    QString error;
+    if(!FrameTrace::load(tracePath, &entries, &error))
+    {
+        fprintf(stderr, "%s\n", qPrintable(error));
+        return 1;
+    }
+    if(mode == "decode")
+        return runDecode(entries, rounds);
+
+    //2.选通道：默认记录里第一条
+    if(lane < 0 && !entries.isEmpty())
+        lane = entries.first().lane;
+    QVector<TracePlayer::Step> steps = laneSteps(entries, lane);
+    int txCount = 0;
+    for(int i = 0; i < steps.size(); i++)
+    {
+        if(steps.at(i).dir == FrameTrace::Tx)
+            txCount++;
+    }
+    if(txCount == 0)
+    {
+        fprintf(stderr, "no tx records for lane %d\n", lane);
+        return 1;
+    }
+
+    //3.伪终端
+    int masterFd = ::posix_openpt(O_RDWR | O_NOCTTY);
+    if(masterFd < 0 || ::grantpt(masterFd) != 0 || ::unlockpt(masterFd) != 0)
+    {
+        perror("posix_openpt");
+        return 1;
+    }
+    struct termios tio;
+    ::tcgetattr(masterFd, &tio);
+    ::cfmakeraw(&tio);
+    ::tcsetattr(masterFd, TCSANOW, &tio);
+    QString slaveName = QString::fromLocal8Bit(::ptsname(masterFd));
+
+    //4.应答方和真实会话；快放时有卡无卡都按下限连续寻卡
+    bool fast = (mode == "fast");
+    TracePlayer player(masterFd, steps, fast);
+    ReaderSession session;
+    session.trace().setLane(lane);
+    if(!session.open(slaveName))
+    {
+        fprintf(stderr, "failed to open %s\n", qPrintable(slaveName));
+        ::close(masterFd);
+        return 1;
+    }
+    if(fast)
+        session.setAutoSearchCadence(0, 0);
+    ReplayMonitor monitor(&session, &player, verbose);
+    QObject::connect(&player, SIGNAL(finished()), &app, SLOT(quit()));
+    player.start();
+    session.startAutoSearch();
+    QElapsedTimer wall;
+    wall.start();
+    app.exec();
+    qint64 wallMs = wall.elapsed();
+
+    session.close();
+    player.requestStop();
+    player.wait();
+    ::close(masterFd);
+
+    //5.报告
+    TracePlayer::Counts c = player.counts();
+    qint64 spanMs = (steps.last().timeNs - steps.first().timeNs) / 1000000;
+    printf("trace: %s, lane %d, mode %s, records %d (tx %d)\n",
+           qPrintable(tracePath), lane, qPrintable(mode), steps.size(), txCount);
+    printf("tx: matched %d, resynced %d, substituted %d, unanswered %d, skipped %d\n",
+           c.matched, c.resynced, c.substituted, c.unanswered, c.skippedTx);
+    printf("rx: writes %d, bytes %lld\n", c.rxWrites, (long long)c.rxBytes);
+    printf("time: trace %.3f s, wall %.3f s, speedup %.1fx\n",
+           spanMs / 1000.0, wallMs / 1000.0, wallMs > 0 ? (double)spanMs / wallMs : 0.0);
+    printf("session: detected %d, lost %d, read %d, readFailed %d, write ok %d, write failed %d, commandFailed %d\n",
+           monitor.cardsDetected, monitor.cardsLost, monitor.cardsRead, monitor.readFailures,
+           monitor.writesOk, monitor.writesFailed, monitor.commandFailures);
+    printf("%s\n", qPrintable(session.metrics().snapshot().toText()));
+    //回放时会话自己的收发记录，可与原记录逐行对照
+    if(!outPath.isEmpty() && !session.trace().dump(outPath, "replay " + tracePath, &error))
+    {
+        fprintf(stderr, "%s\n", qPrintable(error));
+        return 1;
+    }
+    return 0;
+}
+
+#include "main.moc"
@@ -0,0 +1,17 @@
+#-------------------------------------------------
+#
+# 收发记录回放：把 FrameTrace 导出的记录喂给真实 ReaderSession（按记录时间或快放）或只喂拆帧器
+#
+#-------------------------------------------------
+
+QT       += core
+QT       -= gui
+
+TARGET = rfid-replay
+CONFIG   += console
+CONFIG   -= app_bundle
+TEMPLATE = app
+
+SOURCES += main.cpp
+
+include(../rfidWidget/readersession.pri)
@@ -0,0 +1,129 @@
+#include "CardTable.h"
+
+//最小容量（2的幂）
+static const int kMinCapacity = 16;
+
+// 功能：64位混合（splitmix64 收尾），UID 低位相近时也能散开。
+static inline quint64 mix(quint64 x)
+{
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+CardTable::CardTable(int expectedCards) :
+    used(0),
+    tombstones(0),
+    mask(0)
+{
+    rehash(kMinCapacity);
+    reserve(expectedCards);
+}
+
+// 删除标记：长度字节为0xFF，不会是有效UID
+CardUid CardTable::tombstone()
+{
+    return CardUid::fromValue(~Q_UINT64_C(0));
+}
+
+// 功能：预留容量，装入 expectedCards 张卡前不再重建。
+void CardTable::reserve(int expectedCards)
+{
+    int capacity = buckets.size();
+    while(expectedCards * 4 >= capacity * 3)
+        capacity *= 2;
+    if(capacity != buckets.size())
+        rehash(capacity);
+}
+
+// 功能：线性探测查找，遇到空槽结束。
+int CardTable::probe(const CardUid &uid) const
+{
+    if(!isLive(uid))
+        return -1;
+    int i = (int)(mix(uid.value()) & mask);
+    for(;;)
+    {
+        const CardUid &k = buckets.at(i).uid;
+        if(k == uid)
+            return i;
+        if(k.isNull())
+            return -1;
+        i = (i + 1) & mask;
+    }
+}
+
+CardTable::Record *CardTable::find(const CardUid &uid)
+{
+    int i = probe(uid);
+    return i < 0 ? NULL : &buckets[i];
+}
+
+const CardTable::Record *CardTable::find(const CardUid &uid) const
+{
+    int i = probe(uid);
+    return i < 0 ? NULL : &buckets.at(i);
+}
+
+// 功能：查找记录，不存在时新建；新建可能触发重建，之前取得的指针失效。
+CardTable::Record &CardTable::insert(const CardUid &uid)
+{
+    int found = probe(uid);
+    if(found >= 0)
+        return buckets[found];
+    //1.装载（含删除标记）超过3/4：删除标记多就原容量重建，否则翻倍
+    if((used + tombstones + 1) * 4 > buckets.size() * 3)
+        rehash((used + 1) * 2 > buckets.size() ? buckets.size() * 2 : buckets.size());
+    //2.放进第一个空槽或删除标记
+    int i = (int)(mix(uid.value()) & mask);
+    while(isLive(buckets.at(i).uid))
+        i = (i + 1) & mask;
+    if(!buckets.at(i).uid.isNull())
+        tombstones--;
+    Record &r = buckets[i];
+    r = Record();
+    r.uid = uid;
+    used++;
+    return r;
+}
+
+bool CardTable::remove(const CardUid &uid)
+{
+    int i = probe(uid);
+    if(i < 0)
+        return false;
+    buckets[i] = Record();
+    buckets[i].uid = tombstone();
+    used--;
+    tombstones++;
+    return true;
+}
+
+void CardTable::clear()
+{
+    buckets.fill(Record());
+    used = 0;
+    tombstones = 0;
+}
+
+// 功能：按新容量重新放置全部有效记录，同时清掉删除标记。
+void CardTable::rehash(int newCapacity)
+{
+    QVector<Record> old = buckets;
+    buckets = QVector<Record>(newCapacity);
+    mask = newCapacity - 1;
+    tombstones = 0;
+    for(int j = 0; j < old.size(); j++)
+    {
+        const Record &r = old.at(j);
+        if(!isLive(r.uid))
+            continue;
+        int i = (int)(mix(r.uid.value()) & mask);
+        while(!buckets.at(i).uid.isNull())
+            i = (i + 1) & mask;
+        buckets[i] = r;
+    }
+}
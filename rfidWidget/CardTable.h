@@ -0,0 +1,63 @@
+#ifndef CARDTABLE_H
+#define CARDTABLE_H
+
+#include <QVector>
+#include "CardUid.h"
+#include "TagInfo.h"
+
+// 按卡号索引的停车记录表：一张卡一条记录，入场、历史入场、历史出场时间和在场卡信息放在一起。
+// 开放寻址（线性探测），容量为2的幂，装载（含删除标记）超过 3/4 时翻倍重建；
+// 记录连续存放，查找只比较一个 quint64，没有逐节点分配。
+// 不加锁，由 ParkingStore 的锁保护。
+class CardTable
+{
+public:
+    struct Record
+    {
+        CardUid uid;
+        qint64 entryMs;         // 当前入场时间（ms since epoch），-1 不在场
+        qint64 lastEntryMs;     // 历史入场时间，-1 没有
+        qint64 lastExitMs;      // 历史出场时间，-1 没有
+        TagInfo info;           // 在场时的卡信息
+        Record() : entryMs(-1), lastEntryMs(-1), lastExitMs(-1) {}
+        bool isParked() const {
+            return entryMs >= 0;
+        }
+    };
+
+    explicit CardTable(int expectedCards = 0);
+
+    Record *find(const CardUid &uid);
+    const Record *find(const CardUid &uid) const;
+    Record &insert(const CardUid &uid);//查找，不存在则新建空记录
+    bool remove(const CardUid &uid);
+    void clear();
+    void reserve(int expectedCards);
+
+    int size() const {
+        return used;
+    }
+    // 按槽位遍历：空槽和删除标记返回NULL
+    int slotCount() const {
+        return buckets.size();
+    }
+    const Record *slotAt(int i) const {
+        const Record &r = buckets.at(i);
+        return isLive(r.uid) ? &r : NULL;
+    }
+
+private:
+    static bool isLive(const CardUid &uid) {
+        return !uid.isNull() && uid != tombstone();
+    }
+    static CardUid tombstone();
+    int probe(const CardUid &uid) const;//返回记录所在槽位，不存在返回-1
+    void rehash(int newCapacity);
+
+    QVector<Record> buckets;
+    int used;                   // 有效记录数
+    int tombstones;             // 删除标记数
+    int mask;                   // 容量-1
+};
+
+#endif // CARDTABLE_H
@@ -0,0 +1,117 @@
+#ifndef CARDUID_H
+#define CARDUID_H
+
+#include <QByteArray>
+#include <QString>
+#include <QHash>
+
+// 卡号（防冲突得到的UID）的定长表示：一个 quint64。
+// 低56位放UID字节（大端，和十六进制字符串同序），最高字节放UID长度，
+// 所以 4 字节的 00000001 和 7 字节的 00000000000001 不会相等。
+// 14443 的单/双倍长度UID（4、7字节）都放得下；更长的UID视为无效（isNull）。
+// 界面和信号里仍用十六进制字符串（d.toHex()），进出表、查表时才转换。
+class CardUid
+{
+public:
+    enum { MaxBytes = 7 };
+
+    CardUid() : v(0) {}
+
+    // value() 的逆变换，用于存盘后读回
+    static CardUid fromValue(quint64 value)
+    {
+        CardUid u;
+        u.v = value;
+        return u;
+    }
+    static CardUid fromBytes(const char *p, int n)
+    {
+        CardUid u;
+        if(n <= 0 || n > MaxBytes)
+            return u;
+        quint64 x = 0;
+        for(int i = 0; i < n; i++)
+            x = (x << 8) | (uchar)p[i];
+        u.v = ((quint64)n << 56) | x;
+        return u;
+    }
+    static CardUid fromBytes(const QByteArray &b)
+    {
+        return fromBytes(b.constData(), b.size());
+    }
+    // 十六进制卡号（大小写均可），长度为奇数、超长或含非法字符时返回无效卡号
+    static CardUid fromHex(const QString &hex)
+    {
+        CardUid u;
+        int len = hex.size();
+        if(len == 0 || (len & 1) || len > MaxBytes * 2)
+            return u;
+        quint64 x = 0;
+        for(int i = 0; i < len; i++)
+        {
+            int d = hexDigit(hex.at(i).toLatin1());
+            if(d < 0)
+                return u;
+            x = (x << 4) | d;
+        }
+        u.v = ((quint64)(len / 2) << 56) | x;
+        return u;
+    }
+
+    // 和 QByteArray::toHex() 相同的小写十六进制
+    QString toHex() const
+    {
+        static const char digits[] = "0123456789abcdef";
+        char buf[MaxBytes * 2];
+        int n = size();
+        if(n > MaxBytes)
+            return QString();
+        for(int i = 0; i < n; i++)
+        {
+            uchar b = (uchar)(v >> (8 * (n - 1 - i)));
+            buf[2 * i] = digits[b >> 4];
+            buf[2 * i + 1] = digits[b & 0x0F];
+        }
+        return QString::fromLatin1(buf, n * 2);
+    }
+
+    bool isNull() const {
+        return v == 0;
+    }
+    int size() const {
+        return (int)(v >> 56);
+    }
+    quint64 value() const {
+        return v;
+    }
+    bool operator==(const CardUid &o) const {
+        return v == o.v;
+    }
+    bool operator!=(const CardUid &o) const {
+        return v != o.v;
+    }
+    bool operator<(const CardUid &o) const {
+        return v < o.v;
+    }
+
+private:
+    static int hexDigit(char c)
+    {
+        if(c >= '0' && c <= '9')
+            return c - '0';
+        if(c >= 'a' && c <= 'f')
+            return c - 'a' + 10;
+        if(c >= 'A' && c <= 'F')
+            return c - 'A' + 10;
+        return -1;
+    }
+
+    quint64 v;
+};
+
+inline uint qHash(const CardUid &uid)
+{
+    return qHash(uid.value());
+}
+
+#endif // CARDUID_H
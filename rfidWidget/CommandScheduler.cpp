@@ -0,0 +1,418 @@
+#include "CommandScheduler.h"
+#include "IEEE1443Package.h"
+#include "ReaderIoThread.h"
+#include <QTimer>
+
+//最长线路帧：长度字段1字节，内容区全部转义
+static const int kMaxRawPackageSize = 1 + (2 + 1 + 255) * 2 + 1;
+//计时粒度：偏差项至少取这么多（QTimer毫秒级，界面线程还会有抖动）
+static const qint64 kClockGranularityUs = 10000;
+
+CommandScheduler::CommandScheduler(QObject *parent) :
+    QObject(parent),
+    readerIo(NULL),
+    replyTimer(NULL),
+    replyTimeoutMs(400),
+    minReplyTimeoutMs(50),
+    maxReplyTimeoutMs(2000),
+    maxRetries(2),
+    busy(false),
+    dispatchDeferred(false),
+    retries(0),
+    dispatchSeq(0),
+    inCallback(0),
+    continuationPos(0),
+    recentHead(0),
+    recentCount(0),
+    replyPending(false)
+{
+    replyTimer = new QTimer(this);
+    replyTimer->setSingleShot(true);
+    replyTimer->setInterval(replyTimeoutMs);
+    connect(replyTimer, SIGNAL(timeout()), this, SLOT(onReplyTimeout()));
+    replyClock.start();
+}
+
+// 功能：接管收发线程的收包队列。
+void CommandScheduler::attach(ReaderIoThread *io)
+{
+    detach();
+    readerIo = io;
+    //换了读卡器，之前的往返时间不再适用
+    rtt.clear();
+    if(readerIo)
+        connect(readerIo, SIGNAL(framesAvailable()), this, SLOT(drainReplies()));
+}
+
+// 功能：放开收发线程，丢弃所有命令。收发线程停止前调用。
+void CommandScheduler::detach()
+{
+    if(readerIo)
+        disconnect(readerIo, 0, this, 0);
+    readerIo = NULL;
+    clear();
+}
+
+void CommandScheduler::setReplyTimeout(int ms)
+{
+    replyTimeoutMs = ms;
+}
+
+void CommandScheduler::setReplyTimeoutRange(int minMs, int maxMs)
+{
+    minReplyTimeoutMs = qMax(1, minMs);
+    maxReplyTimeoutMs = qMax(minReplyTimeoutMs, maxMs);
+}
+
+void CommandScheduler::setMaxRetries(int n)
+{
+    maxRetries = n;
+}
+
+bool CommandScheduler::submit(const QByteArray &rawPackage, quint8 command, Handler *handler, int tag)
+{
+    if(!readerIo || rawPackage.isEmpty())
+        return false;
+    Command cmd;
+    cmd.raw = rawPackage;
+    cmd.code = command;
+    cmd.tag = tag;
+    cmd.handler = handler;
+    enqueue(cmd);
+    return true;
+}
+
+bool CommandScheduler::submit(const IEEE1443Package &pkg, Handler *handler, int tag)
+{
+    if(!readerIo || !pkg.isValid() || pkg.maxRawSize() > kMaxRawPackageSize)
+        return false;
+    //按最坏情况编码到栈上，只为实际长度分配一次；发送队列和重发共用这一份（引用计数）
+    char buf[kMaxRawPackageSize];
+    Command cmd;
+    cmd.raw = QByteArray(buf, pkg.encodeRaw(buf));
+    cmd.code = pkg.command();
+    cmd.tag = tag;
+    cmd.handler = handler;
+    enqueue(cmd);
+    return true;
+}
+
+// 功能：丢弃正在等待和排队的命令以及重复包记录。
+void CommandScheduler::clear()
+{
+    queue.clear();
+    continuationPos = 0;
+    if(busy)
+        finishCurrent();
+    replyTimer->stop();
+    dispatchDeferred = false;
+    recentCount = 0;
+}
+
+// 功能：命令入队，空闲时立即发出。
+void CommandScheduler::enqueue(const Command &cmd)
+{
+    if(inCallback > 0)
+    {
+        //回调中提交的是当前流程的后续步骤，插到已排队命令之前，保持提交顺序
+        if(continuationPos > queue.size())
+            continuationPos = queue.size();
+        queue.insert(continuationPos++, cmd);
+    }
+    else
+        queue.append(cmd);
+    if(!busy)
+        dispatchNext();
+}
+
+// 功能：发出队首命令并开始计时。
+void CommandScheduler::dispatchNext()
+{
+    if(busy || dispatchDeferred || queue.isEmpty() || !readerIo)
+        return;
+    current = queue.takeFirst();
+    if(continuationPos > 0)
+        continuationPos--;
+    busy = true;
+    retries = 0;
+    dispatchSeq++;
+
+    //发送队列满：收发线程写不动串口，等回包超时没有意义，直接失败；
+    //下一条推到事件循环里发，失败回调里提交的命令只入队，不在这里递归
+    if(!readerIo->send(current.raw))
+    {
+        _metrics.add(LaneMetrics::TxRejected);
+        dispatchDeferred = true;
+        QTimer::singleShot(0, this, SLOT(resumeDispatch()));
+        failCurrent();
+        return;
+    }
+    firstSent.start();
+    lastSent = firstSent;
+    startReplyTimeout();
+    _stats.dispatched++;
+    _metrics.add(LaneMetrics::Dispatched);
+    _metrics.addCommand(current.code, LaneMetrics::CommandSent);
+
+    //记录回包到下一条命令发出之间的空档
+    if(replyPending)
+    {
+        qint64 gap = replyLanded.nsecsElapsed();
+        _stats.gaps++;
+        _stats.gapNsTotal += gap;
+        if(gap > _stats.gapNsMax)
+            _stats.gapNsMax = gap;
+        replyPending = false;
+    }
+}
+
+// 功能：发送队列满之后，回到事件循环再接着发队列里的命令。
+void CommandScheduler::resumeDispatch()
+{
+    dispatchDeferred = false;
+    dispatchNext();
+}
+
+// 功能：结束当前命令。
+void CommandScheduler::finishCurrent()
+{
+    busy = false;
+    replyTimer->stop();
+    current = Command();
+}
+
+// 功能：依次取出收发线程已拆好的帧并交给当前命令。
+void CommandScheduler::drainReplies()
+{
+    if(!readerIo)
+        return;
+    readerIo->rearmNotify();
+    IEEE1443Package p;
+    while(readerIo && readerIo->takeFrame(p))
+        handleReply(p);
+}
+
+// 功能：匹配回包，回调完成函数后发出下一条命令。
+void CommandScheduler::handleReply(const IEEE1443Package &reply)
+{
+    //1.前置检验：没有等待的命令或命令码不匹配
+    if(!reply.isValid())
+        return;
+    if(!busy || reply.command() != current.code)
+    {
+        _metrics.add(LaneMetrics::UnmatchedReplies);
+        return;
+    }
+    if(isDuplicateResponse(reply))//避免重复响应
+    {
+        _metrics.add(LaneMetrics::DuplicatesDropped);
+        return;
+    }
+
+    //2.结束当前命令再回调，回调里提交的命令可以立即发出
+    sampleRtt(reply);
+    _metrics.addCommand(current.code, LaneMetrics::CommandReplied);
+    _metrics.recordLatency(current.code, firstSent.nsecsElapsed() / 1000);
+    replyLanded.start();
+    replyPending = true;
+    Command done = current;
+    finishCurrent();
+
+    int savedPos = continuationPos;
+    continuationPos = 0;
+    inCallback++;
+    if(done.handler)
+        done.handler->commandReplied(done.code, done.tag, reply);
+    inCallback--;
+    continuationPos = savedPos;
+
+    //3.回调没有提交后续命令时，接着发队列里的下一条
+    dispatchNext();
+    replyPending = false;
+}
+
+// 功能：等待回包超时，重发或放弃当前命令。
+void CommandScheduler::onReplyTimeout()
+{
+    //界面卡顿期间回包可能已在队列中，先处理队列再判断是否真的超时
+    drainReplies();
+    if(!busy || replyTimer->isActive())
+        return;
+    RttEstimate &e = rtt[current.code];
+    e.command = current.code;
+    e.replyTimeouts++;
+    _metrics.add(LaneMetrics::ReplyTimeouts);
+    if(retries < maxRetries && readerIo)
+    {
+        //线路帧原样重发，等待时间加倍
+        if(readerIo->send(current.raw))
+        {
+            retries++;
+            _stats.retried++;
+            _metrics.add(LaneMetrics::Retried);
+            _metrics.addCommand(current.code, LaneMetrics::CommandRetried);
+            lastSent.start();
+            startReplyTimeout();
+            return;
+        }
+        _metrics.add(LaneMetrics::TxRejected);
+        dispatchDeferred = true;
+        QTimer::singleShot(0, this, SLOT(resumeDispatch()));
+    }
+    else
+    {
+        e.failures++;
+        _stats.timedOut++;
+    }
+    failCurrent();
+}
+
+// 功能：放弃当前命令：回调 commandTimedOut()，再发下一条。
+void CommandScheduler::failCurrent()
+{
+    _metrics.add(LaneMetrics::Failed);
+    _metrics.addCommand(current.code, LaneMetrics::CommandFailed);
+    Command failed = current;
+    finishCurrent();
+
+    int savedPos = continuationPos;
+    continuationPos = 0;
+    inCallback++;
+    if(failed.handler)
+        failed.handler->commandTimedOut(failed.code, failed.tag);
+    inCallback--;
+    continuationPos = savedPos;
+
+    dispatchNext();
+}
+
+// 功能：按当前命令码的估计值和重发次数开始等待回包。
+void CommandScheduler::startReplyTimeout()
+{
+    int ms = replyTimeoutFor(current.code);
+    for(int i = 0; i < retries && ms < maxReplyTimeoutMs; i++)
+        ms *= 2;
+    replyTimer->start(qMin(ms, maxReplyTimeoutMs));
+}
+
+// 功能：命令码当前的等待时间：有采样时取 srtt + max(G, 4*rttvar)，否则取初始值。
+int CommandScheduler::replyTimeoutFor(quint8 command) const
+{
+    QHash<int, RttEstimate>::const_iterator it = rtt.constFind(command);
+    if(it == rtt.constEnd() || it.value().samples == 0)
+        return replyTimeoutMs;
+    return it.value().timeoutMs;
+}
+
+// 功能：用回包更新往返时间估计。
+void CommandScheduler::sampleRtt(const IEEE1443Package &reply)
+{
+    RttEstimate &e = rtt[reply.command()];
+    e.command = reply.command();
+    //1.确定样本：没重发过取首次发送时刻；重发过则无法分辨回的是哪一次（Karn），
+    //  只有回包比一个往返时间还快，才能断定回的是原命令，重发是多余的
+    qint64 sampleUs;
+    if(retries == 0)
+        sampleUs = firstSent.nsecsElapsed() / 1000;
+    else if(e.samples > 0 && lastSent.nsecsElapsed() / 1000 * 2 < e.srttUs)
+    {
+        e.spuriousRetries++;
+        _metrics.add(LaneMetrics::SpuriousRetries);
+        sampleUs = firstSent.nsecsElapsed() / 1000;
+    }
+    else
+        return;
+    //2.Jacobson/Karels：rttvar += (|err| - rttvar)/4，srtt += err/8
+    if(e.samples == 0)
+    {
+        e.srttUs = sampleUs;
+        e.rttvarUs = sampleUs / 2;
+    }
+    else
+    {
+        qint64 err = sampleUs - e.srttUs;
+        e.rttvarUs += ((err < 0 ? -err : err) - e.rttvarUs) / 4;
+        e.srttUs += err / 8;
+    }
+    e.samples++;
+    //3.等待时间 = srtt + max(G, 4*rttvar)，向上取整到毫秒并限制范围
+    qint64 rtoUs = e.srttUs + qMax(kClockGranularityUs, 4 * e.rttvarUs);
+    e.timeoutMs = qBound(minReplyTimeoutMs, (int)((rtoUs + 999) / 1000), maxReplyTimeoutMs);
+}
+
+QList<CommandScheduler::RttEstimate> CommandScheduler::rttEstimates() const
+{
+    QList<RttEstimate> list;
+    for(int code = 0; code < 256; code++)
+    {
+        QHash<int, RttEstimate>::const_iterator it = rtt.constFind(code);
+        if(it == rtt.constEnd())
+            continue;
+        RttEstimate e = it.value();
+        e.timeoutMs = replyTimeoutFor(code);
+        list.append(e);
+    }
+    return list;
+}
+
+// 功能：回包的64位哈希（FNV-1a），覆盖地址、命令码和数据。
+static quint64 replyHash(const IEEE1443Package &pkg)
+{
+    const quint64 kPrime = 1099511628211ULL;
+    quint64 h = 14695981039346656037ULL;
+    h = (h ^ (pkg.address() & 0xFF)) * kPrime;
+    h = (h ^ (pkg.address() >> 8)) * kPrime;
+    h = (h ^ pkg.command()) * kPrime;
+    const QByteArray &d = pkg.data();
+    const uchar *p = reinterpret_cast<const uchar *>(d.constData());
+    for(int i = 0; i < d.size(); i++)
+        h = (h ^ p[i]) * kPrime;
+    return h;
+}
+
+// 功能：判断是否为重复响应包（对已完成的重发命令的多余回复）。
+//       读卡器按顺序应答，旧命令的多余回包先于当前命令的回包到达：
+//       只有当前命令发出后来得比半个往返时间还快的才可能是重复包。
+bool CommandScheduler::isDuplicateResponse(const IEEE1443Package &pkg)
+{
+    const int kDuplicateWindowMs = 800;
+    qint64 now = replyClock.elapsed();
+    //1.过期：最旧的条目在环尾，依次出队
+    while(recentCount > 0)
+    {
+        const RecentReply &oldest = recentReplies[(recentHead - recentCount + kRecentReplySlots) % kRecentReplySlots];
+        if(now - oldest.acceptedMs <= kDuplicateWindowMs)
+            break;
+        recentCount--;
+    }
+    //2.窗口内有之前命令的同样内容、还欠着重复回包的记录，且回包对当前命令来说太快：丢掉
+    //  没有往返时间采样时分不清，按当前命令的回包接受
+    quint64 h = replyHash(pkg);
+    QHash<int, RttEstimate>::const_iterator it = rtt.constFind(current.code);
+    bool tooEarly = it != rtt.constEnd() && it.value().samples > 0
+            && firstSent.nsecsElapsed() / 1000 * 2 < it.value().srttUs;
+    for(int i = 0; tooEarly && i < recentCount; i++)
+    {
+        RecentReply &r = recentReplies[(recentHead - 1 - i + kRecentReplySlots) % kRecentReplySlots];
+        if(r.hash == h && r.pending > 0 && r.seq != dispatchSeq)
+        {
+            r.pending--;
+            return true;
+        }
+    }
+    //3.接受：这是当前命令的回包，之前命令的多余回包按顺序都已过去，旧记录作废；
+    //  当前命令重发过几次，之后就还可能再来几个同样的回包
+    recentCount = 0;
+    if(retries > 0)
+    {
+        RecentReply &r = recentReplies[recentHead];
+        r.hash = h;
+        r.seq = dispatchSeq;
+        r.acceptedMs = now;
+        r.pending = retries;
+        recentHead = (recentHead + 1) % kRecentReplySlots;
+        if(recentCount < kRecentReplySlots)
+            recentCount++;
+    }
+    return false;
+}
@@ -0,0 +1,182 @@
+#ifndef COMMANDSCHEDULER_H
+#define COMMANDSCHEDULER_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QList>
+#include <QHash>
+#include <QElapsedTimer>
+#include "LaneMetrics.h"
+
+class QTimer;
+class IEEE1443Package;
+class ReaderIoThread;
+
+// 读卡器命令调度器：命令排队，读卡器同一时刻只处理一条命令。
+// 每条命令带自己的完成回调（Handler + tag），回包到达后立即回调，
+// 回调返回后马上发出队列中的下一条，不靠标志位等下一次定时器。
+// 回调中提交的命令视为当前流程的后续步骤，排在已排队命令之前，
+// 所以“寻卡-防冲突-选卡-认证-读块”这样的链不会被中途插入的写卡打断。
+//
+// 超时由调度器负责：先取完收发线程队列里已到的回包，仍未回复才重发，
+// 重试用尽后回调 commandTimedOut() 并继续下一条。收发线程的发送队列满（串口写不动）时
+// 不再等超时，当即按失败回调，记为 TxRejected；之后的命令推到下一轮事件循环再发，
+// 失败回调里重新提交的命令不会在调用栈里层层递归，收发线程也有机会腾出队列。
+// 等待时间按命令码分别估计（Jacobson/Karels）：平滑往返时间 + 4倍偏差，
+// 限制在 [最小, 最大] 之间；每重发一次等待时间加倍。重发过的命令不采样（Karn），
+// 除非回包来得比往返时间还快——那是对原命令的回复，记为一次多余的重发。
+//
+// 重复包只可能来自重发：命令重发了 n 次，接受第一个回包后，同样内容的回包在窗口内
+// 还会再来至多 n 个。记录带上所属命令的发出序号，只在之后同码命令发出后
+// 不到半个往返时间就到的回包才当重复包丢掉——读卡器按顺序应答，旧命令的多余回包
+// 一定先于新命令的回包到达；来得更晚的同样内容是新命令自己的回包（重新寻卡、
+// 重读同一块），接受它并清掉旧记录。记录放在固定大小的环里（64位哈希 + 单调时钟），
+// 不分配内存，过期条目从环尾出队；墙上时间跳变不影响判断。
+//
+// 发出、重发、超时、重复包、不匹配回包和每个命令码的回包耗时分布记在 metrics() 里（原子计数），
+// 别的线程可以随时取快照。
+class CommandScheduler : public QObject
+{
+    Q_OBJECT
+
+public:
+    class Handler
+    {
+    public:
+        virtual ~Handler() {}
+        // 收到与命令匹配的回包（重复包已过滤）
+        virtual void commandReplied(quint8 command, int tag, const IEEE1443Package &reply) = 0;
+        // 重试用尽仍无回包，或发送队列满发不出去
+        virtual void commandTimedOut(quint8 command, int tag) = 0;
+    };
+
+    // 命令间隔统计：上一条回包到达 -> 下一条命令交给收发线程
+    struct Stats
+    {
+        quint32 dispatched;     // 发出的命令数（不含重发）
+        quint32 retried;        // 重发次数
+        quint32 timedOut;       // 重试用尽的命令数
+        quint32 gaps;           // 回包后紧接着发出下一条的次数
+        qint64 gapNsTotal;
+        qint64 gapNsMax;
+        Stats() : dispatched(0), retried(0), timedOut(0), gaps(0), gapNsTotal(0), gapNsMax(0) {}
+    };
+
+    // 单个命令码的往返时间估计与超时统计
+    struct RttEstimate
+    {
+        quint8 command;
+        qint64 srttUs;          // 平滑往返时间
+        qint64 rttvarUs;        // 往返时间偏差
+        int timeoutMs;          // 当前等待时间（首次发送）
+        quint32 samples;        // 有效采样数
+        quint32 replyTimeouts;  // 等待超时次数（含随后重发的）
+        quint32 spuriousRetries;// 原命令的回包晚到，重发其实多余
+        quint32 failures;       // 重试用尽
+        RttEstimate() : command(0), srttUs(0), rttvarUs(0), timeoutMs(0),
+            samples(0), replyTimeouts(0), spuriousRetries(0), failures(0) {}
+    };
+
+    explicit CommandScheduler(QObject *parent = 0);
+
+    void attach(ReaderIoThread *io);
+    void detach();
+
+    void setReplyTimeout(int ms);//还没有采样时的等待时间
+    void setReplyTimeoutRange(int minMs, int maxMs);//自适应等待时间的上下限
+    void setMaxRetries(int n);
+
+    // 提交已编码的线路帧（如 PrebuiltFrame），只增加引用计数
+    bool submit(const QByteArray &rawPackage, quint8 command, Handler *handler, int tag = 0);
+    // 提交可变数据的命令包：一次编码进栈上的定长缓冲区，再拷成恰好大小的线路帧
+    bool submit(const IEEE1443Package &pkg, Handler *handler, int tag = 0);
+
+    // 丢弃正在等待和排队的命令，不回调
+    void clear();
+
+    bool isIdle() const {
+        return !busy && queue.isEmpty();
+    }
+    int queuedCount() const {
+        return queue.size();
+    }
+    Stats stats() const {
+        return _stats;
+    }
+    // 各命令码当前的估计值，按命令码排序
+    QList<RttEstimate> rttEstimates() const;
+    int replyTimeoutFor(quint8 command) const;
+    // 通讯计数和回包耗时分布；会话也往里记认证/读写失败和放卡收卡
+    LaneMetrics &metrics() {
+        return _metrics;
+    }
+    const LaneMetrics &metrics() const {
+        return _metrics;
+    }
+
+public slots:
+    void drainReplies();
+
+private slots:
+    void onReplyTimeout();
+    void resumeDispatch();
+
+private:
+    struct Command
+    {
+        QByteArray raw;         // 已转义的线路帧，重发时原样写出
+        quint8 code;
+        int tag;
+        Handler *handler;
+        Command() : code(0), tag(0), handler(0) {}
+    };
+
+    void enqueue(const Command &cmd);
+    void dispatchNext();
+    void finishCurrent();
+    void failCurrent();
+    void handleReply(const IEEE1443Package &reply);
+    void startReplyTimeout();
+    void sampleRtt(const IEEE1443Package &reply);
+    bool isDuplicateResponse(const IEEE1443Package &reply);
+
+    ReaderIoThread *readerIo;
+    QTimer *replyTimer;
+    int replyTimeoutMs;
+    int minReplyTimeoutMs;
+    int maxReplyTimeoutMs;
+    int maxRetries;
+    QHash<int, RttEstimate> rtt;//按命令码
+    QElapsedTimer firstSent;    // 当前命令首次发出时刻
+    QElapsedTimer lastSent;     // 当前命令最近一次（重）发时刻
+
+    QList<Command> queue;
+    Command current;
+    bool busy;                  // current 已发出，等待回包
+    bool dispatchDeferred;      // 发送队列满，下一条等事件循环里的 resumeDispatch() 再发
+    int retries;
+    quint32 dispatchSeq;        // 当前命令的发出序号，每发出一条新命令加一（重发不加）
+    int inCallback;             // 回调嵌套深度，>0 时提交的命令插到队首
+    int continuationPos;        // 本次回调中已插入队首的命令数
+
+    // 重复包过滤：已接受的重发命令回包，按接受时间先后排列
+    struct RecentReply
+    {
+        quint64 hash;           // (地址, 命令码, 数据) 的哈希
+        quint32 seq;            // 所属命令的发出序号
+        qint64 acceptedMs;
+        int pending;            // 还可能到达的重复回包数
+    };
+    enum { kRecentReplySlots = 16 };
+    RecentReply recentReplies[kRecentReplySlots];
+    int recentHead;             // 下一条写入位置
+    int recentCount;
+    QElapsedTimer replyClock;   // 单调时钟
+
+    QElapsedTimer replyLanded;  // 最近一次回包到达时刻
+    bool replyPending;          // 正在处理回包，此时发出的命令计入空档统计
+    Stats _stats;
+    LaneMetrics _metrics;
+};
+
+#endif // COMMANDSCHEDULER_H
@@ -0,0 +1,154 @@
+#include "EscapeKernel.h"
+#include "IEEE1443Package.h"
+#include <string.h>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace EscapeKernel {
+
+static inline bool isSpecial(quint8 c)
+{
+    return c == IEEE1443_START_CODE || c == IEEE1443_STOP_CODE || c == IEEE1443_ESCAPE_CHAR;
+}
+
+#if defined(__AVX2__)
+
+enum { BlockSize = 32 };
+
+// 每个特殊字节对应掩码中的一位
+static inline quint32 specialMask(const quint8 *p)
+{
+    __m256i v = _mm256_loadu_si256((const __m256i *)p);
+    __m256i m = _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(IEEE1443_START_CODE)),
+                                _mm256_cmpeq_epi8(v, _mm256_set1_epi8(IEEE1443_STOP_CODE)));
+    m = _mm256_or_si256(m, _mm256_cmpeq_epi8(v, _mm256_set1_epi8(IEEE1443_ESCAPE_CHAR)));
+    return (quint32)_mm256_movemask_epi8(m);
+}
+
+#elif defined(__SSE2__)
+
+enum { BlockSize = 16 };
+
+static inline quint32 specialMask(const quint8 *p)
+{
+    __m128i v = _mm_loadu_si128((const __m128i *)p);
+    __m128i m = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(IEEE1443_START_CODE)),
+                             _mm_cmpeq_epi8(v, _mm_set1_epi8(IEEE1443_STOP_CODE)));
+    m = _mm_or_si128(m, _mm_cmpeq_epi8(v, _mm_set1_epi8(IEEE1443_ESCAPE_CHAR)));
+    return (quint32)_mm_movemask_epi8(m);
+}
+
+#else
+
+// 无SIMD时按机器字做SWAR比较（ARM等平台）
+typedef quintptr Word;
+
+enum { BlockSize = sizeof(Word) };
+
+static const Word kOnes = ~(Word)0 / 0xFF;             // 0x0101...01
+static const Word kHighs = kOnes * 0x80;                // 0x8080...80
+
+// 等于目标值的字节高位置1（精确版，不会误报相邻字节）
+static inline Word matchBytes(Word w, quint8 c)
+{
+    Word v = w ^ (kOnes * c);
+    return ~(((v & ~kHighs) + ~kHighs) | v | ~kHighs);
+}
+
+static inline quint32 specialMask(const quint8 *p)
+{
+    Word w;
+    memcpy(&w, p, sizeof(w));
+    Word m = matchBytes(w, IEEE1443_START_CODE)
+            | matchBytes(w, IEEE1443_STOP_CODE)
+            | matchBytes(w, IEEE1443_ESCAPE_CHAR);
+    if(!m)
+        return 0;
+    // 压缩成每字节一位，和SIMD路径的掩码格式一致
+    quint32 bits = 0;
+    for(int i = 0; i < (int)sizeof(Word); i++)
+    {
+        if(((const quint8 *)&m)[i])
+            bits |= 1u << i;
+    }
+    return bits;
+}
+
+#endif
+
+const quint8 *findSpecial(const quint8 *p, const quint8 *end)
+{
+    while(end - p >= BlockSize)
+    {
+        quint32 mask = specialMask(p);
+        if(mask)
+            return p + __builtin_ctz(mask);
+        p += BlockSize;
+    }
+    for(; p < end; p++)
+    {
+        if(isSpecial(*p))
+            return p;
+    }
+    return end;
+}
+
+int countSpecial(const quint8 *p, int len)
+{
+    const quint8 *end = p + len;
+    int count = 0;
+    while(end - p >= BlockSize)
+    {
+        count += __builtin_popcount(specialMask(p));
+        p += BlockSize;
+    }
+    for(; p < end; p++)
+        count += isSpecial(*p);
+    return count;
+}
+
+int escape(const quint8 *src, int len, quint8 *dst)
+{
+    const quint8 *end = src + len;
+    quint8 *out = dst;
+    while(src < end)
+    {
+        const quint8 *s = findSpecial(src, end);
+        memcpy(out, src, s - src);
+        out += s - src;
+        if(s == end)
+            break;
+        *out++ = IEEE1443_ESCAPE_CHAR;
+        *out++ = *s;
+        src = s + 1;
+    }
+    return out - dst;
+}
+
+int unescape(const quint8 *src, int len, quint8 *dst)
+{
+    const quint8 *end = src + len;
+    quint8 *out = dst;
+    while(src < end)
+    {
+        const quint8 *s = findSpecial(src, end);
+        memmove(out, src, s - src);
+        out += s - src;
+        if(s == end)
+            break;
+        if(*s == IEEE1443_ESCAPE_CHAR)
+        {
+            // 转义符本身丢弃，后一字节原样保留；缓冲区末尾落单的转义符直接丢弃
+            if(++s == end)
+                break;
+        }
+        *out++ = *s;
+        src = s + 1;
+    }
+    return out - dst;
+}
+
+}
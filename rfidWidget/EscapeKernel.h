@@ -0,0 +1,24 @@
+#ifndef ESCAPEKERNEL_H
+#define ESCAPEKERNEL_H
+#include <QtGlobal>
+
+// 协议转义内核：内容区中的 0x02/0x03/0x10 前面要插入 0x10
+// 查找/统计特殊字节按编译目标选用 AVX2(32字节) / SSE2(16字节) / 机器字SWAR，
+// 转义和去转义共用同一个查找函数，普通字节成段memcpy。
+namespace EscapeKernel {
+
+// 返回 [p, end) 中第一个 0x02/0x03/0x10 的位置，没有则返回 end
+const quint8 *findSpecial(const quint8 *p, const quint8 *end);
+
+// 统计 0x02/0x03/0x10 的个数，即转义后增加的字节数
+int countSpecial(const quint8 *p, int len);
+
+// 转义 src 到 dst，dst 至少 len + countSpecial(src, len) 字节；返回写入字节数
+int escape(const quint8 *src, int len, quint8 *dst);
+
+// 去转义 src 到 dst（可以与 src 相同，原地处理），dst 至少 len 字节；返回写入字节数
+int unescape(const quint8 *src, int len, quint8 *dst);
+
+}
+
+#endif // ESCAPEKERNEL_H
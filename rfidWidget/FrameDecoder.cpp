@@ -0,0 +1,105 @@
+#include "FrameDecoder.h"
+#include "IEEE1443Package.h"
+#include "EscapeKernel.h"
+#include <string.h>
+
+FrameDecoder::FrameDecoder() :
+    _state(Hunting),
+    _in(0),
+    _inEnd(0),
+    _size(0),
+    _overflows(0),
+    _resyncs(0)
+{
+}
+
+// 功能：丢弃半帧，回到等待同步头状态。
+void FrameDecoder::reset()
+{
+    _state = Hunting;
+    _size = 0;
+    _in = _inEnd = 0;
+}
+
+// 功能：设置新的输入段，必须在上一段被 next() 取完之后调用。
+void FrameDecoder::push(const char *data, int len)
+{
+    _in = (const quint8 *)data;
+    _inEnd = _in + (len > 0 ? len : 0);
+}
+
+bool FrameDecoder::append(const quint8 *p, int n)
+{
+    if(_size + n > MaxFrameSize)
+    {
+        _overflows++;
+        _state = Hunting;
+        _size = 0;
+        return false;
+    }
+    memcpy(_buf + _size, p, n);
+    _size += n;
+    return true;
+}
+
+// 功能：从当前输入继续拆帧，拆出一帧返回true，输入耗尽返回false（半帧保留到下次push）。
+bool FrameDecoder::next(Frame &frame)
+{
+    while(_in < _inEnd)
+    {
+        if(_state == Hunting)
+        {
+            const quint8 *s = (const quint8 *)memchr(_in, IEEE1443_START_CODE, _inEnd - _in);
+            if(!s)
+            {
+                _in = _inEnd;
+                break;
+            }
+            _buf[0] = IEEE1443_START_CODE;
+            _size = 1;
+            _state = InFrame;
+            _in = s + 1;
+            continue;
+        }
+        if(_state == Escaped)
+        {
+            // 转义后的字节原样作为数据
+            if(append(_in, 1))
+                _state = InFrame;
+            _in++;
+            continue;
+        }
+
+        // 帧内：整段拷贝到下一个特殊字节
+        const quint8 *s = EscapeKernel::findSpecial(_in, _inEnd);
+        if(s > _in && !append(_in, s - _in))
+        {
+            _in = s;
+            continue;
+        }
+        _in = s;
+        if(_in == _inEnd)
+            break;
+
+        quint8 c = *_in++;
+        if(c == IEEE1443_ESCAPE_CHAR)
+            _state = Escaped;
+        else if(c == IEEE1443_STOP_CODE)
+        {
+            if(!append(&c, 1))
+                continue;
+            _state = Hunting;
+            frame.data = _buf;
+            frame.size = _size;
+            return true;
+        }
+        else
+        {
+            // 未转义的同步头：前面的半帧作废，从这里重新开始
+            _resyncs++;
+            _buf[0] = IEEE1443_START_CODE;
+            _size = 1;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,54 @@
+#ifndef FRAMEDECODER_H
+#define FRAMEDECODER_H
+#include <QtGlobal>
+
+// 流式拆帧器：按 0x02/0x10/0x03 去转义拆出完整帧
+// 输入按整段扫描（EscapeKernel::findSpecial），非特殊字节成段memcpy到预分配缓冲区，不逐字节append；
+// 拆出的帧以视图形式返回，指向内部缓冲区，下一次 next()/push() 前有效。
+//
+//    decoder.push(buf, len);
+//    FrameDecoder::Frame f;
+//    while(decoder.next(f))
+//        handle(f.data, f.size);
+class FrameDecoder {
+public:
+    // len 字段只有1字节：同步头 + 地址2 + 长度 + 255 + 同步尾
+    enum { MaxFrameSize = 1 + 2 + 1 + 255 + 1 };
+
+    struct Frame {
+        const quint8 *data;     // 去转义后的整帧，含同步头/尾
+        int size;
+    };
+
+    FrameDecoder();
+
+    void reset();
+    void push(const char *data, int len);
+    bool next(Frame &frame);
+
+    quint32 overflowCount() const {
+        return _overflows;
+    }
+    quint32 resyncCount() const {
+        return _resyncs;
+    }
+
+private:
+    enum State {
+        Hunting,                // 等待同步头
+        InFrame,                // 帧内
+        Escaped                 // 上一字节是转义符
+    };
+
+    bool append(const quint8 *p, int n);
+
+    State _state;
+    const quint8 *_in;          // 调用者的输入，不拷贝
+    const quint8 *_inEnd;
+    quint8 _buf[MaxFrameSize];
+    int _size;
+    quint32 _overflows;         // 超长丢弃的帧数
+    quint32 _resyncs;           // 帧内遇到未转义同步头、重新开始的次数
+};
+
+#endif // FRAMEDECODER_H
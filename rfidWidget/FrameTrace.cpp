@@ -0,0 +1,249 @@
+#include "FrameTrace.h"
+#include <QDateTime>
+#include <QFile>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QtAlgorithms>
+#include <string.h>
+#include <time.h>
+
+//多条通道可能同时导出到同一个文件（会话线程出错时、主线程按需），整段写入时互斥
+static QMutex dumpMutex;
+
+FrameTrace::FrameTrace(int capacity) :
+    records(NULL),
+    mask(0),
+    next(0),
+    _lane(0)
+{
+    //容量取不小于给定值的2的幂
+    int n = 16;
+    while(n < capacity)
+        n *= 2;
+    records = new Record[n];
+    mask = n - 1;
+    for(int i = 0; i < n; i++)
+    {
+        records[i].size = 0;
+        records[i].flags = 0;
+        records[i].timeNs = 0;
+    }
+}
+
+FrameTrace::~FrameTrace()
+{
+    delete[] records;
+}
+
+qint64 FrameTrace::monotonicNs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (qint64)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+QString FrameTrace::configuredPath()
+{
+    QByteArray env = qgetenv("RFID_TRACE");
+    if(!env.isEmpty())
+        return QString::fromLocal8Bit(env.constData());
+    return "frames.trace";
+}
+
+
+// === 记录 ===
+// 功能：记一段收发字节；超过一个槽位时拆成几条连续记录，时间戳相同。
+void FrameTrace::record(Direction dir, const char *data, int len)
+{
+    if(len <= 0)
+        return;
+    qint64 now = monotonicNs();
+    int i = next.fetchAndAddRelaxed(0);
+    for(int off = 0; off < len; off += PayloadSize)
+    {
+        Record &r = records[i & mask];
+        int seq = r.seq.fetchAndAddRelaxed(0);
+        //先标成写入中，再改内容，最后发布新序号
+        r.seq.fetchAndStoreOrdered(seq + 1);
+        int n = qMin(len - off, (int)PayloadSize);
+        r.dir = (quint8)dir;
+        r.size = (quint8)n;
+        r.flags = off > 0 ? Continued : 0;
+        r.timeNs = now;
+        memcpy(r.bytes, data + off, n);
+        r.seq.fetchAndStoreRelease(seq + 2);
+        i++;
+    }
+    next.fetchAndStoreRelease(i);
+}
+
+// 功能：拷出环里的记录，拼回拆开的字节；正在写或已被覆盖的槽位跳过。
+QList<FrameTrace::Entry> FrameTrace::entries() const
+{
+    QList<Entry> out;
+    quint32 end = recordedCount();
+    quint32 count = qMin(end, (quint32)(mask + 1));
+    bool lastComplete = false;//上一条记录是否读到，后续的拼接片才有归属
+    for(quint32 i = end - count; i != end; i++)
+    {
+        Record &r = records[i & mask];
+        int seq = r.seq.fetchAndAddAcquire(0);
+        if(seq & 1)
+        {
+            lastComplete = false;
+            continue;
+        }
+        Record copy;
+        copy.dir = r.dir;
+        copy.size = r.size;
+        copy.flags = r.flags;
+        copy.timeNs = r.timeNs;
+        memcpy(copy.bytes, r.bytes, qMin((int)copy.size, (int)PayloadSize));
+        if(r.seq.fetchAndAddOrdered(0) != seq)
+        {
+            lastComplete = false;
+            continue;
+        }
+        if(copy.flags & Continued)
+        {
+            if(lastComplete && !out.isEmpty())
+                out.last().bytes.append(copy.bytes, copy.size);
+            continue;
+        }
+        Entry e;
+        e.timeNs = copy.timeNs;
+        e.lane = _lane;
+        e.dir = (Direction)copy.dir;
+        e.bytes = QByteArray(copy.bytes, copy.size);
+        out.append(e);
+        lastComplete = true;
+    }
+    return out;
+}
+
+
+// === 导出 ===
+static bool entryBefore(const FrameTrace::Entry &a, const FrameTrace::Entry &b)
+{
+    return a.timeNs < b.timeNs;
+}
+
+bool FrameTrace::dump(const QString &path, const QString &reason, QString *error) const
+{
+    QList<const FrameTrace *> traces;
+    traces.append(this);
+    return dump(traces, path, reason, error);
+}
+
+// 功能：按时间合并各通道的记录，追加写入一段文本：
+//   # frame trace: 原因  墙上时间
+//   # lane 通道 标签 records=环里条数 total=累计条数
+//   单调时钟纳秒  墙上时间  通道  tx|rx  十六进制字节
+bool FrameTrace::dump(const QList<const FrameTrace *> &traces, const QString &path,
+                      const QString &reason, QString *error)
+{
+    //1.先拷出记录再格式化，不占用收发线程
+    QList<Entry> all;
+    QByteArray text;
+    QDateTime wallNow = QDateTime::currentDateTime();
+    qint64 monoNow = monotonicNs();
+    text.append("# frame trace: ").append(reason.toUtf8()).append('\t')
+        .append(wallNow.toString("yyyy-MM-dd hh:mm:ss.zzz").toLatin1()).append('\n');
+    for(int i = 0; i < traces.size(); i++)
+    {
+        QList<Entry> e = traces.at(i)->entries();
+        text.append(QString("# lane %1 %2 records=%3 total=%4\n")
+                    .arg(traces.at(i)->lane()).arg(traces.at(i)->label())
+                    .arg(e.size()).arg(traces.at(i)->recordedCount()).toUtf8());
+        all += e;
+    }
+    qStableSort(all.begin(), all.end(), entryBefore);
+    //2.单调时钟换算成墙上时间：按导出时刻两者之差
+    for(int i = 0; i < all.size(); i++)
+    {
+        const Entry &e = all.at(i);
+        QDateTime wall = wallNow.addMSecs(-((monoNow - e.timeNs) / 1000000));
+        text.append(QByteArray::number(e.timeNs)).append('\t')
+            .append(wall.toString("yyyy-MM-dd hh:mm:ss.zzz").toLatin1()).append('\t')
+            .append(QByteArray::number(e.lane)).append('\t')
+            .append(e.dir == Tx ? "tx" : "rx").append('\t')
+            .append(e.bytes.toHex()).append('\n');
+    }
+    //3.整段追加
+    QMutexLocker locker(&dumpMutex);
+    QFile file(path);
+    if(!file.open(QIODevice::WriteOnly | QIODevice::Append))
+    {
+        if(error)
+            *error = QString("cannot open %1: %2").arg(path).arg(file.errorString());
+        return false;
+    }
+    if(file.write(text) != text.size())
+    {
+        if(error)
+            *error = QString("write %1: %2").arg(path).arg(file.errorString());
+        return false;
+    }
+    return true;
+}
+
+// 功能：解析 dump() 写出的文本；# 开头的是段首注释。
+bool FrameTrace::load(const QString &path, QList<Entry> *entries, QString *error)
+{
+    QFile file(path);
+    if(!file.open(QIODevice::ReadOnly))
+    {
+        if(error)
+            *error = QString("cannot open %1: %2").arg(path).arg(file.errorString());
+        return false;
+    }
+    //1.逐行解析：单调时钟纳秒  墙上时间  通道  tx|rx  十六进制
+    QList<Entry> out;
+    int lineNo = 0;
+    while(!file.atEnd())
+    {
+        QByteArray line = file.readLine().trimmed();
+        lineNo++;
+        if(line.isEmpty() || line.startsWith('#'))
+            continue;
+        QList<QByteArray> f = line.split('\t');
+        bool ok1 = false;
+        bool ok2 = false;
+        Entry e;
+        if(f.size() == 5)
+        {
+            e.timeNs = f.at(0).toLongLong(&ok1);
+            e.lane = f.at(2).toInt(&ok2);
+        }
+        if(!ok1 || !ok2 || (f.at(3) != "tx" && f.at(3) != "rx") || f.at(4).size() % 2 != 0)
+        {
+            if(error)
+                *error = QString("%1:%2: malformed record").arg(path).arg(lineNo);
+            return false;
+        }
+        e.dir = (f.at(3) == "tx") ? Tx : Rx;
+        e.bytes = QByteArray::fromHex(f.at(4));
+        out.append(e);
+    }
+    //2.多次导出的环会有重叠：按时间排好，同一时刻完全相同的记录只留一条
+    qStableSort(out.begin(), out.end(), entryBefore);
+    QList<Entry> unique;
+    for(int i = 0; i < out.size(); i++)
+    {
+        const Entry &e = out.at(i);
+        bool seen = false;
+        for(int k = unique.size() - 1; k >= 0 && unique.at(k).timeNs == e.timeNs; k--)
+        {
+            const Entry &u = unique.at(k);
+            if(u.lane == e.lane && u.dir == e.dir && u.bytes == e.bytes)
+            {
+                seen = true;
+                break;
+            }
+        }
+        if(!seen)
+            unique.append(e);
+    }
+    *entries = unique;
+    return true;
+}
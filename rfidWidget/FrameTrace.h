@@ -0,0 +1,98 @@
+#ifndef FRAMETRACE_H
+#define FRAMETRACE_H
+
+#include <QAtomicInt>
+#include <QByteArray>
+#include <QList>
+#include <QString>
+
+// 一条通道的收发字节环：收发线程每写出一帧、每读到一段字节记一条
+// （方向、单调时钟纳秒、原始字节），槽位定长 64 字节，写满后覆盖最旧的，不分配内存、不格式化。
+// 超过一个槽位的字节拆成几条连续记录，导出时再拼回。
+// 只有收发线程写；导出可以在任意线程进行，每个槽位带序号（写入中为奇数），读到写了一半或
+// 已被覆盖的槽位就跳过。十六进制、时间字符串只在 dump() 时生成。
+//
+// 导出为追加写入的文本，每条记录一行（制表符分隔），可以直接交给回放工具：
+//   单调时钟纳秒  墙上时间  通道  tx|rx  十六进制字节
+class FrameTrace
+{
+public:
+    enum Direction {
+        Tx = 0,
+        Rx
+    };
+
+    enum {
+        PayloadSize = 48,       // 一个槽位存的字节数：本协议最长的线路帧（写块）46 字节
+        DefaultCapacity = 2048  // 槽位数，必须是2的幂
+    };
+
+    struct Entry
+    {
+        qint64 timeNs;
+        int lane;
+        Direction dir;
+        QByteArray bytes;
+    };
+
+    explicit FrameTrace(int capacity = DefaultCapacity);
+    ~FrameTrace();
+
+    // 以下两项在收发线程启动前设置
+    void setLane(int lane) {
+        _lane = lane;
+    }
+    int lane() const {
+        return _lane;
+    }
+    void setLabel(const QString &label) {
+        _label = label;
+    }
+    QString label() const {
+        return _label;
+    }
+
+    // 只能在收发线程调用
+    void record(Direction dir, const char *data, int len);
+
+    // 环里现有的记录，按写入顺序；任意线程可调用
+    QList<Entry> entries() const;
+    quint32 recordedCount() const {
+        return (quint32)const_cast<QAtomicInt &>(next).fetchAndAddAcquire(0);
+    }
+
+    // 导出文件：RFID_TRACE，默认 ./frames.trace
+    static QString configuredPath();
+    // 追加写入一段导出，多条通道按时间合并；reason 写在段首注释里
+    static bool dump(const QList<const FrameTrace *> &traces, const QString &path,
+                     const QString &reason, QString *error = 0);
+    bool dump(const QString &path, const QString &reason, QString *error = 0) const;
+    // 读回导出文件（可以是多次追加的多段），按时间排序，段与段重叠的记录只留一条
+    static bool load(const QString &path, QList<Entry> *entries, QString *error = 0);
+
+    static qint64 monotonicNs();
+
+private:
+    Q_DISABLE_COPY(FrameTrace)
+
+    enum { Continued = 0x01 };  // 接着上一条的字节
+
+    struct Record
+    {
+        QAtomicInt seq;         // 写入中为奇数
+        quint8 dir;
+        quint8 size;
+        quint8 flags;
+        quint8 reserved;
+        qint64 timeNs;
+        char bytes[PayloadSize];
+    };
+
+    Record *records;
+    int mask;
+    QAtomicInt next;            // 已写记录数，下一条写 next & mask
+    int _lane;
+    QString _label;
+};
+
+#endif // FRAMETRACE_H
@@ -1,32 +1,44 @@
 #include "IEEE1443Package.h"
+#include "EscapeKernel.h"
 #include <QDebug>
 
 IEEE1443Package::IEEE1443Package(const QByteArray &rawPkg)
+{
+    parse((const quint8 *)rawPkg.constData(), rawPkg.size());
+}
+
+// 直接从拆帧器的帧视图解析，不经过中间QByteArray
+IEEE1443Package::IEEE1443Package(const quint8 *rawPkg, int size)
+{
+    parse(rawPkg, size);
+}
+
+void IEEE1443Package::parse(const quint8 *raw, int size)
 {
     bool done = false;
-    const char *raw = rawPkg.constData();
     do {
-        if(*raw++ != IEEE1443_START_CODE)
+        // 最短帧：同步头 + 地址2 + 长度 + 命令 + 校验 + 同步尾
+        if(size < 7)
+            break;
+        if(raw[0] != IEEE1443_START_CODE)
             break;
         _ssync = IEEE1443_START_CODE;
-        _addr = *raw++;
-        _addr |= (((quint16)(*raw++)) << 8);
-//        _addr = *(quint16 *)raw;
-//        raw += 2;
-        _len = *raw++;
-        if(_len > rawPkg.size() - 4)
+        _addr = raw[1];
+        _addr |= (((quint16)raw[2]) << 8);
+        _len = raw[3];
+        if(_len > size - 4)
             break;
-        _cmd = *raw++;
-        _data.clear();
+        _cmd = raw[4];
         int dataLen = _len;
-        if(rawPkg.size() - 4 == _len)
+        if(size - 4 == _len)
             dataLen -= (1 + 2);
         else
             dataLen -= (1 + 1);
-        _data.append(raw, dataLen);
-        raw += dataLen;
-        _chksum = *raw++;
-        if(*raw++ != IEEE1443_STOP_CODE)
+        if(dataLen < 0)
+            break;
+        _data = QByteArray((const char *)raw + 5, dataLen);
+        _chksum = raw[5 + dataLen];
+        if(raw[6 + dataLen] != IEEE1443_STOP_CODE)
             break;
         _esync = IEEE1443_STOP_CODE;
         done = true;
@@ -126,34 +138,49 @@ QByteArray IEEE1443Package::toPurePackage() const
     return ret;
 }
 
+static inline quint8 *escapeByte(quint8 *out, quint8 c)
+{
+    if(c == IEEE1443_ESCAPE_CHAR || c == IEEE1443_START_CODE || c == IEEE1443_STOP_CODE)
+        *out++ = IEEE1443_ESCAPE_CHAR;
+    *out++ = c;
+    return out;
+}
+
+// 功能：一次性把转义后的线路帧写入 out，out 至少 maxRawSize() 字节；返回写入字节数，无效包返回0。
+int IEEE1443Package::encodeRaw(char *out) const
+{
+    if(!_valid)
+        return 0;
+    quint8 *p = (quint8 *)out;
+    *p++ = IEEE1443_START_CODE;
+    p = escapeByte(p, _addr & 0xFF);
+    p = escapeByte(p, _addr >> 8);
+    p = escapeByte(p, _len);
+    p = escapeByte(p, _cmd);
+    p += EscapeKernel::escape((const quint8 *)_data.constData(), _data.size(), p);
+    p = escapeByte(p, _chksum);
+    *p++ = IEEE1443_STOP_CODE;
+    return p - (quint8 *)out;
+}
+
 QByteArray IEEE1443Package::toRawPackage() const
 {
     if(!_valid)
         return QByteArray();
     QByteArray ret;
-    ret.append(IEEE1443_START_CODE);
-    QByteArray content;
-    content.append((char *)&_addr, sizeof(_addr));
-    content.append(_len);
-    content.append(_cmd);
-    content.append(_data);
-    content.append(_chksum);
-    ret.append(getRawPackage(content));
-    ret.append(IEEE1443_STOP_CODE);
+    ret.resize(maxRawSize());
+    ret.resize(encodeRaw(ret.data()));
     return ret;
 }
 
+// 功能：转义内容区。先统计特殊字节一次性定长，再由 EscapeKernel 成段拷贝。
 QByteArray IEEE1443Package::getRawPackage(const quint8 *data, int len)
 {
     QByteArray ret;
-    while(len-- > 0)
-    {
-        if((*data == IEEE1443_ESCAPE_CHAR)
-            || (*data == 0x02)
-            || (*data == 0x03))
-            ret.append(IEEE1443_ESCAPE_CHAR);
-        ret.append(*data++);
-    }
+    if(len <= 0)
+        return ret;
+    ret.resize(len + EscapeKernel::countSpecial(data, len));
+    EscapeKernel::escape(data, len, (quint8 *)ret.data());
     return ret;
 }
 
@@ -164,6 +191,24 @@ QByteArray IEEE1443Package::getRawPackage(const QByteArray &data)
     return getRawPackage(p, len);
 }
 
+// 功能：去转义，getRawPackage 的逆过程。
+QByteArray IEEE1443Package::getPurePackage(const quint8 *data, int len)
+{
+    QByteArray ret;
+    if(len <= 0)
+        return ret;
+    ret.resize(len);
+    ret.resize(EscapeKernel::unescape(data, len, (quint8 *)ret.data()));
+    return ret;
+}
+
+QByteArray IEEE1443Package::getPurePackage(const QByteArray &data)
+{
+    int len = data.size();
+    const quint8 *p = (const quint8 *)data.constData();
+    return getPurePackage(p, len);
+}
+
 QString IEEE1443Package::getRawString(const quint8 *data, int len)
 {
     return getRawPackage(data, len).toHex();
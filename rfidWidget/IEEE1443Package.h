@@ -17,6 +17,8 @@ class IEEE1443Package {
     quint8 _chksum;             // 校验和
     quint8 _esync;              // 同步尾 = 0x03
 
+    void parse(const quint8 *raw, int size);
+
 public:
     enum IEEE1443Command {
         SearchCard = 0x46,
@@ -29,20 +31,21 @@ public:
     };
     IEEE1443Package():_valid(false)              {}
     IEEE1443Package(const QByteArray &rawPkg);
+    IEEE1443Package(const quint8 *rawPkg, int size);
     IEEE1443Package(quint16 addr, quint8 cmd);
     IEEE1443Package(quint16 addr, quint8 cmd, const QByteArray &data);
     IEEE1443Package(quint16 addr, quint8 cmd, quint8 data);
     IEEE1443Package(quint16 addr, quint8 cmd, quint8 data1, quint8 data2);
 
-    bool isValid() {
+    bool isValid() const {
         return _valid;
     }
-    bool isSendPackage() {
+    bool isSendPackage() const {
         if(!_valid)
             return false;
         return (_len == (_data.size() + 3));
     }
-    bool isRecvPackage() {
+    bool isRecvPackage() const {
         if(!_valid)
             return false;
         return (_len == (_data.size() + 2));
@@ -81,6 +84,11 @@ public:
         return _chksum;
     }
 
+    // 最坏情况（内容区全部需要转义）下的线路帧长度
+    int maxRawSize() const {
+        return 1 + (2 + 1 + 1 + _data.size() + 1) * 2 + 1;
+    }
+    int encodeRaw(char *out) const;
     QByteArray toPurePackage() const;
     QByteArray toRawPackage() const;
     static QByteArray getRawPackage(const quint8 *data, int len);
@@ -91,6 +99,8 @@ public:
     static QByteArray getRawPackage(quint16 data) {
         return getRawPackage((quint8 *)&data, 2);
     }
+    static QByteArray getPurePackage(const quint8 *data, int len);
+    static QByteArray getPurePackage(const QByteArray &data);
     static QString getRawString(const quint8 *data, int len);
     static QString getRawString(const QByteArray &data);
     static QString getRawString(quint8 data) {
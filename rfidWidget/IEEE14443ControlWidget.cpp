@@ -3,7 +3,10 @@
 //#include "IEEE1443PackageWidget.h"
 //#include <IEEE1443Package.h>
 #include<rfidWidget/IEEE1443Package.h>
-#include <QMessageBox>
+#include<rfidWidget/ReaderSession.h>
+#include<rfidWidget/ParkingStore.h>
+#include<rfidWidget/ParkingTableModel.h>
+#include<rfidWidget/NotificationBar.h>
 #include <QScrollBar>
 #include <QDebug>
 #include <QDateTime>
@@ -11,51 +14,33 @@
 #include <QPushButton>
 #include <QHeaderView>
 #include <QAbstractItemView>
+#include <QSortFilterProxyModel>
 //#include <ioportManager.h>
 #include<rfidWidget/ioportManager.h>
 
-//块1前两字节签名，用来判断这张卡是不是“停车系统卡”
-static const char kTagSignature1 = 'P';
-static const char kTagSignature2 = 'K';
-//使用块1和块2写入
-static const int kUserBlock1 = 1;
-static const int kUserBlock2 = 2;
-//计费单价
-static const int kHourFee = 5;
-
 
 // === 构造/析构与生命周期 ===
 // 功能：构造函数：初始化界面、定时器与状态。
-IEEE14443ControlWidget::IEEE14443ControlWidget(QWidget *parent) :
+IEEE14443ControlWidget::IEEE14443ControlWidget(const QString &port, ParkingStore *sharedStore, QWidget *parent) :
     QWidget(parent),
     ui(new Ui::IEEE14443ControlWidget),
-    commPort(NULL),
-    autoSearchTimer(NULL),
-    replyTimeoutTimer(NULL),
-    recvStatus(0),
-    waitingReply(false),
-    pendingCommand(-1),
-    pendingRetries(0),
-    maxReplyRetries(2),
-    replyTimeoutMs(400),
-    autoSearchInProgress(false),
-    tagAuthenticated(false),
-    pendingReadBlock(-1),
-    pendingWriteBlock(-1),
+    portName(port),
+    session(NULL),
+    notifier(NULL),
+    metricsTimer(NULL),
+    store(sharedStore),
+    parkingModel(NULL),
+    parkingProxy(NULL),
     requiresInitialization(false),
     refreshAfterWrite(false),
     registrationPaused(false),
     registrationFlowActive(false),
     registrationVerificationPending(false),
-    registrationWritePending(false),
-    registrationPendingStatusText(),
     registrationAwaitingRemoval(false),
     registrationAwaitingCardId(),
     rechargePaused(false),
     rechargeFlowActive(false),
     rechargeVerificationPending(false),
-    rechargeWritePending(false),
-    rechargePendingStatusText(),
     rechargeExpectedBalance(0),
     rechargeAwaitingRemoval(false),
     rechargeAwaitingCardId(),
@@ -63,8 +48,9 @@ IEEE14443ControlWidget::IEEE14443ControlWidget(QWidget *parent) :
     parkingFlowPaused(false),
     parkingFlowState(ParkingFlowIdle),
     parkingExitWritePending(false),
-    lastExitFee(0),
-    authKeyData(6, static_cast<char>(0xFF))
+    parkingAwaitingRemoval(false),
+    parkingAwaitingCardId(),
+    lastExitFee(0)
 {
     ui->setupUi(this);
     if(ui->parkingTable)
@@ -76,22 +62,63 @@ IEEE14443ControlWidget::IEEE14443ControlWidget(QWidget *parent) :
         QHeaderView *header = ui->parkingTable->horizontalHeader();
         if(header)
             header->setResizeMode(QHeaderView::Stretch);
+        ui->parkingTable->verticalHeader()->hide();
     }
 
-    //收到包信号和处理包信息号
-    connect(this, SIGNAL(recvPackage(QByteArray)), this, SLOT(onRecvedPackage(QByteArray)));
 //  connect(ui->statusList->verticalScrollBar(), SIGNAL(rangeChanged(int,int)), this, SLOT(onStatusListScrollRangeChanced(int,int)));
 
-    //设置自动寻卡定时器，实现自动刷卡
-    autoSearchTimer = new QTimer(this);
-    autoSearchTimer->setInterval(500);
-    //连接信号到槽函数
-    connect(autoSearchTimer, SIGNAL(timeout()), this, SLOT(onAutoSearchTimeout()));
-    //等待回包超时定时器
-    replyTimeoutTimer = new QTimer(this);
-    replyTimeoutTimer->setInterval(replyTimeoutMs);
-    replyTimeoutTimer->setSingleShot(true);
-    connect(replyTimeoutTimer, SIGNAL(timeout()), this, SLOT(onReplyTimeout()));
+    //非模态提示条：提示期间读卡流程不停
+    notifier = new NotificationBar(this);
+    ui->verticalLayout->insertWidget(0, notifier);
+    //可选提示音和LED（13.56M模式下LED3空闲）：RFID_NOTIFY_CUE=1 时打开
+    if(qgetenv("RFID_NOTIFY_CUE") == "1")
+    {
+        notifier->setCueEnabled(true);
+        notifier->setCueLed(3);
+    }
+
+    //读卡器会话：串口、命令调度、寻卡链与读写块，本界面只处理它发出的事件
+    session = new ReaderSession(this);
+    session->setAutoSearchCadence(0, 1000);
+    connect(session, SIGNAL(commandCompleted(quint8,quint8,QByteArray)),
+            this, SLOT(onCommandCompleted(quint8,quint8,QByteArray)));
+    connect(session, SIGNAL(commandFailed(quint8)), this, SLOT(onCommandFailed(quint8)));
+    connect(session, SIGNAL(cardDetected(QString)), this, SLOT(onCardDetected(QString)));
+    connect(session, SIGNAL(cardLost()), this, SLOT(onCardLost()));
+    connect(session, SIGNAL(cardRead(QString,QByteArray,QByteArray)),
+            this, SLOT(onCardRead(QString,QByteArray,QByteArray)));
+    connect(session, SIGNAL(readFailed()), this, SLOT(onReadFailed()));
+    connect(session, SIGNAL(writeFinished(bool)), this, SLOT(onWriteFinished(bool)));
+    //停车记录：多通道时由外部传入共用的一份，单独使用时自己建一份
+    if(!store)
+        store = new ParkingStore(this);
+    //在场车辆表格：模型随 ParkingStore 的信号逐行更新，代理负责点表头排序和筛选
+    parkingModel = new ParkingTableModel(store, this);
+    parkingProxy = new QSortFilterProxyModel(this);
+    parkingProxy->setSourceModel(parkingModel);
+    parkingProxy->setSortRole(ParkingTableModel::SortRole);
+    parkingProxy->setFilterKeyColumn(-1);
+    parkingProxy->setFilterCaseSensitivity(Qt::CaseInsensitive);
+    parkingProxy->setDynamicSortFilter(true);
+    if(ui->parkingTable)
+    {
+        ui->parkingTable->setModel(parkingProxy);
+        ui->parkingTable->setSortingEnabled(true);
+        ui->parkingTable->sortByColumn(ParkingTableModel::CardColumn, Qt::AscendingOrder);
+    }
+    if(ui->parkingFilterEdit)
+        connect(ui->parkingFilterEdit, SIGNAL(textChanged(QString)),
+                parkingProxy, SLOT(setFilterFixedString(QString)));
+    //通讯统计：只在页面可见时刷新，取快照不影响会话
+    metricsTimer = new QTimer(this);
+    metricsTimer->setInterval(1000);
+    connect(metricsTimer, SIGNAL(timeout()), this, SLOT(refreshMetricsView()));
+    if(ui->traceDumpButton)
+        connect(ui->traceDumpButton, SIGNAL(clicked()), this, SLOT(onTraceDumpClicked()));
+    //计费规则：读 RFID_TARIFF 指定的规则表，没有或有错时用缺省单价
+    QString tariffError;
+    if(!tariff.load(Tariff::configuredPath(), &tariffError))
+        qWarning() << "tariff:" << tariffError;
     resetStatus();
 }
 
@@ -104,23 +131,32 @@ IEEE14443ControlWidget::~IEEE14443ControlWidget()
 // 功能：显示事件：打开串口并启动自动寻卡流程。
 void IEEE14443ControlWidget::showEvent(QShowEvent *)
 {
-    if(!commPort)
-    {
-        //qDebug()<<"set mode success";
-        IOPortManager::setMode(Mode13_56M1);
-        this->start("/dev/ttyS0");
-    }
+    startReader();
+    refreshMetricsView();
+    metricsTimer->start();
 }
 
 // 功能：隐藏事件：停止串口与定时器，释放硬件占用。
 void IEEE14443ControlWidget::hideEvent(QHideEvent *)
 {
-    if(commPort)
+    metricsTimer->stop();
+    //多通道时切换到别的通道页也会隐藏本页，只在整个窗口隐藏时停止
+    if(session->isOpen() && !window()->isVisible())
     {
         this->stop();
     }
 }
 
+// 功能：选择13.56M模块并打开本通道串口，已打开时直接返回。
+bool IEEE14443ControlWidget::startReader()
+{
+    if(session->isOpen())
+        return true;
+    //qDebug()<<"set mode success";
+    IOPortManager::setMode(Mode13_56M1);
+    return this->start(portName);
+}
+
 // 功能：静态入口：按需创建并显示窗口实例。
 static IEEE14443ControlWidget *ieee14443ControlWidget;
 void IEEE14443ControlWidget::showOut()
@@ -136,97 +172,19 @@ void IEEE14443ControlWidget::showOut()
 // 功能：启动串口与读卡流程。
 bool IEEE14443ControlWidget::start(const QString &port)
 {
-    //1.防止重复启动
-    if(commPort != NULL)
+    //1.打开串口、启动收发线程（重复启动时返回false）
+    if(!session->open(port))
         return false;
-    //2.创建串口对象并设置参数
-    //commPort = new QextSerialPort(port,  QextSerialPort::EventDriven);
-    commPort = new Posix_QextSerialPort(port,  QextSerialBase::Polling);
-    commPort->setBaudRate(BAUD19200);
-    commPort->setFlowControl(FLOW_OFF);
-    commPort->setParity(PAR_NONE);
-    commPort->setDataBits(DATA_8);
-    commPort->setStopBits(STOP_1);
-
-    //3.1打开串口
-    if (commPort->open(QIODevice::ReadWrite) == true) {
-
-        //4.启动读卡计时器
-        //connect(commPort, SIGNAL(readyRead()), this, SLOT(onPortDataReady()));
-        readTimer = new QTimer(this);   //初始化计时器
-        readTimer->start(100);  //设置延时为100ms
-        connect(readTimer,SIGNAL(timeout()),this,SLOT(onPortDataReady()));
-
-        //5.开始自动读卡
-        startAutoSearch();
-        return true;
-    }
-    else {//3.2若打开失败
-        //4.记录错误日志
-        qDebug() << QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss")
-                 << "device failed to open:" << commPort->errorString();
-        //5.删除串口对象
-        delete commPort;
-        commPort = NULL;
-        return false;
-    }
+    //2.开始自动读卡
+    startAutoSearch();
+    return true;
 }
 
 // 功能：停止串口与自动寻卡流程。
 bool IEEE14443ControlWidget::stop()
 {
-    //1.关闭串口、释放对象
-    if(commPort != NULL)
-    {
-        commPort->close();
-        delete commPort;
-    }
-    commPort = NULL;
-
-    //2.停止超时计时器
-    if(replyTimeoutTimer)
-        replyTimeoutTimer->stop();
-
-    //3.清理通讯状态
-    waitingReply = false;
-    pendingCommand = -1;
-    pendingRetries = 0;
-    autoSearchInProgress = false;
-    stopAutoSearch();
-
-    return true;
-}
-
-// 功能：发送命令数据包并进入等待回包状态。
-bool IEEE14443ControlWidget::sendData(const QByteArray &data)
-{
-    //1.检查串口存在
-    if(commPort)
-    {
-        //2.纯数据包装为协议包
-        IEEE1443Package pkg(data);
-        QByteArray rawPackage = pkg.toRawPackage();
-        
-        //3.打印日志信息
-        qDebug() << QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss")
-                 << QString("send %1").arg(QString(rawPackage.toHex()));
-
-        //4.写入串口
-        commPort->write(rawPackage);
-
-        //5.设置等待回包状态
-        waitingReply = true;
-        //记住当前命令
-        if(pkg.isValid())
-            pendingCommand = pkg.command();
-        else
-            pendingCommand = -1;
-        //重试次数清零
-        pendingRetries = 0;
-        //开启等待回包超时计时器
-        if(pkg.isValid())
-            startReplyTimeout(pkg.command());
-    }
+    //放弃未完成的命令、停收发线程、关闭串口，并停止自动寻卡
+    session->close();
     return true;
 }
 
@@ -238,21 +196,13 @@ void IEEE14443ControlWidget::resetStatus()
     ui->resultLabel->setText("");
     ui->parkingStatusLabel->setText("");
 
-    //2.清空通信状态
-    waitingReply = false;
-    pendingCommand = -1;
-    pendingRetries = 0;
-    autoSearchInProgress = false;
-    if(replyTimeoutTimer)
-        replyTimeoutTimer->stop();
+    //2.清空通信状态（排队命令、重复包记录、当前卡）
+    session->reset();
 
     //3.清空卡片信息缓存
-    tagAuthenticated = false;
     currentCardId.clear();
     lastBlock1.clear();
     lastBlock2.clear();
-    pendingReadBlock = -1;
-    pendingWriteBlock = -1;
     currentInfo = TagInfo();
     pendingWriteInfo = TagInfo();
 
@@ -262,16 +212,11 @@ void IEEE14443ControlWidget::resetStatus()
     registrationPaused = false;
     registrationFlowActive = false;
     registrationVerificationPending = false;
-    registrationWritePending = false;
-    registrationPendingStatusText.clear();
     registrationAwaitingRemoval = false;
     registrationAwaitingCardId.clear();
     rechargePaused = false;
     rechargeFlowActive = false;
     rechargeVerificationPending = false;
-    rechargeWritePending = false;
-    rechargePendingStatusText.clear();
-    rechargePendingInfo = TagInfo();
     rechargeExpectedBalance = 0;
     rechargeAwaitingRemoval = false;
     rechargeAwaitingCardId.clear();
@@ -281,231 +226,35 @@ void IEEE14443ControlWidget::resetStatus()
     parkingFlowPaused = false;
     parkingFlowState = ParkingFlowIdle;
     parkingExitWritePending = false;
+    parkingAwaitingRemoval = false;
+    parkingAwaitingCardId.clear();
     lastExitFee = 0;
-    lastEntryTimeMap.clear();
-    lastExitTimeMap.clear();
-    entryTimeMap.clear();
-    activeInfoMap.clear();
-
-    //6.清空重复包缓存
-    recentReplyTimestamps.clear();
+    pendingExitTime = QDateTime();
+    notifier->clear();
 
-    //7.刷新ui
+    //6.刷新ui（停车记录由各通道共用，不在这里清空）
     updateInfoPanel(TagInfo(), QDateTime(), QDateTime());
-    updateParkingTable();
 }
 
 
-// === 自动寻卡与指令请求 ===
-// 功能：启动自动寻卡定时器。
+// === 自动寻卡 ===
+// 功能：启动自动寻卡。
 void IEEE14443ControlWidget::startAutoSearch()
 {
-    //1.检查是否需要暂停自动寻卡
-    if(registrationPaused || rechargePaused || parkingFlowPaused)//当因注册或收费需要暂停时，不自动寻卡
+    //当因注册、收费或出入场需要暂停时，不自动寻卡
+    if(registrationPaused || rechargePaused || parkingFlowPaused || requiresInitialization)
         return;
-    //2.检查定时器是否有效且未激活
-    if(autoSearchTimer && !autoSearchTimer->isActive())
-        autoSearchTimer->start();//启动定时器
+    session->startAutoSearch();
 }
 
-// 功能：停止自动寻卡定时器。
+// 功能：停止自动寻卡。
 void IEEE14443ControlWidget::stopAutoSearch()
 {
-    if(autoSearchTimer)
-        autoSearchTimer->stop();
-}
-
-// 功能：请求寻卡指令。
-void IEEE14443ControlWidget::requestSearch()
-{
-    //1.等待回复||已经在寻卡：不重复发送
-    if(waitingReply || autoSearchInProgress)
-        return;
-    //2.构造存储并发送寻卡命令包
-    lastSendPackage = IEEE1443Package(0, IEEE1443Package::SearchCard, 0x52).toPurePackage();
-    sendData(lastSendPackage);
-    //3.标记正在寻卡
-    autoSearchInProgress = true;
-    //4.开始等待回包超时计时器
-    if(replyTimeoutTimer)
-        replyTimeoutTimer->start();
-}
-
-// 功能：请求防冲突指令。
-void IEEE14443ControlWidget::requestAntiColl()
-{
-    //等待回复——不发新指令
-    if(waitingReply)
-        return;
-    //构造存储并发送防冲突包
-    lastSendPackage = IEEE1443Package(0, IEEE1443Package::AntiColl, 0x04).toPurePackage();
-    sendData(lastSendPackage);
-}
-
-// 功能：请求选择指定卡片。
-void IEEE14443ControlWidget::requestSelect(const QByteArray &cardId)
-{
-    //1.若还在等待回包就不发
-    if(waitingReply)
-        return;
-    //2.构造包
-    IEEE1443Package pkg(0, IEEE1443Package::SelectCard, cardId);
-    //3.记录此包信息，便于重发
-    lastSendPackage = pkg.toPurePackage();
-    //3.发包
-    sendData(lastSendPackage);
-}
-
-// 功能：请求认证指定块。
-void IEEE14443ControlWidget::requestAuth(quint8 blockNumber)
-{
-    //1.判断是否正在等待回包
-    if(waitingReply)
-        return;
-    //2.构造认证信息
-    QByteArray authInfo;
-    authInfo.append(0x60);
-    authInfo.append((char)blockNumber);
-    authInfo.append(authKeyData);
-    //认证信息错误检查
-    if(authInfo.size() != 8)
-    {
-        QMessageBox::warning(this, tr("Warning"), tr("auth key error"));
-        return;
-    }
-    //3.构造包
-    IEEE1443Package pkg(0, IEEE1443Package::Authentication, authInfo);
-    //4.存包
-    lastSendPackage = pkg.toPurePackage();
-    //5.发包
-    sendData(lastSendPackage);
-}
-
-// 功能：请求读取指定块。
-void IEEE14443ControlWidget::requestRead(quint8 blockNumber)
-{
-    //1.等回包
-    if(waitingReply)
-        return;
-    //2.构造包
-    pendingReadBlock = blockNumber;
-    IEEE1443Package pkg(0, 0x4B, (char)blockNumber);
-    //3.存包
-    lastSendPackage = pkg.toPurePackage();
-    //4.发包
-    sendData(lastSendPackage);
-}
-
-// 功能：请求写入指定块。
-void IEEE14443ControlWidget::requestWrite(quint8 blockNumber, const QByteArray &data)
-{
-    //1.等回包
-    if(waitingReply)
-        return;
-    //2.安全检测
-    if(data.size() != 16)
-    {
-        QMessageBox::warning(this, tr("Warning"), tr("write data error"));
-        return;
-    }
-    //3.构造包
-    pendingWriteBlock = blockNumber;
-    QByteArray writeInfo;
-    writeInfo.append((char)blockNumber);//块号
-    writeInfo.append(data);//信息
-    IEEE1443Package pkg(0, IEEE1443Package::WriteCard, writeInfo);
-    //4.存包
-    lastSendPackage = pkg.toPurePackage();
-    //5.发包
-    sendData(lastSendPackage);
+    session->stopAutoSearch();
 }
 
 
 // === 卡信息解析与UI更新 ===
-// 功能：车辆类型文本转编码。
-static char vehicleCodeFromText(const QString &text)
-{
-    if(text == "Sedan")
-        return 1;
-    if(text == "SUV")
-        return 2;
-    if(text == "Truck")
-        return 3;
-    if(text == "Electric")
-        return 4;
-    return 0;
-}
-
-// 功能：车辆类型编码转文本。
-static QString vehicleTextFromCode(char c)
-{
-    switch((int)(unsigned char)c)
-    {
-    case 1:
-        return "Sedan";
-    case 2:
-        return "SUV";
-    case 3:
-        return "Truck";
-    case 4:
-        return "Electric";
-    default:
-        return "Other";
-    }
-}
-
-// 功能：从块数据解析 TagInfo。
-bool IEEE14443ControlWidget::decodeTagInfo(const QByteArray &b1, const QByteArray &b2, TagInfo &info)
-{
-    //1.初始化为无效信息
-    info.valid = false;
-    //2.检验块是否有效
-    if(b1.size() != 16 || b2.size() != 16)
-        return false;
-    if((b1.at(0) != kTagSignature1) || (b1.at(1) != kTagSignature2))
-        return false;
-    //3.解析车主信息
-    QByteArray ownerBytes = b1.mid(4, 12);
-    int nullIndex = ownerBytes.indexOf('\0');
-    if(nullIndex >= 0)
-        ownerBytes.truncate(nullIndex);
-    info.owner = QString::fromLatin1(ownerBytes).trimmed();
-    info.vehicleType = vehicleTextFromCode(b1.at(3));
-    //4.解析余额信息
-    int bal = 0;
-    bal |= (quint8)b2.at(0);
-    bal |= ((quint8)b2.at(1)) << 8;
-    bal |= ((quint8)b2.at(2)) << 16;
-    bal |= ((quint8)b2.at(3)) << 24;
-    info.balance = bal;
-    //5.设为有效信息
-    info.valid = true;
-    return true;
-}
-
-// 功能：将 TagInfo 编码为块数据。
-void IEEE14443ControlWidget::encodeTagInfo(const TagInfo &info, QByteArray &b1, QByteArray &b2)
-{
-    //1.初始化两个块
-    b1 = QByteArray(16, 0x00);
-    b2 = QByteArray(16, 0x00);
-    //2.写入卡片签名与固定标志
-    b1[0] = kTagSignature1;//P
-    b1[1] = kTagSignature2;//K
-    b1[2] = 0x01;
-    //3.写入车型、车主信息
-    b1[3] = vehicleCodeFromText(info.vehicleType);
-    QByteArray nameBytes = info.owner.left(12).toLatin1();
-    //4.写入余额信息
-    int i;
-    for(i = 0; i < nameBytes.size() && i < 12; ++i)
-        b1[4 + i] = nameBytes.at(i);
-    b2[0] = (char)(info.balance & 0xFF);
-    b2[1] = (char)((info.balance >> 8) & 0xFF);
-    b2[2] = (char)((info.balance >> 16) & 0xFF);
-    b2[3] = (char)((info.balance >> 24) & 0xFF);
-}
-
 // 功能：更新面板的进出场时间与余额显示。
 void IEEE14443ControlWidget::updateInfoPanel(const TagInfo &info, const QDateTime &entryTime, const QDateTime &exitTime)
 {
@@ -519,44 +268,6 @@ void IEEE14443ControlWidget::updateInfoPanel(const TagInfo &info, const QDateTim
         ui->infoBalanceValue->setText(tr("--"));
 }
 
-// 功能：刷新停车记录表格。
-void IEEE14443ControlWidget::updateParkingTable()
-{
-    //1.检查表格是否存在
-    if(!ui->parkingTable)
-        return;
-    //2.设置行数
-    ui->parkingTable->setRowCount(entryTimeMap.size());
-    //3.遍历entryTimeMap 建立在场车辆表
-    int row = 0;
-    QMap<QString, QDateTime>::const_iterator it = entryTimeMap.constBegin();
-    for(; it != entryTimeMap.constEnd(); ++it, ++row)
-    {
-        const QString cardId = it.key();
-        const QDateTime entryTime = it.value();
-        //从在场车辆表获取信息
-        TagInfo info;
-        if(activeInfoMap.contains(cardId))
-            info = activeInfoMap.value(cardId);
-
-        QTableWidgetItem *cardItem = new QTableWidgetItem(cardId);
-        QTableWidgetItem *ownerItem = new QTableWidgetItem(info.valid ? info.owner : tr("--"));
-        QTableWidgetItem *vehicleItem = new QTableWidgetItem(info.valid ? info.vehicleType : tr("--"));
-        QTableWidgetItem *entryItem = new QTableWidgetItem(entryTime.isValid()
-                                                           ? entryTime.toString("yyyy-MM-dd hh:mm:ss")
-                                                           : tr("--"));
-        QTableWidgetItem *balanceItem = new QTableWidgetItem(info.valid
-                                                             ? QString::number(info.balance)
-                                                             : tr("--"));
-        ui->parkingTable->setItem(row, 0, cardItem);
-        ui->parkingTable->setItem(row, 1, ownerItem);
-        ui->parkingTable->setItem(row, 2, vehicleItem);
-        ui->parkingTable->setItem(row, 3, entryItem);
-        ui->parkingTable->setItem(row, 4, balanceItem);
-    }
-}
-
-
 // === 业务流程处理（注册/充值/停车） ===
 
 // 功能：注册开始时暂停自动寻卡流程。
@@ -592,6 +303,19 @@ void IEEE14443ControlWidget::resumeAfterRecharge()
     startAutoSearch();
 }
 
+// 功能：充值写卡或校验失败：放弃充值和等它的出场，恢复自动寻卡，重新刷卡时再算。
+void IEEE14443ControlWidget::abandonRecharge()
+{
+    pendingExitFee = 0;
+    if(parkingFlowState == ParkingFlowExit)
+    {
+        parkingFlowState = ParkingFlowIdle;
+        parkingFlowPaused = false;
+    }
+    rechargePaused = false;
+    startAutoSearch();
+}
+
 // 功能：检查卡片是否初始化并处理注册/充值校验。
 void IEEE14443ControlWidget::ensureInitialized()
 {
@@ -610,6 +334,7 @@ void IEEE14443ControlWidget::ensureInitialized()
             registrationFlowActive = false;
             //4，记录当前info
             currentInfo = info;
+            store->recordRegistration(currentCardId, QDateTime::currentDateTime(), info);
             //5.更新ui
             updateInfoPanel(info, QDateTime(), QDateTime());
             //6.提示信息
@@ -617,8 +342,9 @@ void IEEE14443ControlWidget::ensureInitialized()
             //7.设置等待取卡状态
             registrationAwaitingRemoval = true;
             registrationAwaitingCardId = currentCardId;
+            session->setAwaitingRemoval(currentCardId);//拿走前再识别到这张卡不再读块
             //7.弹出提示框
-            QMessageBox::information(this, tr("注册成功"), tr("注册成功，请收卡"));
+            notifier->post(NotificationBar::Success, tr("注册成功"), tr("注册成功，请收卡"));
             //8.继续自动寻卡
             resumeAfterRegistration();
 
@@ -635,22 +361,22 @@ void IEEE14443ControlWidget::ensureInitialized()
             //2.记录当前info
             currentInfo = info;
             //3.读取入场时间
-            QDateTime entryDisplayTime = entryTimeMap.contains(currentCardId) ?
-                                         entryTimeMap.value(currentCardId) :
-                                         lastEntryTimeMap.value(currentCardId);
+            QDateTime entryDisplayTime = store->displayEntryTime(currentCardId);
             //4.更新ui
-            updateInfoPanel(info, entryDisplayTime, lastExitTimeMap.value(currentCardId));
+            updateInfoPanel(info, entryDisplayTime, store->lastExitTime(currentCardId));
             currentInfo = info;
             //5.1充值成功
             if(info.balance == rechargeExpectedBalance)
             {
+                store->recordRecharge(currentCardId, QDateTime::currentDateTime(), info);
                 //6.ui提示
                 ui->parkingStatusLabel->setText(tr("充值成功，余额为%1").arg(info.balance));
                 //7，等待取卡
                 rechargeAwaitingRemoval = true;
                 rechargeAwaitingCardId = currentCardId;
+                session->setAwaitingRemoval(currentCardId);
                 //8.提示信息
-                QMessageBox::information(this, tr("充值成功"), tr("充值成功，余额为%1").arg(info.balance));
+                notifier->post(NotificationBar::Success, tr("充值成功"), tr("充值成功，余额为%1").arg(info.balance));
                 //9。校验余额
                 if(pendingExitFee > 0 && info.balance >= pendingExitFee)
                 {
@@ -664,7 +390,7 @@ void IEEE14443ControlWidget::ensureInitialized()
             }
             else//5.2充值失败
             {
-                QMessageBox::warning(this, tr("充值失败"), tr("请重新充值"));
+                notifier->post(NotificationBar::Warning, tr("充值失败"), tr("请重新充值"));
                 ui->parkingStatusLabel->setText(tr("请重新充值"));
             }
             return;
@@ -691,20 +417,19 @@ void IEEE14443ControlWidget::ensureInitialized()
         }
         rechargeAwaitingRemoval = false;
         rechargeAwaitingCardId.clear();
+        //4.3出入场后等待取卡：提示不再阻塞，卡还放在读卡器上时不能再算一次进出场
+        if(parkingAwaitingRemoval && parkingAwaitingCardId == currentCardId)
+            return;
+        parkingAwaitingRemoval = false;
+        parkingAwaitingCardId.clear();
 
         //5.更新展示信息
         currentInfo = info;
         //更新信息面板
-        QDateTime entryDisplayTime = entryTimeMap.contains(currentCardId) ?
-                                     entryTimeMap.value(currentCardId) :
-                                     lastEntryTimeMap.value(currentCardId);
-        updateInfoPanel(info, entryDisplayTime, lastExitTimeMap.value(currentCardId));
-        //更新停车表
-        if(entryTimeMap.contains(currentCardId))
-        {
-            activeInfoMap.insert(currentCardId, info);
-            updateParkingTable();
-        }
+        QDateTime entryDisplayTime = store->displayEntryTime(currentCardId);
+        updateInfoPanel(info, entryDisplayTime, store->lastExitTime(currentCardId));
+        //更新停车表（在场车辆才更新）
+        store->updateInfo(currentCardId, info);
        
         //6.进行出入场逻辑（注册流程不进行出入场判断）
         if(!registrationFlowActive)
@@ -719,10 +444,7 @@ void IEEE14443ControlWidget::ensureInitialized()
 void IEEE14443ControlWidget::handleInvalidCard()
 {
     //清理停车状态
-    entryTimeMap.remove(currentCardId);
-    lastEntryTimeMap.remove(currentCardId);
-    activeInfoMap.remove(currentCardId);
-    updateParkingTable();
+    store->forget(currentCardId);
 
     //注册写卡后验证失败
     if(registrationVerificationPending)
@@ -733,14 +455,14 @@ void IEEE14443ControlWidget::handleInvalidCard()
         registrationAwaitingRemoval = false;
         registrationAwaitingCardId.clear();
         ui->parkingStatusLabel->setText(tr("写入失败，请重新刷卡"));
-        QMessageBox::warning(this, tr("注册失败"), tr("写入失败，请重新刷卡"));
+        notifier->post(NotificationBar::Warning, tr("注册失败"), tr("写入失败，请重新刷卡"));
         resumeAfterRegistration();
         return;
     }
 
     //只在第一次进入未初始化状态时提示要初始化
     if(!requiresInitialization)
-        QMessageBox::information(this, tr("未注册卡片"), tr("请先注册，不要收卡"));
+        notifier->post(NotificationBar::Info, tr("未注册卡片"), tr("请先注册，不要收卡"));
     requiresInitialization = true;
     pauseForRegistration();
     currentInfo = TagInfo();
@@ -804,34 +526,31 @@ void IEEE14443ControlWidget::startRegistrationFlow()
         ui->parkingStatusLabel->setText(tr("注册已取消"));
         return;
     }
-    if(waitingReply)
-    {
-        registrationWritePending = true;
-        registrationPendingInfo = info;
-        registrationPendingStatusText = tr("正在注册...");
-        ui->parkingStatusLabel->setText(tr("等待当前操作完成..."));
-        return;
-    }
+    //读卡器忙时写卡命令排在当前流程之后，由会话接着发出
     registrationVerificationPending = true;
     refreshAfterWrite = true;
-    writeUpdatedInfo(info);
-    ui->parkingStatusLabel->setText(tr("正在注册..."));
+    if(writeUpdatedInfo(info))
+        ui->parkingStatusLabel->setText(tr("正在注册..."));
 }
 
 // 功能：弹出充值对话框输入金额。
-bool IEEE14443ControlWidget::showRechargeDialog(int &amount)
+bool IEEE14443ControlWidget::showRechargeDialog(int &amount, int minAmount)
 {
     QDialog dialog(this);
     dialog.setWindowTitle(tr("充值"));
     QFormLayout form(&dialog);
 
-    QLabel *tipLabel = new QLabel(tr("请勿拿开卡"), &dialog);
+    //出场欠费时充值金额需超过待缴收费，直接限制输入下限
+    minAmount = qMax(1, minAmount);
+    QLabel *tipLabel = new QLabel(minAmount > 1
+                                  ? tr("请勿拿开卡，充值金额至少%1").arg(minAmount)
+                                  : tr("请勿拿开卡"), &dialog);
     tipLabel->setWordWrap(true);
     form.addRow(tipLabel);
 
     QSpinBox *amountSpin = new QSpinBox(&dialog);
-    amountSpin->setRange(1, 100000);
-    amountSpin->setValue(1);
+    amountSpin->setRange(minAmount, qMax(minAmount, 100000));
+    amountSpin->setValue(minAmount);
     form.addRow(tr("金额"), amountSpin);
 
     QDialogButtonBox buttons(QDialogButtonBox::Ok | QDialogButtonBox::Cancel, Qt::Horizontal, &dialog);
@@ -856,9 +575,9 @@ void IEEE14443ControlWidget::startRechargeFlow(int feeRequired)
     rechargeFlowActive = true;
     pauseForRecharge(feeRequired);
 
-    if(!tagAuthenticated)
+    if(!session->isAuthenticated())
     {
-        QMessageBox::warning(this, tr("Warning"), tr("authenticate first"));
+        notifier->post(NotificationBar::Warning, tr("Warning"), tr("authenticate first"));
         rechargeFlowActive = false;
         if(feeRequired == 0)
             resumeAfterRecharge();
@@ -866,68 +585,47 @@ void IEEE14443ControlWidget::startRechargeFlow(int feeRequired)
     }
     if(requiresInitialization || !currentInfo.valid)
     {
-        QMessageBox::information(this, tr("Initialization"), tr("Please register the card before recharging."));
+        notifier->post(NotificationBar::Info, tr("Initialization"), tr("Please register the card before recharging."));
         rechargeFlowActive = false;
         if(feeRequired == 0)
             resumeAfterRecharge();
         return;
     }
 
+    int minAmount = 1;
+    if(rechargePaused && pendingExitFee > 0)
+    {
+        int requiredAmount = qMax(0, pendingExitFee - currentInfo.balance);
+        if(requiredAmount > 0)
+            minAmount = requiredAmount + 1;
+    }
     int rechargeAmount = 0;
-    while(true)
+    if(!showRechargeDialog(rechargeAmount, minAmount))
     {
-        if(!showRechargeDialog(rechargeAmount))
-        {
-            rechargeFlowActive = false;
-            if(feeRequired == 0)
-                resumeAfterRecharge();
-            else
-                ui->parkingStatusLabel->setText(tr("请充值后出场"));
-            return;
-        }
-
-        if(rechargePaused && pendingExitFee > 0)
-        {
-            int requiredAmount = qMax(0, pendingExitFee - currentInfo.balance);
-            if(requiredAmount > 0 && rechargeAmount <= requiredAmount)
-            {
-                QMessageBox::warning(this, tr("Recharge"), tr("充值金额需超过待缴收费%1").arg(requiredAmount));
-                ui->parkingStatusLabel->setText(tr("请重新充值"));
-                continue;
-            }
-        }
-        break;
+        rechargeFlowActive = false;
+        if(feeRequired == 0)
+            resumeAfterRecharge();
+        else
+            ui->parkingStatusLabel->setText(tr("请充值后出场"));
+        return;
     }
 
     TagInfo info = currentInfo;
     info.balance += rechargeAmount;
     rechargeExpectedBalance = info.balance;
-    rechargePendingInfo = info;
-
-    if(waitingReply)
-    {
-        rechargeWritePending = true;
-        rechargePendingStatusText = tr("正在充值...");
-        ui->parkingStatusLabel->setText(tr("等待当前操作完成..."));
-        return;
-    }
 
+    //读卡器忙时写卡命令排在当前流程之后，由会话接着发出
     rechargeVerificationPending = true;
     refreshAfterWrite = true;
-    writeUpdatedInfo(info);
-    ui->parkingStatusLabel->setText(tr("正在充值..."));
+    if(writeUpdatedInfo(info))
+        ui->parkingStatusLabel->setText(tr("正在充值..."));
 }
 
 // 功能：计算停车费用。
-int IEEE14443ControlWidget::calculateFee(const QDateTime &enterTime, const QDateTime &leaveTime) const
+int IEEE14443ControlWidget::calculateFee(const QDateTime &enterTime, const QDateTime &leaveTime,
+                                         const QString &vehicleType) const
 {
-    int secs = (int)enterTime.secsTo(leaveTime);
-    if(secs < 0)
-        secs = 0;
-    int minutes = secs / 60;
-    int hours = (minutes + 59) / 60;
-    //return hours * kHourFee;
-    return secs;//测试用
+    return tariff.fee(enterTime, leaveTime, vehicleType);
 }
 
 // 功能：处理停车进出场业务流程。
@@ -942,14 +640,13 @@ void IEEE14443ControlWidget::handleParkingFlow()
     if(requiresInitialization)
     {
         ui->parkingStatusLabel->setText(tr("Card not initialized, please register"));
-        entryTimeMap.remove(currentCardId);
-        lastEntryTimeMap.remove(currentCardId);
+        store->forget(currentCardId);
         return;
     }
     //记录当前时间
     QDateTime now = QDateTime::currentDateTime();
-    //若entryTimeMap包括当前卡号——出场
-    if(entryTimeMap.contains(currentCardId))
+    //若当前卡号在场——出场（入场可能在别的通道）
+    if(store->isParked(currentCardId))
     {
         if(parkingFlowState == ParkingFlowIdle)
         {
@@ -959,9 +656,9 @@ void IEEE14443ControlWidget::handleParkingFlow()
             ui->parkingStatusLabel->setText(tr("正在出场中，不要收卡"));
         }
         //获取入场时间
-        QDateTime enter = entryTimeMap.value(currentCardId);
+        QDateTime enter = store->entryTime(currentCardId);
         //算钱
-        int fee = pendingExitFee > 0 ? pendingExitFee : calculateFee(enter, now);
+        int fee = pendingExitFee > 0 ? pendingExitFee : calculateFee(enter, now, currentInfo.vehicleType);
         //钱不够，提醒
         if(currentInfo.balance < fee)
         {
@@ -969,23 +666,16 @@ void IEEE14443ControlWidget::handleParkingFlow()
             ui->parkingStatusLabel->setText(tr("余额不足，请先充值，待缴收费%1").arg(fee));
             updateInfoPanel(currentInfo, enter, QDateTime());
             //进入充值流程
-            QMessageBox::warning(this, tr("出场"), tr("余额不足，请先充值，待缴收费%1").arg(fee));
+            notifier->post(NotificationBar::Warning, tr("出场"), tr("余额不足，请先充值，待缴收费%1").arg(fee));
             startRechargeFlow(fee);
             return;
         }
 
-        //移除入场时间信息
-        entryTimeMap.remove(currentCardId);
-        activeInfoMap.remove(currentCardId);
-        updateParkingTable();
-        //更新最近出场信息
-        lastExitTimeMap.insert(currentCardId, now);
-        //更新最近入场信息
-        lastEntryTimeMap.insert(currentCardId, enter);
-        //扣费
+        //扣费；出场等扣费写卡成功再记（onWriteFinished），写卡失败车辆仍在场
         currentInfo.balance -= fee;
         pendingExitFee = 0;
         lastExitFee = fee;
+        pendingExitTime = now;
         ui->parkingStatusLabel->setText(tr("正在出场中，不要收卡"));
         updateInfoPanel(currentInfo, QDateTime(), now);
 
@@ -1005,28 +695,41 @@ void IEEE14443ControlWidget::handleParkingFlow()
             stopAutoSearch();
             ui->parkingStatusLabel->setText(tr("正在入场中，不要收卡"));
         }
-        entryTimeMap.insert(currentCardId, now);
-        activeInfoMap.insert(currentCardId, currentInfo);
-        updateParkingTable();
-        lastEntryTimeMap.insert(currentCardId, now);
+        //卡号存不进停车表：不放行，等收卡
+        if(!store->recordEntry(currentCardId, now, currentInfo))
+        {
+            notifier->post(NotificationBar::Error, tr("入场"), tr("卡号%1无法识别，不能入场").arg(currentCardId));
+            ui->parkingStatusLabel->setText(tr("卡号无法识别，不能入场"));
+            parkingAwaitingRemoval = true;
+            parkingAwaitingCardId = currentCardId;
+            session->setAwaitingRemoval(currentCardId);
+            parkingFlowState = ParkingFlowIdle;
+            parkingFlowPaused = false;
+            startAutoSearch();
+            return;
+        }
         pendingExitFee = 0;
         updateInfoPanel(currentInfo, now, QDateTime());
-        QMessageBox::information(this, tr("入场"), tr("入场成功，请收卡"));
-        ui->parkingStatusLabel->setText(tr(""));
+        notifier->post(NotificationBar::Success, tr("入场"), tr("入场成功，请收卡"));
+        ui->parkingStatusLabel->setText(tr("入场成功，请收卡"));
+        parkingAwaitingRemoval = true;
+        parkingAwaitingCardId = currentCardId;
+        session->setAwaitingRemoval(currentCardId);
         parkingFlowState = ParkingFlowIdle;
         parkingFlowPaused = false;
         startAutoSearch();
     }
 }
 
-// 功能：写回更新后的卡信息。
-void IEEE14443ControlWidget::writeUpdatedInfo(const TagInfo &info)
+// 功能：写回更新后的卡信息。写卡没能发出时按写卡失败结束当前流程，返回 false。
+bool IEEE14443ControlWidget::writeUpdatedInfo(const TagInfo &info)
 {
     //检查是否认证
-    if(!tagAuthenticated)
+    if(!session->isAuthenticated())
     {
-        QMessageBox::warning(this, tr("Warning"), tr("authenticate first"));
-        return;
+        notifier->post(NotificationBar::Warning, tr("Warning"), tr("authenticate first"));
+        onWriteFinished(false);
+        return false;
     }
     //把车主信息编写成块
     QByteArray b1;
@@ -1034,452 +737,280 @@ void IEEE14443ControlWidget::writeUpdatedInfo(const TagInfo &info)
     encodeTagInfo(info, b1, b2);
     //生成待写入信息
     pendingWriteInfo = info;
-    //写入b1
-    requestWrite(kUserBlock1, b1);
+    //写入b1、b2；会话不收就不会有 writeFinished()，在这里结束流程
+    if(!session->writeUserBlocks(b1, b2))
+    {
+        onWriteFinished(false);
+        return false;
+    }
 
     //保存待写入info的副本
     lastBlock1 = b1;
     lastBlock2 = b2;
+    return true;
 }
 
-// === 超时与重复包处理 ===
-// 功能：启动等待回包超时计时。
-void IEEE14443ControlWidget::startReplyTimeout(quint8 command)
+// === 会话事件（事件驱动） ===
+// 功能：显示每条命令的执行结果。
+void IEEE14443ControlWidget::onCommandCompleted(quint8 command, quint8 status, const QByteArray &data)
 {
-    Q_UNUSED(command);
-    if(!replyTimeoutTimer)
+    QString resultTipText;
+    switch(command)
+    {
+    case IEEE1443Package::SearchCard:
+        resultTipText = tr("Search Card ");
+        break;
+    case IEEE1443Package::AntiColl:
+        resultTipText = tr("AntiColl ");
+        break;
+    case IEEE1443Package::SelectCard:
+        resultTipText = tr("Select Card ");
+        break;
+    case IEEE1443Package::Authentication:
+        resultTipText = tr("Authentication ");
+        break;
+    case IEEE1443Package::ReadCard:
+        resultTipText = tr("Read Card ");
+        break;
+    case IEEE1443Package::WriteCard:
+        resultTipText = tr("Write Card ");
+        break;
+    default:
         return;
-    replyTimeoutTimer->setInterval(replyTimeoutMs);
-    replyTimeoutTimer->start();
+    }
+    if(status != 0)
+    {
+        ui->resultLabel->setText(resultTipText + tr("Failure"));
+        return;
+    }
+    resultTipText += tr("Succeed");
+    if(command == IEEE1443Package::AntiColl)
+        resultTipText += tr(", Card Id is %1").arg(QString(data.toHex()));
+    else if(command == IEEE1443Package::SelectCard && !data.isEmpty())
+        resultTipText += tr(", Type is %1").arg(data.at(0) == 0x08 ? "S50" : "S70");
+    ui->resultLabel->setText(resultTipText);
 }
 
-// 功能：处理回包超时失败逻辑。
-void IEEE14443ControlWidget::handleReplyTimeoutFailure(int command)
+// 功能：命令重试用尽，结束本次流程。
+void IEEE14443ControlWidget::onCommandFailed(quint8 command)
 {
     if(command == IEEE1443Package::SearchCard)
     {
-        if(registrationAwaitingRemoval)
-        {
-            registrationAwaitingRemoval = false;
-            registrationAwaitingCardId.clear();
-        }
-        if(rechargeAwaitingRemoval)
-        {
-            rechargeAwaitingRemoval = false;
-            rechargeAwaitingCardId.clear();
-        }
-        currentCardId.clear();
-        tagAuthenticated = false;
         ui->resultLabel->setText(tr("Search Card Failure"));
         return;
     }
-
-    if(command == IEEE1443Package::ReadCard)
-        pendingReadBlock = -1;
-    if(command == IEEE1443Package::WriteCard)
-        pendingWriteBlock = -1;
-    refreshAfterWrite = false;
+    //读写块超时已由 onReadFailed()/onWriteFinished(false) 收尾
     ui->resultLabel->setText(tr("Command Timeout"));
 }
 
-// 功能：判断是否为重复响应包。
-bool IEEE14443ControlWidget::isDuplicateResponse(const IEEE1443Package &pkg)
+// 功能：防冲突得到卡号。
+void IEEE14443ControlWidget::onCardDetected(const QString &cardId)
 {
-    const int kDuplicateWindowMs = 800;
-    QString signature = QString::number(pkg.command()) + ":" + QString(pkg.data().toHex());
-    QDateTime now = QDateTime::currentDateTime();
-    if(recentReplyTimestamps.contains(signature))
-    {
-        if(recentReplyTimestamps.value(signature).msecsTo(now) <= kDuplicateWindowMs)
-            return true;
-    }
-    recentReplyTimestamps.insert(signature, now);
-    pruneRecentReplies();
-    return false;
+    currentCardId = cardId;
+    ui->selCardIdEdit->setText(currentCardId);
 }
 
-// 功能：清理历史响应记录。
-void IEEE14443ControlWidget::pruneRecentReplies()
+// 功能：读卡器前没有卡：结束等待取卡状态。
+void IEEE14443ControlWidget::onCardLost()
 {
-    const int kKeepWindowMs = 3000;
-    QDateTime now = QDateTime::currentDateTime();
-    QHash<QString, QDateTime>::iterator it = recentReplyTimestamps.begin();
-    while(it != recentReplyTimestamps.end())
+    if(registrationAwaitingRemoval)
     {
-        if(it.value().msecsTo(now) > kKeepWindowMs)
-            it = recentReplyTimestamps.erase(it);
-        else
-            ++it;
+        registrationAwaitingRemoval = false;
+        registrationAwaitingCardId.clear();
     }
-}
-
-// === 信号槽（事件驱动） ===
-// 功能：串口数据就绪事件处理。
-void IEEE14443ControlWidget::onPortDataReady()
-{
-    QByteArray bytes;
-    int a = commPort->bytesAvailable();
-    bytes.resize(a);
-    char *p = bytes.data();
-    int len = bytes.size();
-    commPort->read(p, len);
-    while(len--)
+    if(rechargeAwaitingRemoval)
     {
-        switch(recvStatus)
-        {
-        case 0:// recv sync code
-            if(*p == 0x02)
-            {
-                recvStatus = 1;
-                lastRecvPackage.clear();
-                lastRecvPackage.append(*p);
-            }
-            p++;
-            break;
-        case 1:// normal recv
-            if(*p == 0x10)
-                recvStatus = 2;
-            else if(*p == 0x03)
-            {
-                // recved a end code
-                lastRecvPackage.append(*p);
-                emit recvPackage(lastRecvPackage);
-                recvStatus = 0;
-            }
-            else // just append the data
-                lastRecvPackage.append(*p);
-            p++;
-            break;
-        case 2:// recved a escape code last time, so just append data to the package
-            lastRecvPackage.append(*p++);
-            recvStatus = 1;
-            break;
-        }
+        rechargeAwaitingRemoval = false;
+        rechargeAwaitingCardId.clear();
     }
+    if(parkingAwaitingRemoval)
+    {
+        parkingAwaitingRemoval = false;
+        parkingAwaitingCardId.clear();
+        ui->parkingStatusLabel->setText(tr(""));
+    }
+    // 无卡时清掉当前卡状态，避免“同卡再次放卡”被误判为没收卡
+    currentCardId.clear();
 }
 
-// 功能：处理接收到的数据包。
-void IEEE14443ControlWidget::onRecvedPackage(QByteArray pkg)
+// 功能：块1、块2读取完成，根据卡信息做相应处理。
+//       信号在会话的命令回调里发出（寻卡链还没结束），注册/充值会弹出模态对话框，
+//       嵌套的事件循环不能跑在回调里，所以排到回调返回之后再处理。
+void IEEE14443ControlWidget::onCardRead(const QString &cardId, const QByteArray &block1, const QByteArray &block2)
 {
+    Q_UNUSED(cardId);
+    lastBlock1 = block1;
+    lastBlock2 = block2;
+    QTimer::singleShot(0, this, SLOT(ensureInitialized()));
+}
 
-    //1.前置检验
-    IEEE1443Package p(pkg);
-    if(!p.isValid())
-        return;
-    if(!waitingReply && pendingCommand < 0)//没有等待响应
-        return;
-    if(waitingReply && pendingCommand >= 0 && p.command() != pendingCommand)//等待响应但指令码不匹配
-        return;
-    if(isDuplicateResponse(p))//避免重复响应
+// 功能：读块失败：充值校验失败或出入场失败。
+void IEEE14443ControlWidget::onReadFailed()
+{
+    //若是注册校验：写入结果不确定，重新刷卡
+    if(registrationVerificationPending)
+    {
+        registrationVerificationPending = false;
+        registrationFlowActive = false;
+        requiresInitialization = false;
+        notifier->post(NotificationBar::Warning, tr("注册失败"), tr("请重新刷卡"));
+        ui->parkingStatusLabel->setText(tr("注册失败，请重新刷卡"));
+        resumeAfterRegistration();
         return;
-    if(replyTimeoutTimer && replyTimeoutTimer->isActive())//停止超时计时器
-        replyTimeoutTimer->stop();
-
-    //2.打印日志，解析load
-    qDebug() << QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss")
-             << QString("recieve cmd=0x%1 data=%2")
-                .arg(p.command(), 2, 16, QChar('0'))
-                .arg(QString(p.data().toHex()));
-    QByteArray d = p.data();
-    if(d.isEmpty())
+    }
+    //若是充值校验
+    if(rechargeVerificationPending)
     {
-        qDebug() << QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss")
-                 << "empty payload for cmd" << p.command();
-                 
-        //清理等待状态
-        waitingReply = false;
-        pendingCommand = -1;
-        autoSearchInProgress = false;
+        rechargeVerificationPending = false;
+        rechargeFlowActive = false;
+        refreshAfterWrite = false;
+        notifier->post(NotificationBar::Warning, tr("充值失败"), tr("请重新充值"));
+        ui->parkingStatusLabel->setText(tr("请重新充值"));
+        abandonRecharge();
         return;
     }
-    //记录指令状态和信息
-    int status = d.at(0);
-    d = d.mid(1);
-    waitingReply = false;
-    pendingCommand = -1;
-    pendingRetries = 0;//当前重试发包次数
-    QString resultTipText;
-
-    //3.命令分发逻辑
-    switch(p.command())
+    //若不是注册流程且卡已识别——出入场逻辑
+    if(!registrationFlowActive && !requiresInitialization && !currentCardId.isEmpty())
     {
-    case IEEE1443Package::SearchCard:
-        resultTipText = tr("Search Card ");
-        if(status == 0)
-        {
-            resultTipText += tr("Succeed");
-            requestAntiColl();
-        }
+        bool parked = store->isParked(currentCardId);
+        if(parked)
+            notifier->post(NotificationBar::Warning, tr("出场"), tr("出场失败，请重新刷卡"));
         else
-        {
-            resultTipText += tr("Failure");
-            autoSearchInProgress = false;
-            if(registrationAwaitingRemoval)
-            {
-                registrationAwaitingRemoval = false;
-                registrationAwaitingCardId.clear();
-            }
-            // 新增：充值等待收卡
-            if(rechargeAwaitingRemoval)
-            {
-                rechargeAwaitingRemoval = false;
-                rechargeAwaitingCardId.clear();
-            }
+            notifier->post(NotificationBar::Warning, tr("入场"), tr("入场失败，请重新刷卡"));
+        ui->parkingStatusLabel->setText(parked
+                                        ? tr("出场失败，请重新刷卡")
+                                        : tr("入场失败，请重新刷卡"));
+        parkingFlowState = ParkingFlowIdle;
+        parkingFlowPaused = false;
+        parkingExitWritePending = false;
+        startAutoSearch();
+    }
+}
 
-            // 无卡时清掉当前卡状态，避免“同卡再次放卡”被误判为没收卡
-            currentCardId.clear();
-            tagAuthenticated = false;
-        }
-        break;
-    case IEEE1443Package::AntiColl:
-        resultTipText = tr("AntiColl ");
-        if(status == 0)
-        {
-            resultTipText += tr("Succeed");
-            resultTipText += tr(", Card Id is %1").arg(QString(d.toHex()));
-            currentCardId = d.toHex();
-            ui->selCardIdEdit->setText(currentCardId);
-            requestSelect(d);
-        }
-        else
-        {
-            resultTipText += tr("Failure");
-            autoSearchInProgress = false;
-        }
-        break;
-    case IEEE1443Package::SelectCard:
-        resultTipText = tr("Select Card ");
-        if(status == 0)
-        {
-            resultTipText += tr("Succeed");
-            resultTipText += tr(", Type is %1").arg(d.at(0) == 0x08 ? "S50" : "S70");
-            tagAuthenticated = false;
-            //停车系统实现自动识别卡片功能，自动进行认证
-            requestAuth(kUserBlock1);
-        }
-        else
+// 功能：两块写卡结束：读回校验、充值放行或出场完成。
+void IEEE14443ControlWidget::onWriteFinished(bool ok)
+{
+    if(!ok)
+    {
+        refreshAfterWrite = false;
+        if(registrationVerificationPending)
         {
-            resultTipText += tr("Failure");
-            autoSearchInProgress = false;
+            registrationVerificationPending = false;
+            registrationFlowActive = false;
+            requiresInitialization = false;
+            notifier->post(NotificationBar::Warning, tr("注册失败"), tr("写入失败，请重新刷卡"));
+            ui->parkingStatusLabel->setText(tr("写入失败，请重新刷卡"));
+            resumeAfterRegistration();
         }
-        break;
-    case IEEE1443Package::Authentication:
-        resultTipText = tr("Authentication ");
-        if(status == 0)
-            resultTipText += tr("Succeed");
-        else
-            resultTipText += tr("Failure");
-        tagAuthenticated = (status == 0);//记录认证信息
-        if(tagAuthenticated)
-            requestRead(kUserBlock1);//停车系统实现自动识别卡片功能，自动读块1用于判断是不是停车系统
-        else
-            autoSearchInProgress = false;
-        break;
-    case IEEE1443Package::ReadCard:
-        resultTipText = tr("Read Card ");
-        if(status == 0)
+        if(rechargeVerificationPending || rechargeFlowActive)
         {
-            resultTipText += tr("Succeed");
-            //待读块1
-            if(pendingReadBlock == kUserBlock1)
-            {
-                lastBlock1 = d;//保存块1
-                requestRead(kUserBlock2);//读完块1，自动读块2
-            }
-            else if(pendingReadBlock == kUserBlock2)//待读块2
-            {
-                lastBlock2 = d;
-                pendingReadBlock = -1;
-                //根据读到的卡信息做相应处理
-                ensureInitialized();
-                autoSearchInProgress = false;
-            }
+            rechargeVerificationPending = false;
+            rechargeFlowActive = false;
+            notifier->post(NotificationBar::Warning, tr("充值失败"), tr("请重新充值"));
+            ui->parkingStatusLabel->setText(tr("请重新充值"));
+            abandonRecharge();
         }
-        else
+        if(parkingExitWritePending && parkingFlowState == ParkingFlowExit)
         {
-            resultTipText += tr("Failure");
-            pendingReadBlock = -1;
-            autoSearchInProgress = false;
-            //若是充值校验
-            if(rechargeVerificationPending)
-            {
-                rechargeVerificationPending = false;
-                rechargeFlowActive = false;
-                refreshAfterWrite = false;
-                QMessageBox::warning(this, tr("充值失败"), tr("请重新充值"));
-                ui->parkingStatusLabel->setText(tr("请重新充值"));
-                break;
-            }
-            //若不是注册流程且卡已识别——出入场逻辑
-            if(!registrationFlowActive && !requiresInitialization && !currentCardId.isEmpty())
-            {
-                if(entryTimeMap.contains(currentCardId))
-                    QMessageBox::warning(this, tr("出场"), tr("出场失败，请重新刷卡"));
-                else
-                    QMessageBox::warning(this, tr("入场"), tr("入场失败，请重新刷卡"));
-                ui->parkingStatusLabel->setText(entryTimeMap.contains(currentCardId)
-                                                ? tr("出场失败，请重新刷卡")
-                                                : tr("入场失败，请重新刷卡"));
-                parkingFlowState = ParkingFlowIdle;
-                parkingFlowPaused = false;
-                parkingExitWritePending = false;
-                startAutoSearch();
-            }
+            parkingExitWritePending = false;
+            notifier->post(NotificationBar::Warning, tr("出场"), tr("出场失败，请重新刷卡"));
+            ui->parkingStatusLabel->setText(tr("出场失败，请重新刷卡"));
+            parkingFlowState = ParkingFlowIdle;
+            parkingFlowPaused = false;
+            lastExitFee = 0;
+            startAutoSearch();
         }
-        break;
-    case IEEE1443Package::WriteCard:
-        resultTipText = tr("Write Card ");
-        if(status == 0)//写成功
-        {
-            resultTipText += tr("Succeed");
-            //继续写下一块
-            if(pendingWriteBlock == kUserBlock1)
-            {
-                pendingWriteBlock = -1;
-                requestWrite(kUserBlock2, lastBlock2);
-            }
-            else if(pendingWriteBlock == kUserBlock2)//如果b2已写入
-            {
-                pendingWriteBlock = -1;
-                currentInfo = pendingWriteInfo;//更新当前info
+        return;
+    }
 
-                //需要读回验证——注册、充值
-                if(refreshAfterWrite)
-                {
-                    refreshAfterWrite = false;
-                    requestRead(kUserBlock1);//马上读块1
-                }
-                else//不需要读回验证——出场
-                {
-                    //更新ui
-                    QDateTime entryDisplayTime =
-                            entryTimeMap.contains(currentCardId) ?//仍然在场？
-                            entryTimeMap.value(currentCardId) ://当前入场时间
-                            lastEntryTimeMap.value(currentCardId);//最近入场时间
-                    updateInfoPanel(pendingWriteInfo, entryDisplayTime, lastExitTimeMap.value(currentCardId));
-
-                    //更新停车标
-                    if(entryTimeMap.contains(currentCardId) && pendingWriteInfo.valid)
-                    {
-                        activeInfoMap.insert(currentCardId, pendingWriteInfo);
-                        updateParkingTable();
-                    }
-                }
+    currentInfo = pendingWriteInfo;//更新当前info
 
-                //充值——余额足够
-                if(rechargePaused && !rechargeVerificationPending)
-                {
-                    currentInfo = pendingWriteInfo;//同步到系统当前信息
-                    if(currentInfo.balance >= pendingExitFee)//钱够，放行
-                    {
-                        resumeAfterRecharge();//继续寻卡
-                        handleParkingFlow();//继续放行
-                    }
-                    else//出场时钱不够，待充值，保持rechargePaused状态，待充值
-                    {
-                        QMessageBox::warning(this, tr("Recharge"), tr("Balance is still below required fee %1").arg(pendingExitFee));
-                    }
-                }
+    //需要读回验证——注册、充值
+    if(refreshAfterWrite)
+    {
+        refreshAfterWrite = false;
+        session->readUserBlocks();//马上读块1、块2
+    }
+    else//不需要读回验证——出场
+    {
+        //扣费写卡成功，移除入场信息，记录最近入场/出场时间
+        if(parkingExitWritePending && parkingFlowState == ParkingFlowExit)
+            store->recordExit(currentCardId, pendingExitTime);
+        //更新ui
+        QDateTime entryDisplayTime = store->displayEntryTime(currentCardId);//仍然在场取当前入场时间，否则取最近入场时间
+        updateInfoPanel(pendingWriteInfo, entryDisplayTime, store->lastExitTime(currentCardId));
 
-                //出场写卡成功
-                if(parkingExitWritePending && parkingFlowState == ParkingFlowExit && !rechargePaused)
-                {
-                    parkingExitWritePending = false;
-                    QMessageBox::information(this, tr("出场"), tr("出场成功，请收卡，费用为%1").arg(lastExitFee));
-                    ui->parkingStatusLabel->setText(tr(""));
-                    parkingFlowState = ParkingFlowIdle;
-                    parkingFlowPaused = false;
-                    lastExitFee = 0;
-                    startAutoSearch();
-                }
+        //更新停车表
+        if(pendingWriteInfo.valid)
+            store->updateInfo(currentCardId, pendingWriteInfo);
+    }
 
-            }
+    //充值——余额足够
+    if(rechargePaused && !rechargeVerificationPending)
+    {
+        currentInfo = pendingWriteInfo;//同步到系统当前信息
+        if(currentInfo.balance >= pendingExitFee)//钱够，放行
+        {
+            resumeAfterRecharge();//继续寻卡
+            handleParkingFlow();//继续放行
         }
-        else
+        else//出场时钱不够，待充值，保持rechargePaused状态，待充值
         {
-            resultTipText += tr("Failure");
-            pendingWriteBlock = -1;
-            refreshAfterWrite = false;
-            if(rechargeVerificationPending || rechargeFlowActive)
-            {
-                rechargeVerificationPending = false;
-                rechargeFlowActive = false;
-                rechargeWritePending = false;
-                QMessageBox::warning(this, tr("充值失败"), tr("请重新充值"));
-                ui->parkingStatusLabel->setText(tr("请重新充值"));
-            }
-            if(parkingExitWritePending && parkingFlowState == ParkingFlowExit)
-            {
-                parkingExitWritePending = false;
-                QMessageBox::warning(this, tr("出场"), tr("出场失败，请重新刷卡"));
-                ui->parkingStatusLabel->setText(tr("出场失败，请重新刷卡"));
-                parkingFlowState = ParkingFlowIdle;
-                parkingFlowPaused = false;
-                lastExitFee = 0;
-                startAutoSearch();
-            }
+            notifier->post(NotificationBar::Warning, tr("Recharge"), tr("Balance is still below required fee %1").arg(pendingExitFee));
         }
-        break;
     }
 
-    //4.写卡后自动触发二次写入逻辑
-    //注册写卡
-    if(registrationWritePending && !waitingReply)
-    {
-        registrationWritePending = false;
-        registrationVerificationPending = true;
-        refreshAfterWrite = true;
-        writeUpdatedInfo(registrationPendingInfo);
-        ui->parkingStatusLabel->setText(registrationPendingStatusText);
-    }
-    //充值写卡
-    if(rechargeWritePending && !waitingReply)
+    //出场写卡成功
+    if(parkingExitWritePending && parkingFlowState == ParkingFlowExit && !rechargePaused)
     {
-        rechargeWritePending = false;
-        rechargeVerificationPending = true;
-        refreshAfterWrite = true;
-        rechargeExpectedBalance = rechargePendingInfo.balance;
-        writeUpdatedInfo(rechargePendingInfo);
-        ui->parkingStatusLabel->setText(rechargePendingStatusText);
+        parkingExitWritePending = false;
+        notifier->post(NotificationBar::Success, tr("出场"), tr("出场成功，请收卡，费用为%1").arg(lastExitFee));
+        ui->parkingStatusLabel->setText(tr("出场成功，请收卡，费用为%1").arg(lastExitFee));
+        parkingAwaitingRemoval = true;
+        parkingAwaitingCardId = currentCardId;
+        session->setAwaitingRemoval(currentCardId);
+        parkingFlowState = ParkingFlowIdle;
+        parkingFlowPaused = false;
+        lastExitFee = 0;
+        startAutoSearch();
     }
-    ui->resultLabel->setText(resultTipText);
 }
 
+// === 信号槽（事件驱动） ===
 // 功能：状态列表滚动范围变化处理。
 void IEEE14443ControlWidget::onStatusListScrollRangeChanced(int min, int max)
 {
 //    ui->statusList->verticalScrollBar()->setValue(max);
 }
 
-// 功能：自动寻卡定时器超时处理。
-void IEEE14443ControlWidget::onAutoSearchTimeout()
+// 功能：刷新通讯统计：首行是按运行时长折算的每小时异常次数，其后是快照原文。
+void IEEE14443ControlWidget::refreshMetricsView()
 {
-    if(registrationPaused || rechargePaused || requiresInitialization || parkingFlowPaused)
+    if(!ui->metricsView)
         return;
-    if(autoSearchInProgress)
-        return;
-    requestSearch();//每过一小段时间，就请求寻卡
+    LaneMetrics::Snapshot snap = session->metrics().snapshot();
+    double hours = qMax<qint64>(1, snap.uptimeMs) / 3600000.0;
+    QString rates = QString("每小时：重发 %1  失败 %2  重复包 %3  认证失败 %4  读写失败 %5")
+            .arg(snap.counters[LaneMetrics::Retried] / hours, 0, 'f', 1)
+            .arg(snap.counters[LaneMetrics::Failed] / hours, 0, 'f', 1)
+            .arg(snap.counters[LaneMetrics::DuplicatesDropped] / hours, 0, 'f', 1)
+            .arg(snap.counters[LaneMetrics::AuthFailures] / hours, 0, 'f', 1)
+            .arg((snap.counters[LaneMetrics::ReadFailures] + snap.counters[LaneMetrics::WriteFailures]) / hours, 0, 'f', 1);
+    ui->metricsView->setPlainText(rates + "\n" + snap.toText());
 }
 
-// 功能：等待回包超时处理。
-void IEEE14443ControlWidget::onReplyTimeout()
+// 功能：在本通道的提示条上显示警告。
+void IEEE14443ControlWidget::postWarning(const QString &title, const QString &text)
 {
-    if(!waitingReply || pendingCommand < 0)
-        return;
-    if(pendingRetries < maxReplyRetries)
-    {
-        pendingRetries++;
-        IEEE1443Package retryPackage(lastSendPackage);
-        if(retryPackage.isValid() && commPort)
-        {
-            commPort->write(retryPackage.toRawPackage());
-            startReplyTimeout(pendingCommand);
-            return;
-        }
-    }
-    int failedCommand = pendingCommand;
-    waitingReply = false;
-    pendingCommand = -1;
-    autoSearchInProgress = false;
-    handleReplyTimeoutFailure(failedCommand);
+    notifier->post(NotificationBar::Warning, title, text);
+}
+
+// 功能：按需导出本通道最近的收发字节（追加到 RFID_TRACE，默认 ./frames.trace）。
+void IEEE14443ControlWidget::onTraceDumpClicked()
+{
+    QString error;
+    if(session->dumpTrace(QString("manual %1").arg(portName), &error))
+        notifier->post(NotificationBar::Info, tr("收发记录"), tr("已导出到 %1").arg(FrameTrace::configuredPath()), 3000);
+    else
+        notifier->post(NotificationBar::Warning, tr("收发记录"), tr("导出失败：%1").arg(error), 3000);
 }
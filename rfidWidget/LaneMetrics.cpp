@@ -0,0 +1,233 @@
+#include "LaneMetrics.h"
+#include <QStringList>
+#include <string.h>
+
+static const char *const kCounterNames[LaneMetrics::CounterCount] = {
+    "dispatched", "retried", "replyTimeouts", "failed", "txRejected", "duplicatesDropped", "unmatchedReplies",
+    "spuriousRetries", "authFailures", "readFailures", "writeFailures", "cardsDetected", "cardsLost"
+};
+
+static const char *const kCommandCounterNames[LaneMetrics::CommandCounterCount] = {
+    "sent", "replied", "retried", "failed"
+};
+
+// 功能：最高位的位置（v > 0）。
+static inline int highestBit(quint32 v)
+{
+#if defined(__GNUC__)
+    return 31 - __builtin_clz(v);
+#else
+    int k = 0;
+    while(v >>= 1)
+        k++;
+    return k;
+#endif
+}
+
+
+// === 直方图 ===
+// 功能：值所在的桶：小于8直接作下标；否则 (最高位-2)*8 + 最高位之后的3位。
+int LatencyHistogram::bucketOf(quint32 us)
+{
+    if(us < SubBuckets)
+        return (int)us;
+    int k = highestBit(us);
+    return (k - SubBits + 1) * SubBuckets + (int)((us >> (k - SubBits)) & (SubBuckets - 1));
+}
+
+quint32 LatencyHistogram::bucketLow(int bucket)
+{
+    if(bucket < SubBuckets)
+        return (quint32)bucket;
+    int group = bucket / SubBuckets;
+    return (quint32)(SubBuckets + bucket % SubBuckets) << (group - 1);
+}
+
+quint32 LatencyHistogram::bucketHigh(int bucket)
+{
+    if(bucket + 1 >= BucketCount)
+        return 0xFFFFFFFFu;
+    return bucketLow(bucket + 1) - 1;
+}
+
+// 功能：记一个样本：桶计数加一，最大值用比较交换更新。
+void LatencyHistogram::record(quint32 us)
+{
+    counts[bucketOf(us)].fetchAndAddRelaxed(1);
+    int v = (int)qMin(us, (quint32)0x7FFFFFFF);
+    int cur = _maxUs.fetchAndAddRelaxed(0);
+    while(v > cur && !_maxUs.testAndSetRelaxed(cur, v))
+        cur = _maxUs.fetchAndAddRelaxed(0);
+}
+
+quint64 LaneMetrics::Histogram::total() const
+{
+    quint64 n = 0;
+    for(int i = 0; i < counts.size(); i++)
+        n += counts.at(i);
+    return n;
+}
+
+quint32 LaneMetrics::Histogram::percentileUs(double q) const
+{
+    quint64 n = total();
+    if(n == 0)
+        return 0;
+    quint64 rank = (quint64)(q * n + 0.999999);
+    if(rank < 1)
+        rank = 1;
+    quint64 seen = 0;
+    for(int i = 0; i < counts.size(); i++)
+    {
+        seen += counts.at(i);
+        if(seen >= rank)
+            return qMin(LatencyHistogram::bucketHigh(i), maxUs);
+    }
+    return maxUs;
+}
+
+double LaneMetrics::Histogram::meanUs() const
+{
+    quint64 n = 0;
+    double sum = 0.0;
+    for(int i = 0; i < counts.size(); i++)
+    {
+        if(counts.at(i) == 0)
+            continue;
+        double mid = ((double)LatencyHistogram::bucketLow(i) + LatencyHistogram::bucketHigh(i)) / 2.0;
+        sum += mid * counts.at(i);
+        n += counts.at(i);
+    }
+    return n ? sum / n : 0.0;
+}
+
+void LaneMetrics::Histogram::merge(const Histogram &other)
+{
+    for(int i = 0; i < counts.size() && i < other.counts.size(); i++)
+        counts[i] += other.counts.at(i);
+    maxUs = qMax(maxUs, other.maxUs);
+}
+
+
+// === 快照 ===
+LaneMetrics::Snapshot::Snapshot() :
+    uptimeMs(0)
+{
+    memset(counters, 0, sizeof(counters));
+}
+
+const char *LaneMetrics::Snapshot::counterName(int counter)
+{
+    if(counter < 0 || counter >= CounterCount)
+        return "";
+    return kCounterNames[counter];
+}
+
+// 功能：合并另一条通道的快照（计数相加、分布合并，运行时长取较长的）。
+void LaneMetrics::Snapshot::merge(const Snapshot &other)
+{
+    uptimeMs = qMax(uptimeMs, other.uptimeMs);
+    for(int i = 0; i < CounterCount; i++)
+        counters[i] += other.counters[i];
+    for(int k = 0; k < other.commands.size(); k++)
+    {
+        const Command &src = other.commands.at(k);
+        int i = 0;
+        while(i < commands.size() && commands.at(i).code < src.code)
+            i++;
+        if(i == commands.size() || commands.at(i).code != src.code)
+        {
+            commands.insert(i, src);
+            continue;
+        }
+        Command &dst = commands[i];
+        for(int c = 0; c < CommandCounterCount; c++)
+            dst.counts[c] += src.counts[c];
+        dst.latency.merge(src.latency);
+    }
+}
+
+// 功能：序列化：
+//   uptime ms=...
+//   counters dispatched=... retried=... ...
+//   cmd 0x46 sent=... replied=... retried=... failed=... n=... mean=...us p50=...us p90=...us p99=...us max=...us
+//   hist 0x46 桶下界:次数 ...（只列非零桶，可以还原直方图）
+QString LaneMetrics::Snapshot::toText() const
+{
+    QStringList lines;
+    lines << QString("uptime ms=%1").arg(uptimeMs);
+    QStringList fields;
+    for(int i = 0; i < CounterCount; i++)
+        fields << QString("%1=%2").arg(kCounterNames[i]).arg(counters[i]);
+    lines << "counters " + fields.join(" ");
+    for(int k = 0; k < commands.size(); k++)
+    {
+        const Command &c = commands.at(k);
+        QString code = QString("0x%1").arg(c.code, 2, 16, QChar('0'));
+        fields.clear();
+        for(int i = 0; i < CommandCounterCount; i++)
+            fields << QString("%1=%2").arg(kCommandCounterNames[i]).arg(c.counts[i]);
+        const Histogram &h = c.latency;
+        fields << QString("n=%1").arg(h.total())
+               << QString("mean=%1us").arg((qint64)h.meanUs())
+               << QString("p50=%1us").arg(h.percentileUs(0.50))
+               << QString("p90=%1us").arg(h.percentileUs(0.90))
+               << QString("p99=%1us").arg(h.percentileUs(0.99))
+               << QString("max=%1us").arg(h.maxUs);
+        lines << "cmd " + code + " " + fields.join(" ");
+        fields.clear();
+        for(int i = 0; i < h.counts.size(); i++)
+        {
+            if(h.counts.at(i))
+                fields << QString("%1:%2").arg(LatencyHistogram::bucketLow(i)).arg(h.counts.at(i));
+        }
+        if(!fields.isEmpty())
+            lines << "hist " + code + " " + fields.join(" ");
+    }
+    return lines.join("\n");
+}
+
+
+// === 记录 ===
+LaneMetrics::LaneMetrics()
+{
+    clock.start();
+}
+
+void LaneMetrics::recordLatency(quint8 command, qint64 us)
+{
+    int slot = command - FirstCommand;
+    if(slot < 0 || slot >= CommandSlots)
+        return;
+    if(us < 0)
+        us = 0;
+    latency[slot].record(us > 0xFFFFFFFFLL ? 0xFFFFFFFFu : (quint32)us);
+}
+
+// 功能：逐个读出计数（各自原子，整体不是同一时刻的，统计用途足够）。
+LaneMetrics::Snapshot LaneMetrics::snapshot() const
+{
+    Snapshot s;
+    s.uptimeMs = clock.elapsed();
+    for(int i = 0; i < CounterCount; i++)
+        s.counters[i] = (quint32)const_cast<QAtomicInt &>(counters[i]).fetchAndAddRelaxed(0);
+    for(int slot = 0; slot < CommandSlots; slot++)
+    {
+        Snapshot::Command c;
+        c.code = (quint8)(FirstCommand + slot);
+        bool used = false;
+        for(int i = 0; i < CommandCounterCount; i++)
+        {
+            c.counts[i] = (quint32)const_cast<QAtomicInt &>(commandCounters[slot][i]).fetchAndAddRelaxed(0);
+            used = used || c.counts[i];
+        }
+        if(!used)
+            continue;
+        const LatencyHistogram &h = latency[slot];
+        for(int i = 0; i < LatencyHistogram::BucketCount; i++)
+            c.latency.counts[i] = h.count(i);
+        c.latency.maxUs = h.maxUs();
+        s.commands.append(c);
+    }
+    return s;
+}
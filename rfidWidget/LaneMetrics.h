@@ -0,0 +1,132 @@
+#ifndef LANEMETRICS_H
+#define LANEMETRICS_H
+
+#include <QAtomicInt>
+#include <QElapsedTimer>
+#include <QList>
+#include <QString>
+#include <QVector>
+
+// 往返时间直方图（微秒），对数-线性分桶：0~7 每个值一桶，之后每个2的幂区间再等分8桶，
+// 相对误差不超过 12.5%，覆盖到 2^32 微秒。计数用 QAtomicInt，记录时不加锁、不分配内存，
+// 会话线程记录的同时别的线程可以随时取快照。
+class LatencyHistogram
+{
+public:
+    enum {
+        SubBits = 3,
+        SubBuckets = 1 << SubBits,
+        BucketCount = SubBuckets * 30
+    };
+
+    LatencyHistogram() {}
+
+    void record(quint32 us);
+    quint32 count(int bucket) const {
+        return (quint32)const_cast<QAtomicInt &>(counts[bucket]).fetchAndAddRelaxed(0);
+    }
+    quint32 maxUs() const {
+        return (quint32)const_cast<QAtomicInt &>(_maxUs).fetchAndAddRelaxed(0);
+    }
+
+    static int bucketOf(quint32 us);
+    static quint32 bucketLow(int bucket);
+    static quint32 bucketHigh(int bucket);//含
+
+private:
+    Q_DISABLE_COPY(LatencyHistogram)
+
+    QAtomicInt counts[BucketCount];
+    QAtomicInt _maxUs;
+};
+
+// 一条通道的通讯计数和各命令的回包耗时分布。
+// 命令调度器和会话在自己的线程里累加；界面、无界面程序在任意线程取 snapshot()，
+// 快照是普通数据，可以合并多条通道、序列化成文本。
+class LaneMetrics
+{
+public:
+    enum Counter {
+        Dispatched = 0,         // 发出的命令（不含重发）
+        Retried,                // 重发
+        ReplyTimeouts,          // 等待回包超时（含随后重发的）
+        Failed,                 // 重试用尽或发不出去
+        TxRejected,             // 发送队列满，命令没能交给收发线程
+        DuplicatesDropped,      // 丢掉的重复回包
+        UnmatchedReplies,       // 没有等待的命令或命令码不符的回包
+        SpuriousRetries,        // 原命令的回包晚到，重发其实多余
+        AuthFailures,           // 认证回包状态非0
+        ReadFailures,           // 读块回包状态非0
+        WriteFailures,          // 写块回包状态非0
+        CardsDetected,          // 识别到新放上的卡
+        CardsLost,              // 卡被拿走
+        CounterCount
+    };
+
+    enum CommandCounter {
+        CommandSent = 0,
+        CommandReplied,
+        CommandRetried,
+        CommandFailed,
+        CommandCounterCount
+    };
+
+    // 协议命令 0x46~0x4C 各一组
+    enum { CommandSlots = 7, FirstCommand = 0x46 };
+
+    struct Histogram
+    {
+        QVector<quint32> counts;    // LatencyHistogram::BucketCount 个
+        quint32 maxUs;
+
+        Histogram() : counts(LatencyHistogram::BucketCount, 0), maxUs(0) {}
+        quint64 total() const;
+        quint32 percentileUs(double q) const;//所在桶的上界，不超过最大值
+        double meanUs() const;//按桶中点估计
+        void merge(const Histogram &other);
+    };
+
+    struct Snapshot
+    {
+        struct Command
+        {
+            quint8 code;
+            quint32 counts[CommandCounterCount];
+            Histogram latency;      // 首次发出 -> 匹配的回包（含重发等待）
+        };
+
+        qint64 uptimeMs;            // 计数开始至今
+        quint32 counters[CounterCount];
+        QList<Command> commands;    // 只含发过的命令，按命令码排序
+
+        Snapshot();
+        void merge(const Snapshot &other);
+        // 每行 “名称 键=值 ...”，便于按行解析
+        QString toText() const;
+        static const char *counterName(int counter);
+    };
+
+    LaneMetrics();
+
+    void add(Counter c) {
+        counters[c].fetchAndAddRelaxed(1);
+    }
+    void addCommand(quint8 command, CommandCounter c) {
+        int slot = command - FirstCommand;
+        if(slot >= 0 && slot < CommandSlots)
+            commandCounters[slot][c].fetchAndAddRelaxed(1);
+    }
+    void recordLatency(quint8 command, qint64 us);
+
+    Snapshot snapshot() const;
+
+private:
+    Q_DISABLE_COPY(LaneMetrics)
+
+    QElapsedTimer clock;        // 计数开始时刻（单调时钟）
+    QAtomicInt counters[CounterCount];
+    QAtomicInt commandCounters[CommandSlots][CommandCounterCount];
+    LatencyHistogram latency[CommandSlots];
+};
+
+#endif // LANEMETRICS_H
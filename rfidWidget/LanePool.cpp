@@ -0,0 +1,148 @@
+#include "LanePool.h"
+#include "ReaderSession.h"
+#include <QThread>
+#include <QMetaObject>
+#include <QDebug>
+#include <stdlib.h>
+
+LanePool::LanePool(QObject *parent) :
+    QObject(parent)
+{
+}
+
+LanePool::~LanePool()
+{
+    stop();
+}
+
+// 功能：读取通道串口列表。
+QStringList LanePool::configuredPorts(const QStringList &args)
+{
+    //1.命令行参数：不以'-'开头的都当作串口
+    QStringList ports;
+    for(int i = 0; i < args.size(); i++)
+    {
+        if(!args.at(i).startsWith(QChar('-')))
+            ports.append(args.at(i));
+    }
+    //2.环境变量
+    if(ports.isEmpty())
+    {
+        const char *env = ::getenv("RFID_PORTS");
+        if(env)
+            ports = QString(env).split(',', QString::SkipEmptyParts);
+    }
+    //3.默认单通道
+    if(ports.isEmpty())
+        ports.append("/dev/ttyS0");
+    return ports;
+}
+
+// 功能：线程数随CPU核数增长，但不超过通道数。
+int LanePool::threadCountFor(int lanes)
+{
+    int cores = QThread::idealThreadCount();
+    if(cores < 1)
+        cores = 1;
+    return qBound(1, cores, qMax(1, lanes));
+}
+
+int LanePool::addLane(const QString &port)
+{
+    Lane lane;
+    lane.port = port;
+    lane.session = new ReaderSession;
+    lane.session->trace().setLane(lanes.size());
+    lanes.append(lane);
+    return lanes.size() - 1;
+}
+
+void LanePool::bindToLane(int lane, QObject *obj)
+{
+    if(lane < 0 || lane >= lanes.size() || !obj)
+        return;
+    lanes[lane].bound.append(obj);
+}
+
+ReaderSession *LanePool::session(int lane) const
+{
+    if(lane < 0 || lane >= lanes.size())
+        return NULL;
+    return lanes.at(lane).session;
+}
+
+QString LanePool::port(int lane) const
+{
+    if(lane < 0 || lane >= lanes.size())
+        return QString();
+    return lanes.at(lane).port;
+}
+
+// 功能：建线程池，把通道轮转分到各线程，在所属线程里打开串口。
+int LanePool::start()
+{
+    if(!threads.isEmpty() || lanes.isEmpty())
+        return 0;
+    //1.建线程池
+    int n = threadCountFor(lanes.size());
+    for(int i = 0; i < n; i++)
+    {
+        QThread *t = new QThread(this);
+        threads.append(t);
+        t->start();
+    }
+    //2.会话和绑定对象移到所属线程，之后它们的槽、定时器都在该线程执行
+    for(int i = 0; i < lanes.size(); i++)
+    {
+        QThread *t = threads.at(i % n);
+        lanes[i].session->moveToThread(t);
+        for(int k = 0; k < lanes.at(i).bound.size(); k++)
+            lanes.at(i).bound.at(k)->moveToThread(t);
+    }
+    //3.打开串口：在会话所属线程里执行，收发线程的通知也就投递到该线程
+    int opened = 0;
+    for(int i = 0; i < lanes.size(); i++)
+    {
+        bool ok = false;
+        QMetaObject::invokeMethod(lanes.at(i).session, "open", Qt::BlockingQueuedConnection,
+                                  Q_RETURN_ARG(bool, ok), Q_ARG(QString, lanes.at(i).port));
+        if(!ok)
+        {
+            qWarning() << "LanePool: lane" << i << "failed to open" << lanes.at(i).port;
+            continue;
+        }
+        QMetaObject::invokeMethod(lanes.at(i).session, "startAutoSearch", Qt::QueuedConnection);
+        opened++;
+    }
+    return opened;
+}
+
+// 功能：在所属线程里关闭串口，再结束线程池。
+void LanePool::halt()
+{
+    if(threads.isEmpty())
+        return;
+    //1.关串口要在会话所属线程里做（定时器、收发线程都属于那个线程）
+    for(int i = 0; i < lanes.size(); i++)
+        QMetaObject::invokeMethod(lanes.at(i).session, "close", Qt::BlockingQueuedConnection);
+    //2.结束线程池；wait() 返回后会话不再有事件处理，本线程可以直接读写、释放
+    for(int i = 0; i < threads.size(); i++)
+    {
+        threads.at(i)->quit();
+        threads.at(i)->wait();
+    }
+    qDeleteAll(threads);
+    threads.clear();
+}
+
+// 功能：停下通道，释放会话和绑定的对象。
+void LanePool::stop()
+{
+    halt();
+    for(int i = 0; i < lanes.size(); i++)
+    {
+        qDeleteAll(lanes.at(i).bound);
+        delete lanes.at(i).session;
+    }
+    lanes.clear();
+}
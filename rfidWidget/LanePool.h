@@ -0,0 +1,63 @@
+#ifndef LANEPOOL_H
+#define LANEPOOL_H
+
+#include <QObject>
+#include <QList>
+#include <QStringList>
+
+class QThread;
+class ReaderSession;
+
+// 多通道：一个进程驱动多个读卡器。
+// 每个串口一个 ReaderSession，各自独立的卡状态和命令队列；
+// 会话按轮转分到一个小线程池里，线程数 = min(CPU核数, 通道数)，
+// 通道数增加时只增加线程池里每个线程的负担，不再一个通道一个进程。
+// 每个通道的字节收发和拆帧仍在各自的 ReaderIoThread 里，那里大部分时间阻塞在 poll 上。
+//
+//    LanePool pool;
+//    int lane = pool.addLane("/dev/ttyS1");
+//    pool.bindToLane(lane, new GateLogic(pool.session(lane)));//无父对象，随会话进同一线程
+//    pool.start();
+class LanePool : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit LanePool(QObject *parent = 0);
+    ~LanePool();
+
+    // 命令行参数中的串口；没有则取环境变量 RFID_PORTS（逗号分隔）；都没有用 /dev/ttyS0
+    static QStringList configuredPorts(const QStringList &args);
+    static int threadCountFor(int lanes);
+
+    // start() 之前调用
+    int addLane(const QString &port);
+    void bindToLane(int lane, QObject *obj);//obj 必须没有父对象，start() 时移到通道所在线程
+
+    int start();//打开全部通道并开始自动寻卡，返回打开成功的通道数
+    void halt();//关闭全部通道，结束线程池；会话保留，之后可以在本线程读它们的统计
+    void stop();//halt()，再释放会话和绑定的对象
+
+    int laneCount() const {
+        return lanes.size();
+    }
+    int threadCount() const {
+        return threads.size();
+    }
+    ReaderSession *session(int lane) const;
+    QString port(int lane) const;
+
+private:
+    struct Lane
+    {
+        QString port;
+        ReaderSession *session;
+        QList<QObject *> bound;
+        Lane() : session(0) {}
+    };
+
+    QList<Lane> lanes;
+    QList<QThread *> threads;
+};
+
+#endif // LANEPOOL_H
@@ -0,0 +1,112 @@
+#include "NotificationBar.h"
+#include "ioportManager.h"
+#include <QApplication>
+#include <QTimer>
+#include <QTime>
+
+//各级别默认显示时长
+static const int kInfoMs = 2500;
+static const int kWarningMs = 4000;
+//积压时每条最多显示的时长
+static const int kBacklogMs = 800;
+//队列和历史上限，超出丢弃最早的
+static const int kMaxQueued = 16;
+static const int kMaxHistory = 50;
+
+NotificationBar::NotificationBar(QWidget *parent) :
+    QLabel(parent),
+    timer(NULL),
+    cueEnabled(false),
+    cueLedBit(-1),
+    ledOn(false)
+{
+    setWordWrap(true);
+    setAlignment(Qt::AlignCenter);
+    timer = new QTimer(this);
+    timer->setSingleShot(true);
+    connect(timer, SIGNAL(timeout()), this, SLOT(showNext()));
+    hide();
+}
+
+// 功能：提交一条提示，立即返回。
+void NotificationBar::post(Level level, const QString &title, const QString &text, int durationMs)
+{
+    //1.记录历史
+    recent.append(QString("%1 %2: %3").arg(QTime::currentTime().toString("hh:mm:ss")).arg(title).arg(text));
+    while(recent.size() > kMaxHistory)
+        recent.removeFirst();
+    emit posted(level, title, text);
+
+    //2.入队，空闲时立即显示
+    Notice n;
+    n.level = level;
+    n.title = title;
+    n.text = text;
+    n.durationMs = durationMs > 0 ? durationMs : (level >= Warning ? kWarningMs : kInfoMs);
+    queue.enqueue(n);
+    while(queue.size() > kMaxQueued)
+        queue.dequeue();
+    if(!timer->isActive())
+        showNext();
+    else if(queue.size() > 1 && timer->interval() > kBacklogMs)
+        timer->start(kBacklogMs);//有积压：当前这条提前结束
+}
+
+void NotificationBar::clear()
+{
+    queue.clear();
+    timer->stop();
+    setLed(false);
+    hide();
+}
+
+void NotificationBar::setCueEnabled(bool on)
+{
+    cueEnabled = on;
+}
+
+void NotificationBar::setCueLed(int bit)
+{
+    setLed(false);
+    cueLedBit = bit;
+}
+
+// 功能：显示队首提示；队列空时隐藏。
+void NotificationBar::showNext()
+{
+    if(queue.isEmpty())
+    {
+        setLed(false);
+        hide();
+        return;
+    }
+    display(queue.dequeue());
+}
+
+void NotificationBar::display(const Notice &n)
+{
+    static const char *const styles[] = {
+        "background-color: #d9edf7; color: #31708f; padding: 4px;",
+        "background-color: #dff0d8; color: #3c763d; padding: 4px;",
+        "background-color: #fcf8e3; color: #8a6d3b; padding: 4px;",
+        "background-color: #f2dede; color: #a94442; padding: 4px;"
+    };
+    setStyleSheet(styles[n.level]);
+    setText(QString("%1：%2").arg(n.title).arg(n.text));
+    show();
+
+    bool alert = (n.level >= Warning);
+    setLed(alert);
+    if(alert && cueEnabled)
+        QApplication::beep();
+
+    timer->start(queue.isEmpty() ? n.durationMs : qMin(n.durationMs, kBacklogMs));
+}
+
+void NotificationBar::setLed(bool on)
+{
+    if(cueLedBit < 0 || ledOn == on)
+        return;
+    ledOn = on;
+    IOPortManager::setLEDDat(cueLedBit, on ? 1 : 0);
+}
@@ -0,0 +1,68 @@
+#ifndef NOTIFICATIONBAR_H
+#define NOTIFICATIONBAR_H
+
+#include <QLabel>
+#include <QQueue>
+#include <QStringList>
+
+class QTimer;
+
+// 非模态提示条：代替卡片流程中的 QMessageBox。
+// 提示进入队列，逐条显示一段时间后自动消失，不开嵌套事件循环，
+// 读卡流程（回包、超时重发、自动寻卡）在提示显示期间照常进行。
+// 积压多条时每条只显示较短时间，保证最新状态尽快出现。
+// 可选提示音和LED：警告/错误时蜂鸣，显示期间点亮指定LED（经 IOPortManager）。
+class NotificationBar : public QLabel
+{
+    Q_OBJECT
+
+public:
+    enum Level
+    {
+        Info = 0,
+        Success,
+        Warning,
+        Error
+    };
+
+    explicit NotificationBar(QWidget *parent = 0);
+
+    void post(Level level, const QString &title, const QString &text, int durationMs = 0);
+    void clear();//清空队列并隐藏
+
+    void setCueEnabled(bool on);//警告/错误时蜂鸣
+    void setCueLed(int bit);//显示警告/错误时点亮的LED位，-1不用LED
+    QStringList history() const {//最近的提示，最新的在最后
+        return recent;
+    }
+    int pendingCount() const {
+        return queue.size();
+    }
+
+signals:
+    void posted(int level, const QString &title, const QString &text);
+
+private slots:
+    void showNext();
+
+private:
+    struct Notice
+    {
+        Level level;
+        QString title;
+        QString text;
+        int durationMs;
+    };
+
+    void display(const Notice &n);
+    void setLed(bool on);
+
+    QQueue<Notice> queue;
+    QTimer *timer;
+    QStringList recent;
+    bool cueEnabled;
+    int cueLedBit;
+    bool ledOn;
+};
+
+#endif // NOTIFICATIONBAR_H
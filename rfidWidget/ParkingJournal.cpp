@@ -0,0 +1,396 @@
+#include "ParkingJournal.h"
+#include <QFile>
+#include <QMutexLocker>
+#include <QDebug>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+
+static const char kJournalMagic[4] = { 'P', 'K', 'J', '1' };
+//记录头：u16 长度 + u32 校验
+static const int kRecordHeaderSize = 6;
+//记录体最长：类型+时间+余额+有效 共14字节，另有三个 u8+内容
+static const int kMaxRecordBodySize = 1 + 8 + 1 + 255 + 4 + 1 + 1 + 255 + 1 + 255;
+//事件缓冲区的初始大小，之后按需翻倍
+static const int kInitialBufferSize = 4096;
+//写盘失败后的重试间隔
+static const unsigned long kRetryIntervalMs = 1000;
+
+// 功能：记录体校验（FNV-1a 32位）。
+static quint32 checksum(const uchar *p, int len)
+{
+    quint32 h = 2166136261U;
+    for(int i = 0; i < len; i++)
+        h = (h ^ p[i]) * 16777619U;
+    return h;
+}
+
+static inline void putU16(uchar *p, quint16 v)
+{
+    p[0] = (uchar)v;
+    p[1] = (uchar)(v >> 8);
+}
+
+static inline void putU32(uchar *p, quint32 v)
+{
+    for(int i = 0; i < 4; i++)
+        p[i] = (uchar)(v >> (8 * i));
+}
+
+static inline void putI64(uchar *p, qint64 v)
+{
+    quint64 u = (quint64)v;
+    for(int i = 0; i < 8; i++)
+        p[i] = (uchar)(u >> (8 * i));
+}
+
+static inline quint16 getU16(const uchar *p)
+{
+    return (quint16)(p[0] | (p[1] << 8));
+}
+
+static inline quint32 getU32(const uchar *p)
+{
+    return (quint32)p[0] | ((quint32)p[1] << 8) | ((quint32)p[2] << 16) | ((quint32)p[3] << 24);
+}
+
+static inline qint64 getI64(const uchar *p)
+{
+    quint64 u = 0;
+    for(int i = 7; i >= 0; i--)
+        u = (u << 8) | p[i];
+    return (qint64)u;
+}
+
+// 功能：写入 u8 长度 + Latin-1 内容，超过255字节截断。
+static inline uchar *putString(uchar *p, const QByteArray &s)
+{
+    int n = qMin(s.size(), 255);
+    *p++ = (uchar)n;
+    memcpy(p, s.constData(), n);
+    return p + n;
+}
+
+ParkingJournal::ParkingJournal(QObject *parent) :
+    QThread(parent),
+    fd(-1),
+    goodOffset(0),
+    dirtyTail(false),
+    pendingSize(0),
+    writingSize(0),
+    pendingEvents(0),
+    appendedSeq(0),
+    durableSeq(0),
+    writeFailed(false),
+    stopRequested(false)
+{
+}
+
+ParkingJournal::~ParkingJournal()
+{
+    close();
+}
+
+QString ParkingJournal::configuredPath()
+{
+    QByteArray env = qgetenv("RFID_JOURNAL");
+    if(!env.isEmpty())
+        return QString::fromLocal8Bit(env.constData());
+    return "parking.journal";
+}
+
+
+// === 重放 ===
+// 功能：顺序解析日志文件，逐条回调；遇到不完整或校验不对的记录停止。
+qint64 ParkingJournal::replay(const QString &path, Visitor *visitor, qint64 *validBytes)
+{
+    if(validBytes)
+        *validBytes = 0;
+    QFile file(path);
+    if(!file.exists())
+        return 0;
+    if(!file.open(QIODevice::ReadOnly))
+        return -1;
+    qint64 size = file.size();
+    if(size == 0)
+        return 0;
+    //1.整个文件映射进来顺序解析，映射失败再整体读入
+    QByteArray copy;
+    const uchar *base = file.map(0, size);
+    if(!base)
+    {
+        copy = file.readAll();
+        base = reinterpret_cast<const uchar *>(copy.constData());
+        size = copy.size();
+    }
+    //2.检查文件头
+    if(size < (qint64)sizeof(kJournalMagic) || memcmp(base, kJournalMagic, sizeof(kJournalMagic)) != 0)
+    {
+        qWarning() << "ParkingJournal: bad header in" << path;
+        return -1;
+    }
+    //3.逐条解析
+    qint64 pos = sizeof(kJournalMagic);
+    qint64 events = 0;
+    Event ev;
+    while(pos + kRecordHeaderSize <= size)
+    {
+        const uchar *rec = base + pos;
+        int len = getU16(rec);
+        if(len < 1 + 8 + 1 + 4 + 1 + 1 + 1 || pos + kRecordHeaderSize + len > size)
+            break;
+        const uchar *p = rec + kRecordHeaderSize;
+        const uchar *end = p + len;
+        if(checksum(p, len) != getU32(rec + 2))
+            break;
+        //3.1定长部分
+        ev.type = (EventType)p[0];
+        ev.timeMs = getI64(p + 1);
+        p += 9;
+        int idLen = *p++;
+        if(p + idLen + 4 + 1 + 1 > end)
+            break;
+        ev.cardId = QString::fromLatin1(reinterpret_cast<const char *>(p), idLen);
+        p += idLen;
+        ev.info.balance = (int)getU32(p);
+        p += 4;
+        ev.info.valid = (*p++ != 0);
+        //3.2车型、车主
+        int vLen = *p++;
+        if(p + vLen + 1 > end)
+            break;
+        ev.info.vehicleType = QString::fromLatin1(reinterpret_cast<const char *>(p), vLen);
+        p += vLen;
+        int oLen = *p++;
+        if(p + oLen > end)
+            break;
+        ev.info.owner = QString::fromLatin1(reinterpret_cast<const char *>(p), oLen);
+
+        visitor->journalEvent(ev);
+        events++;
+        pos += kRecordHeaderSize + len;
+    }
+    if(pos < size)
+        qWarning() << "ParkingJournal: ignoring" << (size - pos) << "trailing bytes in" << path;
+    if(validBytes)
+        *validBytes = pos;
+    return events;
+}
+
+
+// === 追加与写盘线程 ===
+// 功能：打开日志文件并启动写盘线程。
+bool ParkingJournal::open(const QString &path, qint64 validBytes)
+{
+    if(fd >= 0)
+        return false;
+    QByteArray name = QFile::encodeName(path);
+    int f = ::open(name.constData(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if(f < 0)
+    {
+        qWarning("ParkingJournal: cannot open %s, errno %d", name.constData(), errno);
+        return false;
+    }
+    //1.截掉最后一条写了一半的记录
+    if(validBytes >= 0 && ::ftruncate(f, validBytes) != 0)
+        qWarning("ParkingJournal: ftruncate failed, errno %d", errno);
+    //2.新文件写文件头
+    if(::lseek(f, 0, SEEK_END) == 0)
+    {
+        if(::write(f, kJournalMagic, sizeof(kJournalMagic)) != (ssize_t)sizeof(kJournalMagic) || ::fdatasync(f) != 0)
+        {
+            qWarning("ParkingJournal: cannot write header, errno %d", errno);
+            ::close(f);
+            return false;
+        }
+    }
+    goodOffset = ::lseek(f, 0, SEEK_END);
+    dirtyTail = false;
+    writeFailed = false;
+    fd = f;
+    stopRequested = false;
+    start();
+    return true;
+}
+
+// 功能：写完全部已追加的事件，停止写盘线程并关闭文件。
+void ParkingJournal::close()
+{
+    if(fd < 0)
+        return;
+    {
+        QMutexLocker locker(&mutex);
+        stopRequested = true;
+        pendingCond.wakeOne();
+    }
+    wait();
+    ::close(fd);
+    fd = -1;
+}
+
+// 功能：编码一条事件追加到内存缓冲区，由写盘线程成批落盘。
+void ParkingJournal::append(EventType type, const QDateTime &time, const QString &cardId, const TagInfo &info)
+{
+    //1.锁外编码
+    uchar rec[kRecordHeaderSize + kMaxRecordBodySize];
+    uchar *body = rec + kRecordHeaderSize;
+    uchar *p = body;
+    *p++ = (uchar)type;
+    putI64(p, time.isValid() ? time.toMSecsSinceEpoch() : -1);
+    p += 8;
+    p = putString(p, cardId.toLatin1());
+    putU32(p, (quint32)info.balance);
+    p += 4;
+    *p++ = info.valid ? 1 : 0;
+    p = putString(p, info.vehicleType.toLatin1());
+    p = putString(p, info.owner.toLatin1());
+    int len = p - body;
+    putU16(rec, (quint16)len);
+    putU32(rec + 2, checksum(body, len));
+
+    //2.锁内只拷贝字节并唤醒写盘线程
+    QMutexLocker locker(&mutex);
+    if(fd < 0)
+        return;
+    int n = kRecordHeaderSize + len;
+    if(pendingSize + n > pending.size())
+        pending.resize(qMax(pending.size() * 2, qMax(pendingSize + n, kInitialBufferSize)));
+    memcpy(pending.data() + pendingSize, rec, n);
+    pendingSize += n;
+    pendingEvents++;
+    appendedSeq++;
+    _stats.appended++;
+    pendingCond.wakeOne();
+}
+
+// 功能：等待已追加的事件全部落盘（退出前、或需要确认持久化时调用）。
+//       等待期间有一次写盘失败就返回 false，不替调用者等重试。
+bool ParkingJournal::flush()
+{
+    QMutexLocker locker(&mutex);
+    quint64 target = appendedSeq;
+    quint32 failures = _stats.failures;
+    while(durableSeq < target && _stats.failures == failures && fd >= 0 && isRunning())
+        durableCond.wait(&mutex);
+    return durableSeq >= target;
+}
+
+ParkingJournal::Stats ParkingJournal::stats() const
+{
+    QMutexLocker locker(&mutex);
+    return _stats;
+}
+
+// 功能：把 writing 中的一批写入并同步，返回0或 errno。
+//       失败时文件尾可能留下半条记录：截回上一批结尾（截断失败就留到下次写之前再截），
+//       否则重放停在半条记录处，之后追加的事件重启后全部丢失。
+int ParkingJournal::writeBatch()
+{
+    if(dirtyTail)
+    {
+        if(::ftruncate(fd, goodOffset) != 0)
+            return errno;
+        dirtyTail = false;
+    }
+    const char *p = writing.constData();
+    int left = writingSize;
+    int err = 0;
+    while(left > 0)
+    {
+        ssize_t n = ::write(fd, p, left);
+        if(n < 0 && errno == EINTR)
+            continue;
+        if(n <= 0)
+        {
+            err = n < 0 ? errno : ENOSPC;
+            break;
+        }
+        p += n;
+        left -= n;
+    }
+    if(err == 0 && ::fdatasync(fd) != 0)
+        err = errno;
+    if(err != 0)
+    {
+        qWarning("ParkingJournal: write failed, errno %d, %d bytes will be retried", err, writingSize);
+        dirtyTail = true;
+        if(::ftruncate(fd, goodOffset) == 0)
+            dirtyTail = false;
+        return err;
+    }
+    goodOffset += writingSize;
+    return 0;
+}
+
+// 功能：写盘线程：取走整批事件，一次写入、一次同步；失败的一批留着重试。
+void ParkingJournal::run()
+{
+    QMutexLocker locker(&mutex);
+    quint32 batch = 0;
+    quint64 seq = 0;
+    for(;;)
+    {
+        //1.等待事件；上一批失败时隔一段时间重试
+        while(pendingSize == 0 && writingSize == 0 && !stopRequested)
+            pendingCond.wait(&mutex);
+        if(writeFailed && !stopRequested)
+            pendingCond.wait(&mutex, kRetryIntervalMs);
+        if(pendingSize == 0 && writingSize == 0)
+            break;
+        //2.取走新事件：上一批已落盘就交换缓冲区；失败的一批还在 writing 里，新事件接在后面一起写
+        if(writingSize == 0)
+        {
+            qSwap(pending, writing);
+            writingSize = pendingSize;
+        }
+        else if(pendingSize > 0)
+        {
+            if(writingSize + pendingSize > writing.size())
+                writing.resize(qMax(writing.size() * 2, writingSize + pendingSize));
+            memcpy(writing.data() + writingSize, pending.constData(), pendingSize);
+            writingSize += pendingSize;
+        }
+        pendingSize = 0;
+        batch += pendingEvents;
+        pendingEvents = 0;
+        seq = appendedSeq;
+        bool stopping = stopRequested;
+        locker.unlock();
+
+        int err = writeBatch();
+
+        //3.记录进度，唤醒 flush()；失败不推进 durableSeq
+        locker.relock();
+        if(err == 0)
+        {
+            _stats.commits++;
+            _stats.bytes += writingSize;
+            if(batch > _stats.maxBatch)
+                _stats.maxBatch = batch;
+            writingSize = 0;
+            batch = 0;
+            durableSeq = seq;
+            writeFailed = false;
+        }
+        else
+        {
+            _stats.failures++;
+            _stats.lastError = err;
+            writeFailed = true;
+            //关闭时的最后一次尝试也失败：放弃剩下的事件
+            if(stopping)
+            {
+                _stats.dropped += batch + pendingEvents;
+                qWarning("ParkingJournal: closing with %u events not on disk", batch + pendingEvents);
+                writingSize = 0;
+                pendingSize = 0;
+                pendingEvents = 0;
+                durableCond.wakeAll();
+                break;
+            }
+        }
+        durableCond.wakeAll();
+    }
+    durableCond.wakeAll();
+}
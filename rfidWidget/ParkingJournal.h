@@ -0,0 +1,119 @@
+#ifndef PARKINGJOURNAL_H
+#define PARKINGJOURNAL_H
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QByteArray>
+#include <QString>
+#include <QDateTime>
+#include "TagInfo.h"
+
+// 停车记录预写日志：进场、出场、充值、注册等事件按发生顺序追加到二进制文件，
+// 程序重启（包括崩溃、断电）后重放日志重建在场车辆和进出场时间。
+//
+// append() 只把事件编码进内存缓冲区就返回，不碰磁盘，闸口判定不等待写盘；
+// 后台写盘线程取走整批事件，一次 write + 一次 fdatasync（组提交）：
+// 同步期间到达的事件自然攒成下一批，负载越高每批越大，不额外等待。
+//
+// 文件格式（小端）：
+//   文件头  "PKJ1"
+//   记录    u16 记录体长度 | u32 记录体校验(FNV-1a) | 记录体
+//   记录体  u8 类型 | i64 时间(ms since epoch) | u8+卡号 | i32 余额 | u8 有效 | u8+车型 | u8+车主
+//           （u8+x：1字节长度加 Latin-1 内容）
+// 断电时最后一条可能只写了一半：重放在第一条不完整或校验不对的记录处停止，
+// open() 从这个位置截断后继续追加。
+// 写盘失败（磁盘满、IO错误）时截回上一批的结尾，整批留着和新事件一起隔一段时间重试，
+// 失败的事件不算落盘：flush() 返回 false，stats() 记录失败次数。
+class ParkingJournal : public QThread
+{
+    Q_OBJECT
+
+public:
+    enum EventType
+    {
+        Entry = 1,          // 入场
+        Exit = 2,           // 出场
+        Update = 3,         // 在场车辆卡信息变化（出场扣费写卡等）
+        Recharge = 4,       // 充值
+        Register = 5,       // 注册
+        Forget = 6,         // 无效卡：清掉在场和历史入场记录
+        Clear = 7           // 清空全部记录
+    };
+
+    struct Event
+    {
+        EventType type;
+        qint64 timeMs;
+        QString cardId;
+        TagInfo info;
+    };
+
+    // 重放回调，按写入顺序逐条调用
+    class Visitor
+    {
+    public:
+        virtual ~Visitor() {}
+        virtual void journalEvent(const Event &event) = 0;
+    };
+
+    struct Stats
+    {
+        quint32 appended;       // 追加的事件数
+        quint32 commits;        // fdatasync 次数
+        quint32 maxBatch;       // 单次提交的最大事件数
+        qint64 bytes;           // 已写盘字节数
+        quint32 failures;       // 写盘或同步失败次数
+        int lastError;          // 最近一次失败的 errno，0 表示没有失败过
+        quint32 dropped;        // 关闭时仍写不进去而丢弃的事件数
+        Stats() : appended(0), commits(0), maxBatch(0), bytes(0), failures(0), lastError(0), dropped(0) {}
+    };
+
+    explicit ParkingJournal(QObject *parent = 0);
+    ~ParkingJournal();
+
+    // 重放日志，返回事件数，文件打不开返回-1；validBytes 返回完整记录的结尾位置
+    static qint64 replay(const QString &path, Visitor *visitor, qint64 *validBytes = 0);
+    // 日志路径：环境变量 RFID_JOURNAL，默认当前目录下 parking.journal
+    static QString configuredPath();
+
+    // 打开日志并启动写盘线程；validBytes >= 0 时先截断到该位置
+    bool open(const QString &path, qint64 validBytes = -1);
+    // 写完全部已追加的事件后关闭
+    void close();
+    bool isOpen() const {
+        return fd >= 0;
+    }
+
+    // 以下接口可以在任意线程调用
+    void append(EventType type, const QDateTime &time, const QString &cardId, const TagInfo &info = TagInfo());
+    bool flush();//等到已追加的事件全部落盘；等待期间写盘失败返回 false
+    Stats stats() const;
+
+protected:
+    void run();
+
+private:
+    int writeBatch();
+
+    int fd;
+    qint64 goodOffset;              // 最后一批成功落盘的记录结尾，只由写盘线程使用
+    bool dirtyTail;                 // 上次写盘失败，文件尾可能有半条记录，下次写之前先截回 goodOffset
+    mutable QMutex mutex;
+    QWaitCondition pendingCond;     // 有新事件或要求退出
+    QWaitCondition durableCond;     // 一批事件落盘
+    // 两块缓冲区交换复用，只增不减：有效长度另记，清空只把长度归零
+    // （QByteArray 的 clear()/resize(0) 会释放存储）
+    QByteArray pending;             // 等待写盘的事件（已编码）
+    QByteArray writing;             // 写盘线程正在写的一批
+    int pendingSize;
+    int writingSize;
+    quint32 pendingEvents;
+    quint64 appendedSeq;            // 已追加的事件序号
+    quint64 durableSeq;             // 已落盘的事件序号
+    bool writeFailed;               // 最近一批没写成功，等待重试
+    bool stopRequested;
+    Stats _stats;
+};
+
+#endif // PARKINGJOURNAL_H
@@ -0,0 +1,355 @@
+#include "ParkingStore.h"
+#include "ParkingJournal.h"
+#include <QMutexLocker>
+#include <QtAlgorithms>
+
+// === 状态变化 ===
+// 实时更新和日志重放共用，保证重放结果和实时状态一致
+static void applyEntry(CardTable::Record &r, qint64 ms, const TagInfo &info)
+{
+    r.entryMs = ms;
+    r.lastEntryMs = ms;
+    r.info = info;
+}
+
+// 功能：出场：入场时间转为历史入场时间。
+static void applyExit(CardTable::Record &r, qint64 ms)
+{
+    r.lastEntryMs = r.entryMs;
+    r.entryMs = -1;
+    r.info = TagInfo();
+    r.lastExitMs = ms;
+}
+
+// 功能：无效卡：清掉在场和历史入场，保留历史出场。
+static void applyForget(CardTable::Record &r)
+{
+    r.entryMs = -1;
+    r.lastEntryMs = -1;
+    r.info = TagInfo();
+}
+
+static QDateTime toDateTime(qint64 ms)
+{
+    return ms < 0 ? QDateTime() : QDateTime::fromMSecsSinceEpoch(ms);
+}
+
+// 重放直接写进一张新表，完成后整表换入
+class JournalReplay : public ParkingJournal::Visitor
+{
+public:
+    void journalEvent(const ParkingJournal::Event &e)
+    {
+        if(e.type == ParkingJournal::Clear)
+        {
+            cards.clear();
+            return;
+        }
+        CardUid uid = CardUid::fromHex(e.cardId);
+        if(uid.isNull())
+            return;
+        switch(e.type)
+        {
+        case ParkingJournal::Entry:
+            applyEntry(cards.insert(uid), e.timeMs, e.info);
+            break;
+        case ParkingJournal::Exit:
+        {
+            CardTable::Record *r = cards.find(uid);
+            if(r && r->isParked())
+                applyExit(*r, e.timeMs);
+            break;
+        }
+        case ParkingJournal::Update:
+        case ParkingJournal::Recharge:
+        {
+            CardTable::Record *r = cards.find(uid);
+            if(r && r->isParked())
+                r->info = e.info;
+            break;
+        }
+        case ParkingJournal::Forget:
+        {
+            CardTable::Record *r = cards.find(uid);
+            if(r)
+                applyForget(*r);
+            break;
+        }
+        default:
+            break;
+        }
+    }
+
+    CardTable cards;
+};
+
+// 功能：两份卡信息是否相同，相同时不重复写日志。
+static bool sameInfo(const TagInfo &a, const TagInfo &b)
+{
+    return a.balance == b.balance && a.valid == b.valid &&
+           a.owner == b.owner && a.vehicleType == b.vehicleType;
+}
+
+ParkingStore::ParkingStore(QObject *parent) :
+    QObject(parent),
+    _journal(NULL),
+    parked(0)
+{
+}
+
+ParkingStore::~ParkingStore()
+{
+    closeJournal();
+}
+
+
+// === 预写日志 ===
+// 功能：重放日志恢复停车记录，然后打开日志继续追加。
+qint64 ParkingStore::openJournal(const QString &path)
+{
+    closeJournal();
+    //1.重放
+    JournalReplay replay;
+    qint64 validBytes = 0;
+    qint64 events = ParkingJournal::replay(path, &replay, &validBytes);
+    if(events < 0)
+        return -1;
+    //2.换入重放得到的表
+    {
+        QMutexLocker locker(&mutex);
+        cards = replay.cards;
+        parked = 0;
+        for(int i = 0; i < cards.slotCount(); i++)
+        {
+            const CardTable::Record *r = cards.slotAt(i);
+            if(r && r->isParked())
+                parked++;
+        }
+    }
+    emit reloaded();
+    //3.截掉不完整的结尾，继续追加
+    ParkingJournal *j = new ParkingJournal(this);
+    if(!j->open(path, validBytes))
+    {
+        delete j;
+        return -1;
+    }
+    QMutexLocker locker(&mutex);
+    _journal = j;
+    return events;
+}
+
+// 功能：写完已追加的事件并关闭日志。
+void ParkingStore::closeJournal()
+{
+    ParkingJournal *j;
+    {
+        QMutexLocker locker(&mutex);
+        j = _journal;
+        _journal = NULL;
+    }
+    if(j)
+    {
+        j->close();
+        delete j;
+    }
+}
+
+// === 查询 ===
+bool ParkingStore::isParked(const QString &cardId) const
+{
+    QMutexLocker locker(&mutex);
+    const CardTable::Record *r = cards.find(CardUid::fromHex(cardId));
+    return r && r->isParked();
+}
+
+QDateTime ParkingStore::entryTime(const QString &cardId) const
+{
+    QMutexLocker locker(&mutex);
+    const CardTable::Record *r = cards.find(CardUid::fromHex(cardId));
+    return r ? toDateTime(r->entryMs) : QDateTime();
+}
+
+QDateTime ParkingStore::displayEntryTime(const QString &cardId) const
+{
+    QMutexLocker locker(&mutex);
+    const CardTable::Record *r = cards.find(CardUid::fromHex(cardId));
+    if(!r)
+        return QDateTime();
+    return toDateTime(r->isParked() ? r->entryMs : r->lastEntryMs);
+}
+
+QDateTime ParkingStore::lastExitTime(const QString &cardId) const
+{
+    QMutexLocker locker(&mutex);
+    const CardTable::Record *r = cards.find(CardUid::fromHex(cardId));
+    return r ? toDateTime(r->lastExitMs) : QDateTime();
+}
+
+static bool cardIdLessThan(const ParkingStore::ParkedVehicle &a, const ParkingStore::ParkedVehicle &b)
+{
+    return a.cardId < b.cardId;
+}
+
+// 功能：复制在场车辆列表，供表格刷新，不在锁内做界面操作。
+QList<ParkingStore::ParkedVehicle> ParkingStore::parkedVehicles() const
+{
+    QList<ParkedVehicle> list;
+    {
+        QMutexLocker locker(&mutex);
+        for(int i = 0; i < cards.slotCount(); i++)
+        {
+            const CardTable::Record *r = cards.slotAt(i);
+            if(!r || !r->isParked())
+                continue;
+            ParkedVehicle v;
+            v.cardId = r->uid.toHex();
+            v.entryTime = toDateTime(r->entryMs);
+            v.info = r->info;
+            list.append(v);
+        }
+    }
+    //表里是哈希顺序，按卡号排序后给界面
+    qSort(list.begin(), list.end(), cardIdLessThan);
+    return list;
+}
+
+// 功能：取一辆在场车辆，供表格按行更新。
+bool ParkingStore::parkedVehicle(const QString &cardId, ParkedVehicle *vehicle) const
+{
+    QMutexLocker locker(&mutex);
+    const CardTable::Record *r = cards.find(CardUid::fromHex(cardId));
+    if(!r || !r->isParked())
+        return false;
+    if(vehicle)
+    {
+        vehicle->cardId = r->uid.toHex();
+        vehicle->entryTime = toDateTime(r->entryMs);
+        vehicle->info = r->info;
+    }
+    return true;
+}
+
+int ParkingStore::parkedCount() const
+{
+    QMutexLocker locker(&mutex);
+    return parked;
+}
+
+// === 更新 ===
+// 功能：记录入场。卡号存不进表的卡不能放行：不在场就永远按入场处理，出场也不会扣费。
+bool ParkingStore::recordEntry(const QString &cardId, const QDateTime &time, const TagInfo &info)
+{
+    CardUid uid = CardUid::fromHex(cardId);
+    if(uid.isNull())
+    {
+        qWarning("ParkingStore: unsupported card id \"%s\", entry rejected", cardId.toLatin1().constData());
+        return false;
+    }
+    {
+        QMutexLocker locker(&mutex);
+        CardTable::Record &r = cards.insert(uid);
+        if(!r.isParked())
+            parked++;
+        applyEntry(r, time.toMSecsSinceEpoch(), info);
+        //锁内追加，日志顺序和内存中的更新顺序一致
+        if(_journal)
+            _journal->append(ParkingJournal::Entry, time, cardId, info);
+    }
+    emit vehicleChanged(cardId);
+    return true;
+}
+
+// 功能：记录出场，入场时间转为最近入场时间。
+bool ParkingStore::recordExit(const QString &cardId, const QDateTime &time)
+{
+    {
+        QMutexLocker locker(&mutex);
+        CardTable::Record *r = cards.find(CardUid::fromHex(cardId));
+        if(!r || !r->isParked())
+            return false;
+        applyExit(*r, time.toMSecsSinceEpoch());
+        parked--;
+        if(_journal)
+            _journal->append(ParkingJournal::Exit, time, cardId);
+    }
+    emit vehicleChanged(cardId);
+    return true;
+}
+
+// 功能：更新在场车辆的卡信息（余额变化后刷新表格）。
+bool ParkingStore::updateInfo(const QString &cardId, const TagInfo &info)
+{
+    {
+        QMutexLocker locker(&mutex);
+        CardTable::Record *r = cards.find(CardUid::fromHex(cardId));
+        if(!r || !r->isParked())
+            return false;
+        //信息没变（出入场后重复回写同一份）不记日志，也不刷新表格
+        if(sameInfo(r->info, info))
+            return true;
+        if(_journal)
+            _journal->append(ParkingJournal::Update, QDateTime::currentDateTime(), cardId, info);
+        r->info = info;
+    }
+    emit vehicleChanged(cardId);
+    return true;
+}
+
+// 功能：记录充值；在场车辆同步卡信息。
+void ParkingStore::recordRecharge(const QString &cardId, const QDateTime &time, const TagInfo &info)
+{
+    bool isIn;
+    {
+        QMutexLocker locker(&mutex);
+        CardTable::Record *r = cards.find(CardUid::fromHex(cardId));
+        isIn = r && r->isParked();
+        if(isIn)
+            r->info = info;
+        if(_journal)
+            _journal->append(ParkingJournal::Recharge, time, cardId, info);
+    }
+    if(isIn)
+        emit vehicleChanged(cardId);
+}
+
+// 功能：记录注册，停车表不变，只留日志。
+void ParkingStore::recordRegistration(const QString &cardId, const QDateTime &time, const TagInfo &info)
+{
+    QMutexLocker locker(&mutex);
+    if(_journal)
+        _journal->append(ParkingJournal::Register, time, cardId, info);
+}
+
+void ParkingStore::forget(const QString &cardId)
+{
+    bool wasIn = false;
+    {
+        QMutexLocker locker(&mutex);
+        CardTable::Record *r = cards.find(CardUid::fromHex(cardId));
+        if(r)
+        {
+            wasIn = r->isParked();
+            if(wasIn)
+                parked--;
+            applyForget(*r);
+            //没有记录的卡不写日志，重放时本来也没有可清的
+            if(_journal)
+                _journal->append(ParkingJournal::Forget, QDateTime::currentDateTime(), cardId);
+        }
+    }
+    if(wasIn)
+        emit vehicleChanged(cardId);
+}
+
+void ParkingStore::clear()
+{
+    {
+        QMutexLocker locker(&mutex);
+        cards.clear();
+        parked = 0;
+        if(_journal)
+            _journal->append(ParkingJournal::Clear, QDateTime::currentDateTime(), QString());
+    }
+    emit reloaded();
+}
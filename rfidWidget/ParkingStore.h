@@ -0,0 +1,70 @@
+#ifndef PARKINGSTORE_H
+#define PARKINGSTORE_H
+
+#include <QObject>
+#include <QList>
+#include <QDateTime>
+#include <QMutex>
+#include "TagInfo.h"
+#include "CardTable.h"
+
+class ParkingJournal;
+
+// 停车记录：所有通道共用一份，按卡号记录在场车辆和最近一次进出场时间。
+// 卡号在接口上仍是十六进制字符串，内部转成 CardUid，一张卡的全部字段放在 CardTable 的一条记录里。
+// 车从入口通道进、从出口通道出，所以记录不能挂在某个通道上。
+// 所有接口加锁，各通道可以在不同线程里调用；信号在锁外发出。
+// 信号只带卡号：界面收到后用 parkedVehicle() 取当前状态，跨线程排队送达时先后顺序不影响结果。
+// openJournal() 之后每次更新都在锁内追加到预写日志（ParkingJournal），重启时重放恢复。
+class ParkingStore : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct ParkedVehicle
+    {
+        QString cardId;
+        QDateTime entryTime;
+        TagInfo info;
+    };
+
+    explicit ParkingStore(QObject *parent = 0);
+    ~ParkingStore();
+
+    // === 预写日志 ===
+    qint64 openJournal(const QString &path);//重放已有日志后继续追加，返回重放的事件数，失败返回-1
+    void closeJournal();//写完并关闭日志
+    ParkingJournal *journal() const {
+        return _journal;
+    }
+
+    // === 查询 ===
+    bool isParked(const QString &cardId) const;
+    QDateTime entryTime(const QString &cardId) const;//当前入场时间，不在场为无效时间
+    QDateTime displayEntryTime(const QString &cardId) const;//在场取当前入场时间，否则取最近入场时间
+    QDateTime lastExitTime(const QString &cardId) const;
+    QList<ParkedVehicle> parkedVehicles() const;//按卡号排序
+    bool parkedVehicle(const QString &cardId, ParkedVehicle *vehicle) const;//单辆车，不在场返回false
+    int parkedCount() const;
+
+    // === 更新 ===
+    bool recordEntry(const QString &cardId, const QDateTime &time, const TagInfo &info);//卡号不能表示为 CardUid（超过7字节、非十六进制）时拒绝，返回false
+    bool recordExit(const QString &cardId, const QDateTime &time);//不在场返回false
+    bool updateInfo(const QString &cardId, const TagInfo &info);//只更新在场车辆
+    void recordRecharge(const QString &cardId, const QDateTime &time, const TagInfo &info);//充值后的卡信息，在场时同步
+    void recordRegistration(const QString &cardId, const QDateTime &time, const TagInfo &info);//只写日志
+    void forget(const QString &cardId);//无效卡：清掉在场和历史入场记录
+    void clear();
+
+signals:
+    void vehicleChanged(const QString &cardId);//一辆车入场、出场或在场信息变化
+    void reloaded();//整表替换（重放日志、清空）
+
+private:
+    mutable QMutex mutex;
+    ParkingJournal *_journal;
+    CardTable cards;//按卡号：入场、历史入场、历史出场时间和在场信息
+    int parked;//在场车辆数
+};
+
+#endif // PARKINGSTORE_H
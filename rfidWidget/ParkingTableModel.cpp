@@ -0,0 +1,132 @@
+#include "ParkingTableModel.h"
+#include "CardUid.h"
+
+ParkingTableModel::ParkingTableModel(ParkingStore *store, QObject *parent) :
+    QAbstractTableModel(parent),
+    store(store)
+{
+    connect(store, SIGNAL(vehicleChanged(QString)), this, SLOT(refreshVehicle(QString)));
+    connect(store, SIGNAL(reloaded()), this, SLOT(reload()));
+    rows = store->parkedVehicles();
+}
+
+int ParkingTableModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : rows.size();
+}
+
+int ParkingTableModel::columnCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : ColumnCount;
+}
+
+// 功能：单元格内容；未登记信息的车显示“--”，SortRole 返回原始值。
+QVariant ParkingTableModel::data(const QModelIndex &index, int role) const
+{
+    if(!index.isValid() || index.row() >= rows.size())
+        return QVariant();
+    if(role != Qt::DisplayRole && role != SortRole)
+        return QVariant();
+    const ParkingStore::ParkedVehicle &v = rows.at(index.row());
+    bool display = (role == Qt::DisplayRole);
+    switch(index.column())
+    {
+    case CardColumn:
+        return v.cardId;
+    case OwnerColumn:
+        if(!v.info.valid)
+            return display ? QVariant(tr("--")) : QVariant(QString());
+        return v.info.owner;
+    case VehicleColumn:
+        if(!v.info.valid)
+            return display ? QVariant(tr("--")) : QVariant(QString());
+        return v.info.vehicleType;
+    case EntryColumn:
+        if(!display)
+            return v.entryTime;
+        return v.entryTime.isValid() ? v.entryTime.toString("yyyy-MM-dd hh:mm:ss") : tr("--");
+    case BalanceColumn:
+        if(!display)
+            return v.info.valid ? v.info.balance : -1;
+        return v.info.valid ? QString::number(v.info.balance) : tr("--");
+    default:
+        return QVariant();
+    }
+}
+
+QVariant ParkingTableModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if(orientation != Qt::Horizontal || role != Qt::DisplayRole)
+        return QAbstractTableModel::headerData(section, orientation, role);
+    switch(section)
+    {
+    case CardColumn:
+        return tr("卡号");
+    case OwnerColumn:
+        return tr("车主姓名");
+    case VehicleColumn:
+        return tr("车型");
+    case EntryColumn:
+        return tr("入场时间");
+    case BalanceColumn:
+        return tr("余额");
+    default:
+        return QVariant();
+    }
+}
+
+int ParkingTableModel::lowerBound(const QString &cardId) const
+{
+    int lo = 0;
+    int hi = rows.size();
+    while(lo < hi)
+    {
+        int mid = (lo + hi) / 2;
+        if(rows.at(mid).cardId < cardId)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+// === 按行更新 ===
+// 功能：一辆车变化后只动对应的一行：新入场插入，出场删除，在场信息变化刷新。
+void ParkingTableModel::refreshVehicle(const QString &cardId)
+{
+    //1.卡号统一成表里的小写十六进制
+    QString key = CardUid::fromHex(cardId).toHex();
+    if(key.isEmpty())
+        return;
+    int row = lowerBound(key);
+    bool listed = row < rows.size() && rows.at(row).cardId == key;
+    //2.取当前状态（信号可能排队送达，以查询结果为准）
+    ParkingStore::ParkedVehicle v;
+    bool parked = store->parkedVehicle(key, &v);
+    //3.插入、删除或刷新
+    if(parked && !listed)
+    {
+        beginInsertRows(QModelIndex(), row, row);
+        rows.insert(row, v);
+        endInsertRows();
+    }
+    else if(!parked && listed)
+    {
+        beginRemoveRows(QModelIndex(), row, row);
+        rows.removeAt(row);
+        endRemoveRows();
+    }
+    else if(parked && listed)
+    {
+        rows[row] = v;
+        emit dataChanged(index(row, 0), index(row, ColumnCount - 1));
+    }
+}
+
+// 功能：整表替换（重放日志、清空）后重新取全表。
+void ParkingTableModel::reload()
+{
+    beginResetModel();
+    rows = store->parkedVehicles();
+    endResetModel();
+}
@@ -0,0 +1,49 @@
+#ifndef PARKINGTABLEMODEL_H
+#define PARKINGTABLEMODEL_H
+
+#include <QAbstractTableModel>
+#include <QList>
+#include "ParkingStore.h"
+
+// 在场车辆表格的数据模型：代替每次变化都整表重建的 QTableWidget。
+// 行按卡号排序存放，ParkingStore 每发出一次 vehicleChanged() 只插入、删除或刷新对应的一行
+// （二分查找定位），视图只重绘这一行；整表替换（重放、清空）时才重新取全表。
+// 排序、筛选交给外面的 QSortFilterProxyModel，SortRole 给出原始值（余额按数值、时间按时间比较）。
+class ParkingTableModel : public QAbstractTableModel
+{
+    Q_OBJECT
+
+public:
+    enum Column
+    {
+        CardColumn = 0,
+        OwnerColumn,
+        VehicleColumn,
+        EntryColumn,
+        BalanceColumn,
+        ColumnCount
+    };
+    enum
+    {
+        SortRole = Qt::UserRole + 1
+    };
+
+    explicit ParkingTableModel(ParkingStore *store, QObject *parent = 0);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const;
+
+public slots:
+    void refreshVehicle(const QString &cardId);//按当前状态插入、删除或刷新一行
+    void reload();//整表重取
+
+private:
+    int lowerBound(const QString &cardId) const;//第一个卡号不小于 cardId 的行
+
+    ParkingStore *store;
+    QList<ParkingStore::ParkedVehicle> rows;//按卡号排序
+};
+
+#endif // PARKINGTABLEMODEL_H
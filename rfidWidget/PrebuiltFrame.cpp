@@ -0,0 +1,36 @@
+#include "PrebuiltFrame.h"
+
+namespace PrebuiltFrame {
+
+template <class F>
+static const QByteArray &shared()
+{
+    static const QByteArray frame((const char *)FrameBytes<F>::raw, FrameBytes<F>::Size);
+    return frame;
+}
+
+const QByteArray &searchCard()
+{
+    return shared<SearchCardFrame>();
+}
+
+const QByteArray &antiColl()
+{
+    return shared<AntiCollFrame>();
+}
+
+const QByteArray &authDefaultKey(quint8 block)
+{
+    static const QByteArray none;
+    switch(block)
+    {
+    case 1:
+        return shared<AuthDefaultKeyFrame<1>::Type>();
+    case 2:
+        return shared<AuthDefaultKeyFrame<2>::Type>();
+    default:
+        return none;
+    }
+}
+
+}
@@ -0,0 +1,128 @@
+#ifndef PREBUILTFRAME_H
+#define PREBUILTFRAME_H
+#include <QByteArray>
+#include "IEEE1443Package.h"
+
+// 编译期生成的固定命令帧（地址0，发送方向）
+// 校验和、长度、转义全部由模板在编译期算出，线路帧以常量数组放在只读段，
+// 运行时只是取一个共享的 QByteArray，不做校验和循环、不转义、不分配内存。
+// 数据可变的命令（选卡UID、写块数据）仍走 IEEE1443Package::encodeRaw。
+//
+//    typedef ConstFrame<IEEE1443Package::SearchCard, 1, 0x52> SearchFrame;
+//    FrameBytes<SearchFrame>::raw / FrameBytes<SearchFrame>::Size
+namespace PrebuiltFrame {
+
+enum {
+    MaxData = 8,                                // 最多8字节常量数据（认证：模式+块号+6字节Key）
+    MaxRawSize = 1 + (2 + 1 + 1 + MaxData + 1) * 2 + 1
+};
+
+template <int C>
+struct IsSpecial {
+    enum { Value = (C == IEEE1443_START_CODE || C == IEEE1443_STOP_CODE || C == IEEE1443_ESCAPE_CHAR) };
+};
+
+// 帧内容描述：内容区 = 地址2 + 长度 + 命令 + 数据N + 校验和
+template <quint8 Cmd, int N,
+          quint8 D0 = 0, quint8 D1 = 0, quint8 D2 = 0, quint8 D3 = 0,
+          quint8 D4 = 0, quint8 D5 = 0, quint8 D6 = 0, quint8 D7 = 0>
+struct ConstFrame {
+    enum {
+        Command = Cmd,
+        // 发送给读卡器的长度包含同步尾
+        Len = N + 1 + 1 + 1,
+        // 未使用的数据参数必须保持默认值0，求和时不影响结果
+        CheckSum = (Len + Cmd + D0 + D1 + D2 + D3 + D4 + D5 + D6 + D7) & 0xFF,
+        ContentSize = 2 + 1 + 1 + N + 1
+    };
+
+    template <int i>
+    struct Content {
+        enum {
+            Value = i < 2 ? 0
+                  : i == 2 ? (int)Len
+                  : i == 3 ? (int)Cmd
+                  : i == ContentSize - 1 ? (int)CheckSum
+                  : i == 4 ? D0 : i == 5 ? D1 : i == 6 ? D2 : i == 7 ? D3
+                  : i == 8 ? D4 : i == 9 ? D5 : i == 10 ? D6 : D7
+        };
+    };
+};
+
+// 前 i 个内容字节转义后的长度
+template <class F, int i>
+struct EscapedLen {
+    enum {
+        Value = EscapedLen<F, i - 1>::Value + 1
+              + IsSpecial<F::template Content<i - 1>::Value>::Value
+    };
+};
+
+template <class F>
+struct EscapedLen<F, 0> {
+    enum { Value = 0 };
+};
+
+// 转义后内容区第 k 个字节：从第 i 个内容字节开始向后定位
+template <class F, int k, int i = 0, bool Here = (k < EscapedLen<F, i + 1>::Value)>
+struct EscapedAt {
+    enum { Value = EscapedAt<F, k, i + 1>::Value };
+};
+
+template <class F, int k, int i>
+struct EscapedAt<F, k, i, true> {
+    enum {
+        Value = (IsSpecial<F::template Content<i>::Value>::Value && k == EscapedLen<F, i>::Value)
+                ? IEEE1443_ESCAPE_CHAR : (int)F::template Content<i>::Value
+    };
+};
+
+// 线路帧第 k 个字节（同步头 + 转义内容 + 同步尾，其余补0）
+template <class F, int k>
+struct RawAt {
+    enum {
+        Escaped = EscapedLen<F, F::ContentSize>::Value,
+        // 越界的 k 钳到0再实例化，避免无穷递归
+        Inner = (k >= 1 && k <= Escaped) ? k - 1 : 0,
+        Value = k == 0 ? IEEE1443_START_CODE
+              : k <= Escaped ? (int)EscapedAt<F, Inner>::Value
+              : k == Escaped + 1 ? IEEE1443_STOP_CODE
+              : 0
+    };
+};
+
+template <class F>
+struct FrameBytes {
+    enum { Size = 1 + EscapedLen<F, F::ContentSize>::Value + 1 };
+    static const quint8 raw[MaxRawSize];
+};
+
+template <class F>
+const quint8 FrameBytes<F>::raw[MaxRawSize] = {
+    RawAt<F, 0>::Value,  RawAt<F, 1>::Value,  RawAt<F, 2>::Value,  RawAt<F, 3>::Value,
+    RawAt<F, 4>::Value,  RawAt<F, 5>::Value,  RawAt<F, 6>::Value,  RawAt<F, 7>::Value,
+    RawAt<F, 8>::Value,  RawAt<F, 9>::Value,  RawAt<F, 10>::Value, RawAt<F, 11>::Value,
+    RawAt<F, 12>::Value, RawAt<F, 13>::Value, RawAt<F, 14>::Value, RawAt<F, 15>::Value,
+    RawAt<F, 16>::Value, RawAt<F, 17>::Value, RawAt<F, 18>::Value, RawAt<F, 19>::Value,
+    RawAt<F, 20>::Value, RawAt<F, 21>::Value, RawAt<F, 22>::Value, RawAt<F, 23>::Value,
+    RawAt<F, 24>::Value, RawAt<F, 25>::Value, RawAt<F, 26>::Value, RawAt<F, 27>::Value
+};
+
+// 轮询用到的固定帧
+typedef ConstFrame<IEEE1443Package::SearchCard, 1, 0x52> SearchCardFrame;
+typedef ConstFrame<IEEE1443Package::AntiColl, 1, 0x04> AntiCollFrame;
+template <quint8 Block>
+struct AuthDefaultKeyFrame {
+    typedef ConstFrame<IEEE1443Package::Authentication, 8,
+                       0x60, Block, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF> Type;
+};
+
+// 共享的线路帧，首次调用时从常量数组构造一次，之后每次返回只增加引用计数
+const QByteArray &searchCard();
+const QByteArray &antiColl();
+// 默认Key（6字节0xFF）认证块1/块2，其它块返回空数组，调用者改走 encodeRaw
+const QByteArray &authDefaultKey(quint8 block);
+
+}
+
+#endif // PREBUILTFRAME_H
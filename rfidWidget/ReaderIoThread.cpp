@@ -0,0 +1,168 @@
+#include "ReaderIoThread.h"
+#include "posix_qextserialport.h"
+#include "FrameTrace.h"
+#include <QDebug>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+
+ReaderIoThread::ReaderIoThread(Posix_QextSerialPort *port, QObject *parent) :
+    QThread(parent),
+    commPort(port),
+    stopRequested(false),
+    notifyPending(0),
+    dropped(0),
+    trace(NULL)
+{
+    wakePipe[0] = wakePipe[1] = -1;
+    if(::pipe(wakePipe) == 0)
+    {
+        ::fcntl(wakePipe[0], F_SETFL, ::fcntl(wakePipe[0], F_GETFL) | O_NONBLOCK);
+        ::fcntl(wakePipe[1], F_SETFL, ::fcntl(wakePipe[1], F_GETFL) | O_NONBLOCK);
+    }
+    else
+        qWarning("ReaderIoThread: pipe() failed, errno %d", errno);
+}
+
+ReaderIoThread::~ReaderIoThread()
+{
+    stop();
+    if(wakePipe[0] >= 0)
+        ::close(wakePipe[0]);
+    if(wakePipe[1] >= 0)
+        ::close(wakePipe[1]);
+}
+
+// 功能：请求线程退出并等待结束，之后才能关闭串口。
+void ReaderIoThread::stop()
+{
+    if(!isRunning())
+        return;
+    stopRequested = true;
+    wake();
+    wait();
+}
+
+// 功能：把一帧已转义的发送包交给I/O线程写出。
+bool ReaderIoThread::send(const QByteArray &rawPackage)
+{
+    if(!txRing.push(rawPackage))
+        return false;
+    wake();
+    return true;
+}
+
+// 功能：重新允许framesAvailable通知，必须在取帧之前调用，避免漏通知。
+void ReaderIoThread::rearmNotify()
+{
+    notifyPending.fetchAndStoreOrdered(0);
+}
+
+// 功能：取出一帧已收到的包，无帧时返回false。
+bool ReaderIoThread::takeFrame(IEEE1443Package &pkg)
+{
+    return rxRing.pop(pkg);
+}
+
+// 功能：返回因UI线程来不及取而丢弃的帧数。
+int ReaderIoThread::droppedFrames() const
+{
+    return const_cast<QAtomicInt &>(dropped).fetchAndAddRelaxed(0);
+}
+
+void ReaderIoThread::setTrace(FrameTrace *t)
+{
+    trace = t;
+}
+
+void ReaderIoThread::wake()
+{
+    if(wakePipe[1] < 0)
+        return;
+    char c = 1;
+    // 管道已满说明线程已经被唤醒，忽略EAGAIN即可
+    if(::write(wakePipe[1], &c, 1) < 0 && errno != EAGAIN)
+        qWarning("ReaderIoThread: wake failed, errno %d", errno);
+}
+
+void ReaderIoThread::drainTx()
+{
+    QByteArray pkg;
+    while(txRing.pop(pkg))
+    {
+        commPort->write(pkg);
+        if(trace)
+            trace->record(FrameTrace::Tx, pkg.constData(), pkg.size());
+    }
+}
+
+// 功能：I/O线程主循环，等待串口可读或UI线程唤醒。
+void ReaderIoThread::run()
+{
+    char buf[256];
+    int fd = commPort->handle();
+    while(!stopRequested)
+    {
+        struct pollfd fds[2];
+        fds[0].fd = fd;
+        fds[0].events = POLLIN;
+        fds[0].revents = 0;
+        fds[1].fd = wakePipe[0];
+        fds[1].events = POLLIN;
+        fds[1].revents = 0;
+        int n = ::poll(fds, 2, -1);
+        if(n < 0)
+        {
+            if(errno == EINTR)
+                continue;
+            qWarning("ReaderIoThread: poll failed, errno %d", errno);
+            break;
+        }
+        if(fds[1].revents & POLLIN)
+        {
+            char sink[16];
+            while(::read(wakePipe[0], sink, sizeof(sink)) > 0)
+                ;
+            drainTx();
+        }
+        if(fds[0].revents & POLLIN)
+        {
+            //一次非阻塞read取走已到达的全部字节
+            qint64 len;
+            while((len = commPort->readAvailable(buf, sizeof(buf))) > 0)
+            {
+                if(trace)
+                    trace->record(FrameTrace::Rx, buf, (int)len);
+                decode(buf, (int)len);
+                if(len < (qint64)sizeof(buf))
+                    break;
+            }
+        }
+        else if(fds[0].revents & (POLLERR | POLLHUP | POLLNVAL))
+            msleep(10);//对端断开时避免空转
+    }
+}
+
+// 功能：拆帧，完整帧直接从拆帧器缓冲区解析后放入接收队列。
+void ReaderIoThread::decode(const char *p, int len)
+{
+    decoder.push(p, len);
+    FrameDecoder::Frame frame;
+    while(decoder.next(frame))
+        deliver(frame);
+}
+
+void ReaderIoThread::deliver(const FrameDecoder::Frame &frame)
+{
+    IEEE1443Package pkg(frame.data, frame.size);
+    if(!pkg.isValid())
+        return;
+    if(!rxRing.push(pkg))
+    {
+        dropped.fetchAndAddRelaxed(1);
+        return;
+    }
+    if(notifyPending.testAndSetOrdered(0, 1))
+        emit framesAvailable();
+}
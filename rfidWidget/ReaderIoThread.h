@@ -0,0 +1,59 @@
+#ifndef READERIOTHREAD_H
+#define READERIOTHREAD_H
+
+#include <QThread>
+#include <QByteArray>
+#include <QAtomicInt>
+#include "IEEE1443Package.h"
+#include "SpscRing.h"
+#include "FrameDecoder.h"
+
+class Posix_QextSerialPort;
+class FrameTrace;
+
+// 读卡器 I/O 线程：独占串口 fd，负责收发字节与拆帧。
+// 完整的 IEEE1443Package 通过无锁 SPSC 队列交给 UI 线程，
+// 发送包同样经 SPSC 队列交给本线程写出，UI 线程不再直接碰串口。
+// 设置了 FrameTrace 时，写出的每一帧和读到的每一段字节都记进去。
+class ReaderIoThread : public QThread
+{
+    Q_OBJECT
+
+public:
+    explicit ReaderIoThread(Posix_QextSerialPort *port, QObject *parent = 0);
+    ~ReaderIoThread();
+
+    // 以下接口只能在 UI（消费者）线程调用
+    void stop();
+    bool send(const QByteArray &rawPackage);
+    void rearmNotify();
+    bool takeFrame(IEEE1443Package &pkg);
+    int droppedFrames() const;
+    void setTrace(FrameTrace *trace);//start() 之前调用
+
+signals:
+    void framesAvailable();//队列由空变非空时发出，多帧合并为一次通知
+
+protected:
+    void run();
+
+private:
+    void wake();
+    void drainTx();
+    void decode(const char *p, int len);
+    void deliver(const FrameDecoder::Frame &frame);
+
+    Posix_QextSerialPort *commPort;
+    int wakePipe[2];//UI线程唤醒poll用
+    volatile bool stopRequested;
+
+    SpscRing<IEEE1443Package, 64> rxRing;//I/O线程 -> UI线程
+    SpscRing<QByteArray, 16> txRing;//UI线程 -> I/O线程
+    QAtomicInt notifyPending;//是否已有未处理的framesAvailable通知
+    QAtomicInt dropped;//队列满丢弃的帧数
+
+    FrameDecoder decoder;//拆帧状态，只在I/O线程访问
+    FrameTrace *trace;//收发字节环，可为空
+};
+
+#endif // READERIOTHREAD_H
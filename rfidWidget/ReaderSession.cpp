@@ -0,0 +1,615 @@
+#include "ReaderSession.h"
+#include "IEEE1443Package.h"
+#include "ReaderIoThread.h"
+#include "PrebuiltFrame.h"
+#include "TagInfo.h"
+#include "posix_qextserialport.h"
+#include <QTimer>
+#include <QDateTime>
+#include <QDebug>
+
+//读卡器忙时重试寻卡的间隔
+static const int kBusyRetryMs = 50;
+//卡放在读卡器上时确认收卡的间隔
+static const int kCardPresentIntervalMs = 100;
+//空闲退避的起始间隔
+static const int kIdleStartIntervalMs = 50;
+//命令出错时导出收发记录的最小间隔：读卡器断开时每次寻卡都会超时
+static const int kTraceDumpIntervalMs = 60000;
+
+// 功能：构造函数：创建调度器与自动寻卡定时器，串口在 open() 时才打开。
+ReaderSession::ReaderSession(QObject *parent) :
+    QObject(parent),
+    commPort(NULL),
+    readerIo(NULL),
+    scheduler(NULL),
+    autoSearchTimer(NULL),
+    autoSearchActive(false),
+    minSearchIntervalMs(0),
+    maxSearchIntervalMs(1000),
+    fastSearchWindowMs(10000),
+    idleSearchIntervalMs(0),
+    lastCardSeenMs(-1),
+    lastEmptyReplyMs(-1),
+    searchInProgress(false),
+    tagAuthenticated(false),
+    block1FromCache(false),
+    authKeyData(6, static_cast<char>(0xFF)),
+    lastTraceDumpMs(-1)
+{
+    //命令调度器：排队、等待回包超时与重发；400ms只是首个回包前的等待时间，之后按命令码自适应
+    scheduler = new CommandScheduler(this);
+    scheduler->setReplyTimeout(400);
+    scheduler->setReplyTimeoutRange(50, 2000);
+    scheduler->setMaxRetries(2);
+
+    //自动寻卡定时器，实现自动刷卡；每次寻卡链结束后按当前状态决定下一次寻卡的间隔
+    autoSearchTimer = new QTimer(this);
+    autoSearchTimer->setSingleShot(true);
+    searchClock.start();
+    connect(autoSearchTimer, SIGNAL(timeout()), this, SLOT(onAutoSearchTimeout()));
+}
+
+// 功能：析构函数：停收发线程并关闭串口。
+ReaderSession::~ReaderSession()
+{
+    close();
+}
+
+
+// === 串口与收发线程 ===
+// 功能：打开串口并启动收发线程。
+bool ReaderSession::open(const QString &portName)
+{
+    //1.防止重复打开
+    if(commPort != NULL)
+        return false;
+    //2.创建串口对象并设置参数
+    //串口fd由收发线程poll等待，不需要主线程的事件通知
+    commPort = new Posix_QextSerialPort(portName, QextSerialBase::Polling);
+    commPort->setBaudRate(BAUD19200);
+    commPort->setFlowControl(FLOW_OFF);
+    commPort->setParity(PAR_NONE);
+    commPort->setDataBits(DATA_8);
+    commPort->setStopBits(STOP_1);
+
+    //3.1打开串口
+    if(commPort->open(QIODevice::ReadWrite) == true)
+    {
+        //4.启动收发线程：串口读写、拆帧都在该线程完成，主线程卡顿不影响收包
+        readerIo = new ReaderIoThread(commPort, this);
+        frameTrace.setLabel(portName);
+        readerIo->setTrace(&frameTrace);
+        scheduler->attach(readerIo);
+        readerIo->start();
+        return true;
+    }
+    //3.2若打开失败，记录错误日志并删除串口对象
+    qDebug() << QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss")
+             << "device failed to open:" << commPort->errorString();
+    delete commPort;
+    commPort = NULL;
+    return false;
+}
+
+// 功能：停止自动寻卡、收发线程并关闭串口。
+void ReaderSession::close()
+{
+    //1.先放弃未完成的命令、停收发线程，再关闭串口、释放对象
+    stopAutoSearch();
+    scheduler->detach();
+    if(readerIo != NULL)
+    {
+        readerIo->stop();
+        delete readerIo;
+        readerIo = NULL;
+    }
+    if(commPort != NULL)
+    {
+        commPort->close();
+        delete commPort;
+        commPort = NULL;
+    }
+    //2.清理通讯状态
+    clearCard();
+}
+
+// === 参数 ===
+void ReaderSession::setAuthKey(const QByteArray &key)
+{
+    authKeyData = key;
+}
+
+// 功能：固定寻卡间隔（不自适应）。
+void ReaderSession::setAutoSearchInterval(int ms)
+{
+    setAutoSearchCadence(ms, ms);
+}
+
+// 功能：自适应寻卡间隔的上下限：有车时按下限连续寻卡，空闲时逐步放慢到上限。
+void ReaderSession::setAutoSearchCadence(int minMs, int maxMs)
+{
+    minSearchIntervalMs = qMax(0, minMs);
+    maxSearchIntervalMs = qMax(minSearchIntervalMs, maxMs);
+    idleSearchIntervalMs = 0;
+}
+
+// 功能：最近一次有卡之后保持快速寻卡的时长。
+void ReaderSession::setFastSearchWindow(int ms)
+{
+    fastSearchWindowMs = ms;
+}
+
+void ReaderSession::setReplyTimeout(int ms)
+{
+    scheduler->setReplyTimeout(ms);
+}
+
+void ReaderSession::setReplyTimeoutRange(int minMs, int maxMs)
+{
+    scheduler->setReplyTimeoutRange(minMs, maxMs);
+}
+
+void ReaderSession::setMaxRetries(int n)
+{
+    scheduler->setMaxRetries(n);
+}
+
+
+// === 自动寻卡 ===
+// 功能：启动自动寻卡，立即寻一次。
+void ReaderSession::startAutoSearch()
+{
+    if(autoSearchActive)
+        return;
+    autoSearchActive = true;
+    idleSearchIntervalMs = 0;
+    autoSearchTimer->start(0);
+}
+
+// 功能：停止自动寻卡，已发出的寻卡链照常走完。
+void ReaderSession::stopAutoSearch()
+{
+    autoSearchActive = false;
+    autoSearchTimer->stop();
+}
+
+bool ReaderSession::isAutoSearchActive() const
+{
+    return autoSearchActive;
+}
+
+// 功能：自动寻卡定时器超时处理。
+void ReaderSession::onAutoSearchTimeout()
+{
+    //读卡器正忙（写卡、校验读）：稍后再试，寻卡链结束时会重新排下一次
+    if(!searchCard())
+        autoSearchTimer->start(qBound(minSearchIntervalMs, kBusyRetryMs, maxSearchIntervalMs));
+}
+
+// 功能：寻卡链结束；自动寻卡时按状态排下一次寻卡。
+void ReaderSession::endSearch()
+{
+    searchInProgress = false;
+    if(autoSearchActive)
+        autoSearchTimer->start(nextSearchInterval());
+}
+
+// 功能：下一次寻卡的间隔。
+//   卡还在读卡器上：按较快的间隔确认是否收卡；
+//   最近有过卡（忙时、刚收卡）：按下限连续寻卡，下一辆车一到就能识别；
+//   之后每次空寻卡间隔加倍，直到上限。
+int ReaderSession::nextSearchInterval()
+{
+    qint64 now = searchClock.elapsed();
+    int ms;
+    if(!currentCardId.isEmpty())
+    {
+        idleSearchIntervalMs = 0;
+        ms = qBound(minSearchIntervalMs, kCardPresentIntervalMs, maxSearchIntervalMs);
+    }
+    else if(lastCardSeenMs >= 0 && now - lastCardSeenMs < fastSearchWindowMs)
+    {
+        idleSearchIntervalMs = 0;
+        ms = minSearchIntervalMs;
+    }
+    else
+    {
+        if(idleSearchIntervalMs == 0)
+            idleSearchIntervalMs = qMax(minSearchIntervalMs, kIdleStartIntervalMs);
+        else
+            idleSearchIntervalMs *= 2;
+        idleSearchIntervalMs = qMin(idleSearchIntervalMs, maxSearchIntervalMs);
+        ms = idleSearchIntervalMs;
+    }
+    _searchStats.intervalMs = ms;
+    return ms;
+}
+
+
+// 功能：记录识别到卡；新放上的卡统计识别耗时。
+//   卡在上一次空寻卡回包之后才放上，识别耗时不超过两者之差，按这个上界统计
+void ReaderSession::noteCardSeen(const QString &uid)
+{
+    qint64 now = searchClock.elapsed();
+    lastCardSeenMs = now;
+    if(uid == currentCardId || lastEmptyReplyMs < 0)
+        return;
+    qint64 ms = now - lastEmptyReplyMs;
+    lastEmptyReplyMs = -1;
+    _searchStats.detections++;
+    _searchStats.detectMsTotal += ms;
+    if(ms > _searchStats.detectMsMax)
+        _searchStats.detectMsMax = ms;
+}
+
+
+// === 卡操作 ===
+// 功能：请求寻卡，回包成功后自动走完整条链。
+bool ReaderSession::searchCard()
+{
+    //1.还有命令未完成||已经在寻卡：不重复发送
+    if(!scheduler->isIdle() || searchInProgress)
+        return false;
+    //2.发送预先生成的寻卡命令帧，并标记正在寻卡
+    if(!scheduler->submit(PrebuiltFrame::searchCard(), IEEE1443Package::SearchCard, this))
+        return false;
+    searchInProgress = true;
+    _searchStats.polls++;
+    return true;
+}
+
+// 功能：重新读取块1、块2（写卡后读回校验）。
+void ReaderSession::readUserBlocks()
+{
+    requestRead(UserBlock1);
+}
+
+// 功能：依次写入块1、块2，读卡器忙时排在当前流程之后。
+bool ReaderSession::writeUserBlocks(const QByteArray &b1, const QByteArray &b2)
+{
+    //1.安全检测
+    if(b1.size() != 16 || b2.size() != 16)
+    {
+        qWarning() << "ReaderSession: write data error";
+        return false;
+    }
+    //2.写块1，成功后在回调里接着写块2；两块都写成功后更新缓存
+    //  调度器不收（读卡器没连上）就不会有回调，当即告诉调用者
+    pendingBlock1 = b1;
+    pendingBlock2 = b2;
+    if(!requestWrite(UserBlock1, b1))
+    {
+        pendingBlock1.clear();
+        pendingBlock2.clear();
+        return false;
+    }
+    return true;
+}
+
+// 功能：把收发字节环追加导出到 RFID_TRACE（默认 ./frames.trace）。
+bool ReaderSession::dumpTrace(const QString &reason, QString *error) const
+{
+    return frameTrace.dump(FrameTrace::configuredPath(), reason, error);
+}
+
+// 功能：丢弃排队命令和重复包记录，清空当前卡状态。
+void ReaderSession::reset()
+{
+    scheduler->clear();
+    clearCard();
+    awaitingRemovalUid.clear();
+}
+
+// 功能：这张卡处理完、等待拿走：再次识别到它时不再选卡/认证/读块。
+void ReaderSession::setAwaitingRemoval(const QString &uid)
+{
+    awaitingRemovalUid = uid;
+}
+
+// 功能：清空当前卡状态。
+void ReaderSession::clearCard()
+{
+    searchInProgress = false;
+    tagAuthenticated = false;
+    currentCardId.clear();
+    block1.clear();
+    block1FromCache = false;
+    pendingBlock1.clear();
+    pendingBlock2.clear();
+}
+
+
+// === 协议指令 ===
+// 功能：请求防冲突指令。
+void ReaderSession::requestAntiColl()
+{
+    //发送预先生成的防冲突帧
+    scheduler->submit(PrebuiltFrame::antiColl(), IEEE1443Package::AntiColl, this);
+}
+
+// 功能：请求选择指定卡片。
+void ReaderSession::requestSelect(const QByteArray &uid)
+{
+    IEEE1443Package pkg(0, IEEE1443Package::SelectCard, uid);
+    scheduler->submit(pkg, this);
+}
+
+// 功能：是否为出厂默认Key（6字节0xFF）。
+static bool isDefaultAuthKey(const QByteArray &key)
+{
+    if(key.size() != 6)
+        return false;
+    for(int i = 0; i < key.size(); i++)
+    {
+        if((quint8)key.at(i) != 0xFF)
+            return false;
+    }
+    return true;
+}
+
+// 功能：请求认证指定块。
+void ReaderSession::requestAuth(quint8 blockNumber)
+{
+    //1.默认Key认证固定块：直接发送预先生成的帧
+    const QByteArray &prebuilt = PrebuiltFrame::authDefaultKey(blockNumber);
+    if(!prebuilt.isEmpty() && isDefaultAuthKey(authKeyData))
+    {
+        scheduler->submit(prebuilt, IEEE1443Package::Authentication, this, blockNumber);
+        return;
+    }
+    //2.构造认证信息
+    QByteArray authInfo;
+    authInfo.append(0x60);
+    authInfo.append((char)blockNumber);
+    authInfo.append(authKeyData);
+    //认证信息错误检查：结束本次流程
+    if(authInfo.size() != 8)
+    {
+        qWarning() << "ReaderSession: auth key error";
+        endSearch();
+        return;
+    }
+    //3.构造包并排队
+    IEEE1443Package pkg(0, IEEE1443Package::Authentication, authInfo);
+    scheduler->submit(pkg, this, blockNumber);
+}
+
+// 功能：请求读取指定块。
+void ReaderSession::requestRead(quint8 blockNumber)
+{
+    IEEE1443Package pkg(0, IEEE1443Package::ReadCard, (char)blockNumber);
+    //块号随命令带回
+    scheduler->submit(pkg, this, blockNumber);
+}
+
+// 功能：请求写入指定块，返回调度器是否接收。
+bool ReaderSession::requestWrite(quint8 blockNumber, const QByteArray &data)
+{
+    QByteArray writeInfo;
+    writeInfo.append((char)blockNumber);//块号
+    writeInfo.append(data);//信息
+    IEEE1443Package pkg(0, IEEE1443Package::WriteCard, writeInfo);
+    //块号随命令带回
+    return scheduler->submit(pkg, this, blockNumber);
+}
+
+
+// === 命令回调（事件驱动） ===
+// 功能：命令超时回调：重试用尽，结束本次流程。
+void ReaderSession::commandTimedOut(quint8 command, int tag)
+{
+    Q_UNUSED(tag);
+    //导出出错前的收发字节，间隔太短的不再导出
+    qint64 now = searchClock.elapsed();
+    if(lastTraceDumpMs < 0 || now - lastTraceDumpMs >= kTraceDumpIntervalMs)
+    {
+        lastTraceDumpMs = now;
+        QString error;
+        if(!dumpTrace(QString("command 0x%1 failed").arg(command, 2, 16, QChar('0')), &error))
+            qWarning() << "ReaderSession: trace dump:" << error;
+    }
+    bool lost = (command == IEEE1443Package::SearchCard);
+    if(lost)
+    {
+        tagAuthenticated = false;
+        currentCardId.clear();
+        awaitingRemovalUid.clear();
+    }
+    endSearch();
+    if(lost)
+        emit cardLost();
+    abortTransfer(command);
+    emit commandFailed(command);
+}
+
+// 功能：读写块没有得到有效回包（超时、空回包）：卡内容不确定，缓存作废，
+//       照常给出读写结果，使用者不必另外处理 commandFailed()。
+void ReaderSession::abortTransfer(quint8 command)
+{
+    if(command == IEEE1443Package::ReadCard)
+    {
+        tagCache.invalidate(currentCardId);
+        emit readFailed();
+    }
+    else if(command == IEEE1443Package::WriteCard)
+    {
+        tagCache.invalidate(currentCardId);
+        pendingBlock1.clear();
+        pendingBlock2.clear();
+        emit writeFinished(false);
+    }
+}
+
+// 功能：命令完成回调：推进寻卡链/写卡链（调度器已过滤不匹配和重复的包）。
+void ReaderSession::commandReplied(quint8 command, int tag, const IEEE1443Package &p)
+{
+    //1.解析load（收发字节已记在 frameTrace 里）
+    QByteArray d = p.data();
+    if(d.isEmpty())
+    {
+        qDebug() << QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss")
+                 << "empty payload for cmd" << p.command();
+        //结束本次流程
+        endSearch();
+        abortTransfer(command);
+        return;
+    }
+    //记录指令状态和信息
+    quint8 status = (quint8)d.at(0);
+    d = d.mid(1);
+
+    //2.命令分发逻辑
+    switch(command)
+    {
+    case IEEE1443Package::SearchCard:
+        if(status == 0)
+            requestAntiColl();
+        else
+        {
+            //无卡时清掉当前卡状态，避免“同卡再次放卡”被误判为没收卡
+            if(!currentCardId.isEmpty())
+            {
+                lastCardSeenMs = searchClock.elapsed();//刚收卡
+                scheduler->metrics().add(LaneMetrics::CardsLost);
+            }
+            lastEmptyReplyMs = searchClock.elapsed();
+            _searchStats.emptyPolls++;
+            tagAuthenticated = false;
+            currentCardId.clear();
+            endSearch();
+            awaitingRemovalUid.clear();
+            emit cardLost();
+        }
+        break;
+    case IEEE1443Package::AntiColl:
+        if(status == 0)
+        {
+            if(currentCardId != d.toHex())
+                scheduler->metrics().add(LaneMetrics::CardsDetected);
+            noteCardSeen(d.toHex());
+            currentCardId = d.toHex();
+            emit cardDetected(currentCardId);
+            //等待拿走的卡：省掉选卡、认证、读块1、读块2。
+            //重新寻卡后卡片已退出选中状态，认证随之失效
+            if(currentCardId == awaitingRemovalUid)
+            {
+                tagAuthenticated = false;
+                endSearch();
+                tagCache.noteSaved(4);
+                break;
+            }
+            requestSelect(d);
+        }
+        else
+            endSearch();
+        break;
+    case IEEE1443Package::SelectCard:
+        if(status == 0)
+        {
+            tagAuthenticated = false;
+            //自动认证块1所在扇区
+            requestAuth(UserBlock1);
+        }
+        else
+            endSearch();
+        break;
+    case IEEE1443Package::Authentication:
+        tagAuthenticated = (status == 0);//记录认证信息
+        if(!tagAuthenticated)
+        {
+            scheduler->metrics().add(LaneMetrics::AuthFailures);
+            endSearch();
+        }
+        else
+        {
+            //最近读过的卡：块1取缓存，只读块2拿最新余额，读到后核对块1校验
+            const TagCache::Entry *cached = tagCache.find(currentCardId);
+            block1FromCache = (cached != NULL);
+            if(cached)
+            {
+                block1 = cached->block1;
+                requestRead(UserBlock2);
+            }
+            else
+                requestRead(UserBlock1);//自动读块1用于判断是不是停车系统卡
+        }
+        break;
+    case IEEE1443Package::ReadCard:
+        if(status == 0)
+        {
+            //块号随命令带回
+            if(tag == UserBlock1)
+            {
+                block1 = d;
+                block1FromCache = false;
+                requestRead(UserBlock2);//读完块1，自动读块2
+            }
+            else if(tag == UserBlock2)
+            {
+                //块1取自缓存：块2记的块1校验对不上，块1在别的通道或注册时改过，重读块1
+                if(block1FromCache)
+                {
+                    block1FromCache = false;
+                    if(!tagBlock1Matches(block1, d))
+                    {
+                        tagCache.invalidate(currentCardId);
+                        tagCache.noteStale();
+                        requestRead(UserBlock1);
+                        break;
+                    }
+                    tagCache.noteSaved(1);
+                }
+                //只缓存能证明块1没变的停车系统卡：未注册卡可能马上在别的通道注册，
+                //没有块1校验的旧卡也没法核对
+                TagInfo probe;
+                if(decodeTagInfo(block1, d, probe) && tagBlock1Matches(block1, d))
+                    tagCache.store(currentCardId, block1, d);
+                else
+                    tagCache.invalidate(currentCardId);
+                emit cardRead(currentCardId, block1, d);
+                endSearch();
+            }
+        }
+        else
+        {
+            scheduler->metrics().add(LaneMetrics::ReadFailures);
+            endSearch();
+            tagCache.invalidate(currentCardId);
+            emit readFailed();
+        }
+        break;
+    case IEEE1443Package::WriteCard:
+        if(status == 0)
+        {
+            //继续写下一块；发不出去按写失败结束（块1已写，缓存作废）
+            if(tag == UserBlock1)
+            {
+                if(!requestWrite(UserBlock2, pendingBlock2))
+                    abortTransfer(IEEE1443Package::WriteCard);
+            }
+            else if(tag == UserBlock2)
+            {
+                if(tagBlock1Matches(pendingBlock1, pendingBlock2))
+                    tagCache.store(currentCardId, pendingBlock1, pendingBlock2);
+                else
+                    tagCache.invalidate(currentCardId);
+                pendingBlock1.clear();
+                pendingBlock2.clear();
+                emit writeFinished(true);
+            }
+        }
+        else
+        {
+            //可能只写进了块1，缓存作废，下次完整读
+            scheduler->metrics().add(LaneMetrics::WriteFailures);
+            tagCache.invalidate(currentCardId);
+            pendingBlock1.clear();
+            pendingBlock2.clear();
+            emit writeFinished(false);
+        }
+        break;
+    }
+
+    emit commandCompleted(command, status, d);
+}
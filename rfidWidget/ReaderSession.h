@@ -0,0 +1,192 @@
+#ifndef READERSESSION_H
+#define READERSESSION_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QString>
+#include <QElapsedTimer>
+#include "CommandScheduler.h"
+#include "TagCache.h"
+#include "FrameTrace.h"
+
+class QTimer;
+class IEEE1443Package;
+class ReaderIoThread;
+class Posix_QextSerialPort;
+
+// 读卡器会话：一条通道（一个串口、一个读卡器）上的全部协议流程，只依赖 QtCore。
+// 负责打开串口、收发线程、命令调度（排队/超时重发/重复包过滤）、自动寻卡，
+// 以及“寻卡-防冲突-选卡-认证块1-读块1-读块2”链和两块写卡。
+// 结果以普通信号发出，不弹窗、不碰界面；界面和无界面程序都只是连接这些信号。
+// 最近读过的卡块1取自 TagCache，只读块2，块2里的块1校验对不上再读块1；
+// 等待拿走的卡再次识别时跳过选卡之后的全部命令。
+// 收发字节记在 trace() 里（不再逐帧 qDebug），命令重试用尽时导出到 FrameTrace::configuredPath()，
+// 同一会话至少间隔一分钟。
+//
+//    ReaderSession s;
+//    connect(&s, SIGNAL(cardRead(QString,QByteArray,QByteArray)), ...);
+//    s.open("/dev/ttyS0");
+//    s.startAutoSearch();
+class ReaderSession : public QObject, private CommandScheduler::Handler
+{
+    Q_OBJECT
+
+public:
+    //停车系统使用块1和块2，认证块1所在扇区
+    enum {
+        UserBlock1 = 1,
+        UserBlock2 = 2
+    };
+
+    // 自动寻卡统计；识别耗时是“上一次空寻卡回包 -> 防冲突得到卡号”，为实际耗时的上界
+    struct SearchStats
+    {
+        quint32 polls;          // 发出的寻卡数
+        quint32 emptyPolls;     // 无卡回包数
+        quint32 detections;     // 新放上的卡被识别的次数
+        qint64 detectMsTotal;
+        qint64 detectMsMax;
+        int intervalMs;         // 最近一次排定的寻卡间隔
+        SearchStats() : polls(0), emptyPolls(0), detections(0),
+            detectMsTotal(0), detectMsMax(0), intervalMs(0) {}
+        double meanDetectMs() const {
+            return detections ? (double)detectMsTotal / detections : 0.0;
+        }
+    };
+
+    explicit ReaderSession(QObject *parent = 0);
+    ~ReaderSession();
+
+    // === 串口与收发线程 ===
+    bool isOpen() const {
+        return commPort != NULL;
+    }
+
+    // === 参数 ===
+    void setAuthKey(const QByteArray &key);//6字节KeyA，默认全0xFF
+    void setAutoSearchInterval(int ms);//固定间隔
+    void setAutoSearchCadence(int minMs, int maxMs);//自适应间隔上下限，默认0~1000ms
+    void setFastSearchWindow(int ms);//有卡后保持按下限寻卡的时长，默认10s
+    void setReplyTimeout(int ms);//还没有往返时间采样时的等待时间
+    void setReplyTimeoutRange(int minMs, int maxMs);
+    void setMaxRetries(int n);
+
+    // === 自动寻卡 ===
+    bool isAutoSearchActive() const;
+
+    // === 卡操作 ===
+    bool searchCard();//发起一次寻卡链，读卡器忙或链未结束时返回false
+    void readUserBlocks();//重新读块1、块2，结果仍由 cardRead()/readFailed() 给出
+    bool writeUserBlocks(const QByteArray &block1, const QByteArray &block2);//依次写块1、块2；返回false时不会再有 writeFinished()
+    void reset();//丢弃排队命令和当前卡状态
+    void setAwaitingRemoval(const QString &uid);//处理完等待拿走的卡，拿走（寻卡失败）前不再读它
+
+    // === 当前卡状态 ===
+    QString cardId() const {
+        return currentCardId;
+    }
+    bool isAuthenticated() const {
+        return tagAuthenticated;
+    }
+    bool isSearching() const {
+        return searchInProgress;
+    }
+    CommandScheduler::Stats schedulerStats() const {
+        return scheduler->stats();
+    }
+    QList<CommandScheduler::RttEstimate> replyTimeoutEstimates() const {
+        return scheduler->rttEstimates();
+    }
+    SearchStats searchStats() const {
+        return _searchStats;
+    }
+    TagCache::Stats tagCacheStats() const {
+        return tagCache.stats();
+    }
+    // 原子计数，任意线程可取 metrics().snapshot()
+    const LaneMetrics &metrics() const {
+        return scheduler->metrics();
+    }
+    // 收发字节环，任意线程可导出；通道号在 open() 前设置
+    FrameTrace &trace() {
+        return frameTrace;
+    }
+    const FrameTrace &trace() const {
+        return frameTrace;
+    }
+    bool dumpTrace(const QString &reason, QString *error = 0) const;//追加到 FrameTrace::configuredPath()
+
+public slots:
+    // 会话放进工作线程（LanePool）时，由其它线程经 QMetaObject::invokeMethod 调用
+    bool open(const QString &portName);
+    void close();
+    void startAutoSearch();
+    void stopAutoSearch();
+
+signals:
+    // 每条命令的回包（状态字节 + 去掉状态后的数据），用于界面显示结果
+    void commandCompleted(quint8 command, quint8 status, const QByteArray &data);
+    // 重试用尽仍无回包；读写块的失败另有 readFailed()/writeFinished(false)，先于本信号发出
+    void commandFailed(quint8 command);
+    // 防冲突得到卡号
+    void cardDetected(const QString &cardId);
+    // 寻卡失败或寻卡超时：读卡器前没有卡
+    void cardLost();
+    // 块1、块2读取完成（寻卡链末尾或 readUserBlocks()）
+    void cardRead(const QString &cardId, const QByteArray &block1, const QByteArray &block2);
+    // 读块失败（状态非0、超时或空回包）
+    void readFailed();
+    // 两块写卡结束；状态非0、超时或空回包时 ok 为 false
+    void writeFinished(bool ok);
+
+private slots:
+    void onAutoSearchTimeout();
+
+private:
+    // === 命令回调（CommandScheduler::Handler） ===
+    void commandReplied(quint8 command, int tag, const IEEE1443Package &p);
+    void commandTimedOut(quint8 command, int tag);
+
+    // === 协议指令 ===
+    void requestAntiColl();
+    void requestSelect(const QByteArray &uid);
+    void requestAuth(quint8 blockNumber);
+    void requestRead(quint8 blockNumber);
+    bool requestWrite(quint8 blockNumber, const QByteArray &data);
+    void clearCard();
+    void abortTransfer(quint8 command);
+
+    // === 自动寻卡节奏 ===
+    void endSearch();
+    int nextSearchInterval();
+    void noteCardSeen(const QString &uid);
+
+    Posix_QextSerialPort *commPort;
+    ReaderIoThread *readerIo;//串口收发线程
+    CommandScheduler *scheduler;//命令排队、超时重发、重复包过滤
+    QTimer *autoSearchTimer;//自动寻卡-定时器（单次触发，每次寻卡链结束后重新排）
+    bool autoSearchActive;
+    int minSearchIntervalMs;
+    int maxSearchIntervalMs;
+    int fastSearchWindowMs;
+    int idleSearchIntervalMs;//空闲退避当前间隔，0表示未在退避
+    QElapsedTimer searchClock;
+    qint64 lastCardSeenMs;//最近一次识别到卡或收卡的时刻，-1表示没有
+    qint64 lastEmptyReplyMs;//最近一次无卡回包的时刻，-1表示识别后还没有
+    SearchStats _searchStats;
+
+    bool searchInProgress;//寻卡链进行中
+    QString currentCardId;//当前识别到的ID
+    bool tagAuthenticated;//是否认证成功
+    QByteArray block1;//本次读到（或取自缓存）的块1
+    bool block1FromCache;//块1取自缓存，读到块2后核对
+    QByteArray pendingBlock1;//正在写的块1，写完两块后存入缓存
+    QByteArray pendingBlock2;//写完块1后接着写的块2
+    QString awaitingRemovalUid;//等待拿走的卡号
+    TagCache tagCache;//按卡号缓存块内容
+    QByteArray authKeyData;//认证Key数据
+    FrameTrace frameTrace;//收发字节环
+    qint64 lastTraceDumpMs;//最近一次出错导出的时刻，-1表示没有
+};
+
+#endif // READERSESSION_H
@@ -0,0 +1,49 @@
+#ifndef SPSCRING_H
+#define SPSCRING_H
+#include <QAtomicInt>
+
+// 单生产者/单消费者无锁环形队列
+// push() 只能在生产者线程调用，pop() 只能在消费者线程调用；
+// Size 必须是 2 的幂，实际可用容量为 Size - 1。
+template <typename T, int Size>
+class SpscRing {
+    T _slots[Size];
+    QAtomicInt _head;           // 下一个写入位置，由生产者推进
+    QAtomicInt _tail;           // 下一个读取位置，由消费者推进
+
+    enum { Mask = Size - 1 };
+
+public:
+    SpscRing() : _head(0), _tail(0) {}
+
+    bool push(const T &item) {
+        int head = _head.fetchAndAddRelaxed(0);
+        int next = (head + 1) & Mask;
+        if(next == _tail.fetchAndAddAcquire(0))
+            return false;       // 满
+        _slots[head] = item;
+        _head.fetchAndStoreRelease(next);
+        return true;
+    }
+
+    bool pop(T &item) {
+        int tail = _tail.fetchAndAddRelaxed(0);
+        if(tail == _head.fetchAndAddAcquire(0))
+            return false;       // 空
+        item = _slots[tail];
+        _slots[tail] = T();     // 及时释放槽内数据
+        _tail.fetchAndStoreRelease((tail + 1) & Mask);
+        return true;
+    }
+
+    bool isEmpty() const {
+        return const_cast<QAtomicInt &>(_tail).fetchAndAddAcquire(0)
+                == const_cast<QAtomicInt &>(_head).fetchAndAddAcquire(0);
+    }
+
+    static int capacity() {
+        return Size - 1;
+    }
+};
+
+#endif // SPSCRING_H
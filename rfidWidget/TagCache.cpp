@@ -0,0 +1,83 @@
+#include "TagCache.h"
+
+TagCache::TagCache(int n, int ms) :
+    capacity(qMax(1, n)),
+    maxAgeMs(ms)
+{
+    clock.start();
+    entries.reserve(capacity + 1);
+}
+
+void TagCache::setCapacity(int n)
+{
+    capacity = qMax(1, n);
+    while(entries.size() > capacity)
+        evictOldest();
+}
+
+void TagCache::setMaxAge(int ms)
+{
+    maxAgeMs = ms;
+}
+
+// 功能：按卡号查找，顺带删除过期条目。
+const TagCache::Entry *TagCache::find(const QString &uid)
+{
+    _stats.lookups++;
+    QHash<QString, Entry>::iterator it = entries.find(uid);
+    if(it == entries.end())
+        return NULL;
+    qint64 now = clock.elapsed();
+    if(maxAgeMs > 0 && now - it.value().storedAtMs > maxAgeMs)
+    {
+        entries.erase(it);
+        return NULL;
+    }
+    _stats.hits++;
+    it.value().lastUsedMs = now;
+    return &it.value();
+}
+
+// 功能：写入或更新一张卡的两块内容。
+void TagCache::store(const QString &uid, const QByteArray &block1, const QByteArray &block2)
+{
+    QHash<QString, Entry>::iterator it = entries.find(uid);
+    if(it == entries.end())
+    {
+        if(entries.size() >= capacity)
+            evictOldest();
+        it = entries.insert(uid, Entry());
+    }
+    Entry &e = it.value();
+    e.block1 = block1;
+    e.block2 = block2;
+    e.version++;
+    e.storedAtMs = clock.elapsed();
+    e.lastUsedMs = e.storedAtMs;
+}
+
+void TagCache::invalidate(const QString &uid)
+{
+    entries.remove(uid);
+}
+
+void TagCache::clear()
+{
+    entries.clear();
+}
+
+// 功能：淘汰最久未用的条目，容量很小，线性扫描即可。
+void TagCache::evictOldest()
+{
+    if(entries.isEmpty())
+        return;
+    QHash<QString, Entry>::iterator oldest = entries.begin();
+    QHash<QString, Entry>::iterator it = entries.begin();
+    for(; it != entries.end(); ++it)
+    {
+        if(it.value().lastUsedMs < oldest.value().lastUsedMs)
+            oldest = it;
+    }
+    entries.erase(oldest);
+    _stats.evictions++;
+}
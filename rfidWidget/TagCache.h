@@ -0,0 +1,75 @@
+#ifndef TAGCACHE_H
+#define TAGCACHE_H
+
+#include <QHash>
+#include <QString>
+#include <QByteArray>
+#include <QElapsedTimer>
+
+// 按卡号缓存最近读到/写入的块1、块2。
+// 块1（签名、车主、车型）只有注册时才写，同一张卡反复刷卡时可以直接用缓存，
+// 只读块2取最新余额；本通道写卡成功后用写入内容更新缓存，版本号加一。
+// 别的通道或注册可能改过块1（车型决定计费）：使用者读到块2后用块2里的块1校验核对，
+// 对不上就作废并重读块1，记为 stale；只缓存带块1校验的卡。
+// 容量固定，满了淘汰最久未用的；超过有效期的条目视为未命中并删除。
+class TagCache
+{
+public:
+    struct Entry
+    {
+        QByteArray block1;
+        QByteArray block2;
+        quint32 version;//每次更新加一
+        qint64 storedAtMs;//更新时刻（单调时钟）
+        qint64 lastUsedMs;
+        Entry() : version(0), storedAtMs(0), lastUsedMs(0) {}
+    };
+
+    struct Stats
+    {
+        quint32 lookups;
+        quint32 hits;
+        quint32 evictions;
+        quint32 roundTripsSaved;//因缓存少发的命令数
+        quint32 stale;//命中但块1已在别处改过，重读
+        Stats() : lookups(0), hits(0), evictions(0), roundTripsSaved(0), stale(0) {}
+        double hitRate() const {
+            return lookups ? (double)hits / lookups : 0.0;
+        }
+    };
+
+    explicit TagCache(int capacity = 32, int maxAgeMs = 5 * 60 * 1000);
+
+    void setCapacity(int n);
+    void setMaxAge(int ms);
+
+    // 命中返回条目（到下一次修改缓存前有效），未命中或过期返回NULL
+    const Entry *find(const QString &uid);
+    void store(const QString &uid, const QByteArray &block1, const QByteArray &block2);
+    void invalidate(const QString &uid);
+    void clear();
+
+    void noteSaved(int roundTrips) {
+        _stats.roundTripsSaved += roundTrips;
+    }
+    void noteStale() {
+        _stats.stale++;
+    }
+    Stats stats() const {
+        return _stats;
+    }
+    int size() const {
+        return entries.size();
+    }
+
+private:
+    void evictOldest();
+
+    QHash<QString, Entry> entries;
+    int capacity;
+    int maxAgeMs;
+    QElapsedTimer clock;
+    Stats _stats;
+};
+
+#endif // TAGCACHE_H
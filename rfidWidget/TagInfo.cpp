@@ -0,0 +1,113 @@
+#include "TagInfo.h"
+
+//块1前两字节签名，用来判断这张卡是不是“停车系统卡”
+static const char kTagSignature1 = 'P';
+static const char kTagSignature2 = 'K';
+
+// 功能：块1校验（FNV-1a 32位），写在块2里。
+static quint32 block1Checksum(const QByteArray &b1)
+{
+    quint32 h = 2166136261U;
+    for(int i = 0; i < b1.size(); i++)
+        h = (h ^ (quint8)b1.at(i)) * 16777619U;
+    return h;
+}
+
+// 功能：车辆类型文本转编码。
+static char vehicleCodeFromText(const QString &text)
+{
+    if(text == "Sedan")
+        return 1;
+    if(text == "SUV")
+        return 2;
+    if(text == "Truck")
+        return 3;
+    if(text == "Electric")
+        return 4;
+    return 0;
+}
+
+// 功能：车辆类型编码转文本。
+static QString vehicleTextFromCode(char c)
+{
+    switch((int)(unsigned char)c)
+    {
+    case 1:
+        return "Sedan";
+    case 2:
+        return "SUV";
+    case 3:
+        return "Truck";
+    case 4:
+        return "Electric";
+    default:
+        return "Other";
+    }
+}
+
+// 功能：从块数据解析 TagInfo。
+bool decodeTagInfo(const QByteArray &b1, const QByteArray &b2, TagInfo &info)
+{
+    //1.初始化为无效信息
+    info.valid = false;
+    //2.检验块是否有效
+    if(b1.size() != 16 || b2.size() != 16)
+        return false;
+    if((b1.at(0) != kTagSignature1) || (b1.at(1) != kTagSignature2))
+        return false;
+    //3.解析车主信息
+    QByteArray ownerBytes = b1.mid(4, 12);
+    int nullIndex = ownerBytes.indexOf('\0');
+    if(nullIndex >= 0)
+        ownerBytes.truncate(nullIndex);
+    info.owner = QString::fromLatin1(ownerBytes).trimmed();
+    info.vehicleType = vehicleTextFromCode(b1.at(3));
+    //4.解析余额信息
+    int bal = 0;
+    bal |= (quint8)b2.at(0);
+    bal |= ((quint8)b2.at(1)) << 8;
+    bal |= ((quint8)b2.at(2)) << 16;
+    bal |= ((quint8)b2.at(3)) << 24;
+    info.balance = bal;
+    //5.设为有效信息
+    info.valid = true;
+    return true;
+}
+
+// 功能：将 TagInfo 编码为块数据。
+void encodeTagInfo(const TagInfo &info, QByteArray &b1, QByteArray &b2)
+{
+    //1.初始化两个块
+    b1 = QByteArray(16, 0x00);
+    b2 = QByteArray(16, 0x00);
+    //2.写入卡片签名与固定标志
+    b1[0] = kTagSignature1;//P
+    b1[1] = kTagSignature2;//K
+    b1[2] = 0x01;
+    //3.写入车型、车主信息
+    b1[3] = vehicleCodeFromText(info.vehicleType);
+    QByteArray nameBytes = info.owner.left(12).toLatin1();
+    //4.写入余额信息
+    int i;
+    for(i = 0; i < nameBytes.size() && i < 12; ++i)
+        b1[4 + i] = nameBytes.at(i);
+    b2[0] = (char)(info.balance & 0xFF);
+    b2[1] = (char)((info.balance >> 8) & 0xFF);
+    b2[2] = (char)((info.balance >> 16) & 0xFF);
+    b2[3] = (char)((info.balance >> 24) & 0xFF);
+    //5.写入块1校验
+    quint32 sum = block1Checksum(b1);
+    for(i = 0; i < 4; ++i)
+        b2[4 + i] = (char)((sum >> (8 * i)) & 0xFF);
+}
+
+// 功能：块2里记的块1校验是否与 b1 一致。
+bool tagBlock1Matches(const QByteArray &b1, const QByteArray &b2)
+{
+    if(b1.size() != 16 || b2.size() != 16)
+        return false;
+    quint32 sum = 0;
+    for(int i = 0; i < 4; ++i)
+        sum |= ((quint32)(quint8)b2.at(4 + i)) << (8 * i);
+    return sum == block1Checksum(b1);
+}
@@ -0,0 +1,25 @@
+#ifndef TAGINFO_H
+#define TAGINFO_H
+
+#include <QString>
+#include <QByteArray>
+
+//停车用户信息结构体
+struct TagInfo
+{
+    QString owner;//12字节——块1
+    QString vehicleType;//1字节——块1
+    int balance;//4字节——块2
+    bool valid;//由块1开头签名判断是否为“停车系统格式卡”
+    TagInfo() : balance(0), valid(false) {}
+};
+
+// 停车系统卡格式：
+//   块1：'P' 'K' 0x01 车型 车主(12字节，不足补0)
+//   块2：余额(4字节小端) 块1校验(4字节小端，FNV-1a) 其余补0
+// 块1校验让只读块2的一方能确认缓存的块1没被别处改过；旧卡这4字节为0，下次写卡时补上。
+bool decodeTagInfo(const QByteArray &b1, const QByteArray &b2, TagInfo &info);
+void encodeTagInfo(const TagInfo &info, QByteArray &b1, QByteArray &b2);
+bool tagBlock1Matches(const QByteArray &b1, const QByteArray &b2);//块2记的块1校验与 b1 一致
+
+#endif // TAGINFO_H
@@ -0,0 +1,251 @@
+#include "Tariff.h"
+#include <QFile>
+#include <QRegExp>
+#include <QStringList>
+#include <QtAlgorithms>
+#include <limits.h>
+
+static const int kMinutesPerDay = 1440;
+//缺省单价（每小时），和原来的 kHourFee 一致
+static const int kDefaultHourFee = 5;
+
+Tariff::Tariff() :
+    defaultClass(-1)
+{
+    Rule r;
+    r.bands.append(qMakePair(0, kDefaultHourFee));
+    QList<Rule> rules;
+    rules.append(r);
+    compile(rules);
+}
+
+QString Tariff::configuredPath()
+{
+    QByteArray env = qgetenv("RFID_TARIFF");
+    if(!env.isEmpty())
+        return QString::fromLocal8Bit(env.constData());
+    return "tariff.conf";
+}
+
+
+// === 规则表 ===
+// 功能：解析文本规则表，每行一类车：
+//   车型  计费单位(分钟)  免费分钟  每日封顶(0不封顶)  起点=单价 ...
+//   *      60  15  60  08:00=5 20:00=2
+// # 之后为注释。
+bool Tariff::parse(const QString &text, QList<Rule> *rules, QString *error)
+{
+    QList<Rule> out;
+    QStringList lines = text.split('\n');
+    for(int n = 0; n < lines.size(); n++)
+    {
+        //1.去掉注释和空行
+        QString line = lines.at(n);
+        int hash = line.indexOf('#');
+        if(hash >= 0)
+            line.truncate(hash);
+        QStringList f = line.split(QRegExp("\\s+"), QString::SkipEmptyParts);
+        if(f.isEmpty())
+            continue;
+        if(f.size() < 5)
+        {
+            if(error)
+                *error = QString("line %1: expected type, unit, grace, cap and at least one band").arg(n + 1);
+            return false;
+        }
+        //2.定长字段
+        Rule r;
+        bool ok1, ok2, ok3;
+        r.vehicleType = f.at(0);
+        r.unitMinutes = f.at(1).toInt(&ok1);
+        r.graceMinutes = f.at(2).toInt(&ok2);
+        r.dailyCap = f.at(3).toInt(&ok3);
+        if(!ok1 || !ok2 || !ok3)
+        {
+            if(error)
+                *error = QString("line %1: unit, grace and cap must be integers").arg(n + 1);
+            return false;
+        }
+        //3.时段：HH:MM=单价
+        QRegExp band("(\\d{1,2}):(\\d{2})=(\\d+)");
+        for(int i = 4; i < f.size(); i++)
+        {
+            if(!band.exactMatch(f.at(i)))
+            {
+                if(error)
+                    *error = QString("line %1: bad band '%2'").arg(n + 1).arg(f.at(i));
+                return false;
+            }
+            int start = band.cap(1).toInt() * 60 + band.cap(2).toInt();
+            r.bands.append(qMakePair(start, band.cap(3).toInt()));
+        }
+        out.append(r);
+    }
+    *rules = out;
+    return true;
+}
+
+// 功能：检查规则并编成前缀和表；任何一条不合法都不替换当前规则。
+bool Tariff::compile(const QList<Rule> &rules, QString *error)
+{
+    QVector<Class> built;
+    QHash<QString, int> index;
+    int fallback = -1;
+    for(int k = 0; k < rules.size(); k++)
+    {
+        const Rule &r = rules.at(k);
+        QString where = QString("rule '%1'").arg(r.vehicleType);
+        //1.检查
+        QString problem;
+        if(r.unitMinutes <= 0 || kMinutesPerDay % r.unitMinutes != 0)
+            problem = "unit must divide 1440 minutes";
+        else if(r.graceMinutes < 0 || r.dailyCap < 0)
+            problem = "grace and cap must not be negative";
+        else if(r.bands.isEmpty())
+            problem = "no bands";
+        else if(index.contains(r.vehicleType) || (r.vehicleType == "*" && fallback >= 0))
+            problem = "duplicate vehicle type";
+        for(int i = 0; problem.isEmpty() && i < r.bands.size(); i++)
+        {
+            int start = r.bands.at(i).first;
+            if(start < 0 || start >= kMinutesPerDay || (i > 0 && start <= r.bands.at(i - 1).first))
+                problem = "band starts must increase within one day";
+            else if(r.bands.at(i).second < 0)
+                problem = "negative rate";
+        }
+        if(!problem.isEmpty())
+        {
+            if(error)
+                *error = where + ": " + problem;
+            return false;
+        }
+        //2.时段起点单独放一个有序数组，二分查找每个计费单位的单价
+        QVector<int> starts;
+        for(int i = 0; i < r.bands.size(); i++)
+            starts.append(r.bands.at(i).first);
+        //3.每个相位一行前缀和
+        Class c;
+        c.unit = r.unitMinutes;
+        c.slotsPerDay = kMinutesPerDay / c.unit;
+        c.grace = r.graceMinutes;
+        c.cap = r.dailyCap;
+        c.prefix.resize(c.unit * (c.slotsPerDay + 1));
+        for(int phase = 0; phase < c.unit; phase++)
+        {
+            qint64 *row = c.prefix.data() + phase * (c.slotsPerDay + 1);
+            row[0] = 0;
+            for(int j = 0; j < c.slotsPerDay; j++)
+            {
+                int minute = phase + j * c.unit;
+                int b = (int)(qUpperBound(starts.begin(), starts.end(), minute) - starts.begin()) - 1;
+                if(b < 0)
+                    b = starts.size() - 1;//首段之前属于前一天的末段
+                row[j + 1] = row[j] + r.bands.at(b).second;
+            }
+        }
+        if(r.vehicleType == "*")
+            fallback = built.size();
+        else
+            index.insert(r.vehicleType, built.size());
+        built.append(c);
+    }
+    if(fallback < 0)
+    {
+        if(error)
+            *error = "missing default rule '*'";
+        return false;
+    }
+    source = rules;
+    classes = built;
+    classIndex = index;
+    defaultClass = fallback;
+    return true;
+}
+
+// 功能：从文件读规则表；文件不存在时沿用当前规则。
+bool Tariff::load(const QString &path, QString *error)
+{
+    QFile file(path);
+    if(!file.exists())
+        return true;
+    if(!file.open(QIODevice::ReadOnly))
+    {
+        if(error)
+            *error = QString("cannot open %1").arg(path);
+        return false;
+    }
+    QList<Rule> rules;
+    if(!parse(QString::fromUtf8(file.readAll().constData()), &rules, error))
+        return false;
+    return compile(rules, error);
+}
+
+
+// === 计费 ===
+int Tariff::classOf(const QString &vehicleType) const
+{
+    QHash<QString, int>::const_iterator it = classIndex.constFind(vehicleType);
+    return it != classIndex.constEnd() ? it.value() : defaultClass;
+}
+
+qint64 Tariff::cost(const Class &c, int phase, int from, int to)
+{
+    const qint64 *row = c.prefix.constData() + phase * (c.slotsPerDay + 1);
+    qint64 sum = row[to] - row[from];
+    return (c.cap > 0 && sum > c.cap) ? c.cap : sum;
+}
+
+// 功能：按入场钟面时刻和停车分钟数计费：首日、末日各查一次表，中间整天按整天费用乘天数。
+int Tariff::fee(int entryMinuteOfDay, qint64 minutes, const QString &vehicleType) const
+{
+    const Class &c = classes.at(classOf(vehicleType));
+    if(minutes <= c.grace)
+        return 0;
+    //1.第 g 个单位（从入场当天0点的相位起算）落在第 g / S 天的第 g % S 个位置
+    int phase = entryMinuteOfDay % c.unit;
+    qint64 units = (minutes + c.unit - 1) / c.unit;
+    qint64 g0 = entryMinuteOfDay / c.unit;
+    qint64 g1 = g0 + units;
+    qint64 d0 = g0 / c.slotsPerDay;
+    qint64 d1 = (g1 - 1) / c.slotsPerDay;
+    //2.同一天
+    qint64 total;
+    if(d0 == d1)
+    {
+        total = cost(c, phase, (int)(g0 - d0 * c.slotsPerDay), (int)(g1 - d0 * c.slotsPerDay));
+    }
+    //3.跨天：首日剩余 + 整天 + 末日开头
+    else
+    {
+        total = cost(c, phase, (int)(g0 % c.slotsPerDay), c.slotsPerDay)
+                + (d1 - d0 - 1) * cost(c, phase, 0, c.slotsPerDay)
+                + cost(c, phase, 0, (int)((g1 - 1) % c.slotsPerDay) + 1);
+    }
+    return total > INT_MAX ? INT_MAX : (int)total;
+}
+
+int Tariff::fee(const QDateTime &entry, const QDateTime &exit, const QString &vehicleType) const
+{
+    if(!entry.isValid() || !exit.isValid())
+        return 0;
+    qint64 secs = qMax<qint64>(0, entry.secsTo(exit));
+    QTime t = entry.time();
+    return fee(t.hour() * 60 + t.minute(), secs / 60, vehicleType);
+}
+
+// 功能：批量计费（日结、改价试算），返回总额。
+qint64 Tariff::feeBatch(const QVector<Session> &sessions, QVector<int> *fees) const
+{
+    if(fees)
+        fees->resize(sessions.size());
+    qint64 total = 0;
+    for(int i = 0; i < sessions.size(); i++)
+    {
+        const Session &s = sessions.at(i);
+        int f = fee(s.entry, s.exit, s.vehicleType);
+        if(fees)
+            (*fees)[i] = f;
+        total += f;
+    }
+    return total;
+}
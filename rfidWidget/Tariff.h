@@ -0,0 +1,73 @@
+#ifndef TARIFF_H
+#define TARIFF_H
+
+#include <QDateTime>
+#include <QHash>
+#include <QList>
+#include <QPair>
+#include <QString>
+#include <QVector>
+
+// 计费规则：按车型分类，每类有计费单位、免费时长、每日封顶和一天内的若干时段单价。
+// 从入场起每满/不满一个计费单位收一次费，单价取该单位开始时刻所在时段的单价；
+// 每个自然日（按单位开始时刻算）的费用不超过封顶；总时长不超过免费时长不收费。
+// compile() 把规则表编成扁平的前缀和表：每类按“入场分钟对计费单位取余”分相位，
+// 每个相位存一天内各计费单位的累计费用，计费时只查表做几次加减，和停车天数、时段数无关。
+// 编好后只读，多个通道线程可以同时调用 fee()/feeBatch()。
+// 时间按本地钟面计算，一天固定 1440 分钟（不处理夏令时）。
+class Tariff
+{
+public:
+    struct Rule
+    {
+        QString vehicleType;            // 车型，"*" 为缺省
+        int unitMinutes;                // 计费单位（分钟），须整除 1440
+        int graceMinutes;               // 免费时长（分钟）
+        int dailyCap;                   // 每日封顶，0 不封顶
+        QList<QPair<int, int> > bands;  // （时段起点：当天第几分钟，每单位单价），起点递增，首段之前沿用末段
+        Rule() : vehicleType("*"), unitMinutes(60), graceMinutes(0), dailyCap(0) {}
+    };
+
+    struct Session
+    {
+        QDateTime entry;
+        QDateTime exit;
+        QString vehicleType;
+    };
+
+    Tariff();//缺省规则：全天每小时 5
+
+    // === 规则表 ===
+    static bool parse(const QString &text, QList<Rule> *rules, QString *error = 0);
+    bool compile(const QList<Rule> &rules, QString *error = 0);//失败时保持原规则
+    bool load(const QString &path, QString *error = 0);//文件不存在时保持原规则，返回true
+    static QString configuredPath();//环境变量 RFID_TARIFF，默认 ./tariff.conf
+    QList<Rule> rules() const {
+        return source;
+    }
+
+    // === 计费 ===
+    int fee(const QDateTime &entry, const QDateTime &exit, const QString &vehicleType) const;
+    int fee(int entryMinuteOfDay, qint64 minutes, const QString &vehicleType) const;
+    qint64 feeBatch(const QVector<Session> &sessions, QVector<int> *fees) const;//返回总额
+
+private:
+    struct Class
+    {
+        int unit;           // 计费单位（分钟）
+        int slotsPerDay;    // 1440 / unit
+        int grace;
+        qint64 cap;         // 每日封顶，0 不封顶
+        QVector<qint64> prefix;// [相位 * (slotsPerDay + 1) + j]：该相位前 j 个单位的累计费用
+    };
+
+    int classOf(const QString &vehicleType) const;
+    static qint64 cost(const Class &c, int phase, int from, int to);//当天第 from..to-1 个单位，已封顶
+
+    QList<Rule> source;
+    QVector<Class> classes;
+    QHash<QString, int> classIndex;// 车型 -> classes 下标
+    int defaultClass;
+};
+
+#endif // TARIFF_H
@@ -13,6 +13,7 @@ warnings) in the project.  Note that _TTY_NOWARN_ will also turn off portability
 */
 
 #include <stdio.h>
+#include <QSocketNotifier>
 #include "posix_qextserialport.h"
 
 /*!
@@ -42,6 +43,7 @@ Posix_QextSerialPort::Posix_QextSerialPort()
 : QextSerialBase()
 {
     Posix_File=new QFile();
+    readNotifier=NULL;
 }
 
 /*!
@@ -62,6 +64,7 @@ Posix_QextSerialPort::Posix_QextSerialPort(const Posix_QextSerialPort& s)
 
     Posix_File=new QFile();
     Posix_File=s.Posix_File;
+    readNotifier=NULL;
     memcpy(&Posix_Timeout, &s.Posix_Timeout, sizeof(struct timeval));
     memcpy(&Posix_Copy_Timeout, &s.Posix_Copy_Timeout, sizeof(struct timeval));
     memcpy(&Posix_CommConfig, &s.Posix_CommConfig, sizeof(struct termios));
@@ -143,8 +146,7 @@ Posix_QextSerialPort& Posix_QextSerialPort::operator=(const Posix_QextSerialPort
 
 void Posix_QextSerialPort::init()
 {
-	if (queryMode() == QextSerialBase::EventDriven)
-		qWarning("POSIX doesn't have event driven mechanism implemented yet");
+    readNotifier=NULL;
 }
 
 /*!
@@ -860,6 +862,15 @@ bool Posix_QextSerialPort::open(OpenMode mode)
             setFlowControl(Settings.FlowControl);
             setTimeout(Settings.Timeout_Millisec);
             tcsetattr(Posix_File->handle(), TCSAFLUSH, &Posix_CommConfig);
+
+            /*the descriptor itself never blocks; readData()/writeData() wait with select() instead*/
+            fcntl(Posix_File->handle(), F_SETFL, fcntl(Posix_File->handle(), F_GETFL) | O_NONBLOCK);
+
+            /*in event driven mode readyRead() is emitted as soon as the tty becomes readable*/
+            if (queryMode() == QextSerialBase::EventDriven) {
+                readNotifier=new QSocketNotifier(Posix_File->handle(), QSocketNotifier::Read, this);
+                connect(readNotifier, SIGNAL(activated(int)), this, SIGNAL(readyRead()));
+            }
         } else {
             qDebug("Could not open File! Error code : %d", Posix_File->error());
         }
@@ -876,6 +887,11 @@ is not currently open.
 void Posix_QextSerialPort::close()
 {
     LOCK_MUTEX();
+    if (readNotifier) {
+        readNotifier->setEnabled(false);
+        delete readNotifier;
+        readNotifier=NULL;
+    }
     Posix_File->close();
     QIODevice::close();
     UNLOCK_MUTEX();
@@ -915,7 +931,8 @@ qint64 Posix_QextSerialPort::size() const
 \fn qint64 Posix_QextSerialPort::bytesAvailable()
 Returns the number of bytes waiting in the port's receive queue.  This function will return 0 if
 the port is not currently open, or -1 on error.  Error information can be retrieved by calling
-Posix_QextSerialPort::getLastError().
+Posix_QextSerialPort::getLastError().  This call waits up to the port timeout in select(); callers
+that only want what is already queued should use readAvailable() instead.
 */
 qint64 Posix_QextSerialPort::bytesAvailable()
 {
@@ -949,6 +966,35 @@ qint64 Posix_QextSerialPort::bytesAvailable()
     return 0;
 }
 
+/*!
+\fn qint64 Posix_QextSerialPort::readAvailable(char * data, qint64 maxSize)
+Reads whatever is already queued in the receive buffer, at most maxSize bytes, with a single
+non-blocking read() and no select()/FIONREAD round trip.  Returns the number of bytes read, 0 if
+nothing is queued, or -1 on error.  This function does not take the port mutex; call it only from
+the thread that owns reading from the port (typically after poll() reported the descriptor
+readable).  Use read() when blocking with the configured timeout is wanted.
+*/
+qint64 Posix_QextSerialPort::readAvailable(char * data, qint64 maxSize)
+{
+    int retVal=::read(Posix_File->handle(), data, maxSize);
+    if (retVal==-1) {
+        if (errno==EAGAIN || errno==EINTR)
+            return 0;
+        lastErr=E_READ_FAILED;
+    }
+    return retVal;
+}
+
+/*!
+\fn int Posix_QextSerialPort::handle() const
+Returns the file descriptor of the open tty, or -1 if the port is not open.  Intended for
+callers that wait on the port with poll()/select() from their own thread.
+*/
+int Posix_QextSerialPort::handle() const
+{
+    return Posix_File->handle();
+}
+
 /*!
 \fn void Posix_QextSerialPort::ungetChar(char)
 This function is included to implement the full QIODevice interface, and currently has no
@@ -1097,8 +1143,11 @@ is currently open (use isOpen() function to check if port is open).
 qint64 Posix_QextSerialPort::readData(char * data, qint64 maxSize)
 {
     LOCK_MUTEX();
-    int retVal=0;
-    retVal=Posix_File->read(data, maxSize);
+    int retVal=::read(Posix_File->handle(), data, maxSize);
+    if (retVal==-1 && errno==EAGAIN) {
+        /*nothing queued yet - this is the blocking path, so wait up to the port timeout*/
+        retVal=waitForFile(false) ? ::read(Posix_File->handle(), data, maxSize) : 0;
+    }
     if (retVal==-1)
         lastErr=E_READ_FAILED;
     UNLOCK_MUTEX();
@@ -1118,11 +1167,39 @@ is currently open (use isOpen() function to check if port is open).
 qint64 Posix_QextSerialPort::writeData(const char * data, qint64 maxSize)
 {
     LOCK_MUTEX();
-    int retVal=0;
-    retVal=Posix_File->write(data, maxSize);
+    qint64 written=0;
+    while (written<maxSize) {
+        int n=::write(Posix_File->handle(), data+written, maxSize-written);
+        if (n>0) {
+            written+=n;
+            continue;
+        }
+        if (n==-1 && (errno==EAGAIN || errno==EINTR) && waitForFile(true))
+            continue;
+        break;
+    }
+    int retVal=(written>0 || maxSize==0) ? (int)written : -1;
     if (retVal==-1)
        lastErr=E_WRITE_FAILED;
     UNLOCK_MUTEX();
     
     return retVal;
 }
+
+/*!
+\fn bool Posix_QextSerialPort::waitForFile(bool forWrite)
+Waits up to the port timeout for the descriptor to become readable (or writable when forWrite is
+true).  Used internally by the blocking readData()/writeData() paths.
+*/
+bool Posix_QextSerialPort::waitForFile(bool forWrite)
+{
+    fd_set fileSet;
+    FD_ZERO(&fileSet);
+    FD_SET(Posix_File->handle(), &fileSet);
+    Posix_Timeout = Posix_Copy_Timeout;
+    int n=select(Posix_File->handle()+1, forWrite ? NULL : &fileSet, forWrite ? &fileSet : NULL,
+                 NULL, &Posix_Timeout);
+    if (n==0)
+        lastErr=E_PORT_TIMEOUT;
+    return n>0;
+}
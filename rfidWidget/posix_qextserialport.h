@@ -8,8 +8,11 @@
 #include <sys/time.h>
 #include <sys/ioctl.h>
 #include <sys/select.h>
+#include <fcntl.h>
 #include "qextserialbase.h"
 
+class QSocketNotifier;
+
 class Posix_QextSerialPort:public QextSerialBase 
 {
 	private:
@@ -20,12 +23,14 @@ class Posix_QextSerialPort:public QextSerialBase
 
 	protected:
 	    QFile* Posix_File;
+	    QSocketNotifier* readNotifier;
 	    struct termios Posix_CommConfig;
 	    struct timeval Posix_Timeout;
 	    struct timeval Posix_Copy_Timeout;
 	
 	    virtual qint64 readData(char * data, qint64 maxSize);
 	    virtual qint64 writeData(const char * data, qint64 maxSize);
+	    bool waitForFile(bool forWrite);
 
 	public:
 	    Posix_QextSerialPort();
@@ -49,6 +54,8 @@ class Posix_QextSerialPort:public QextSerialBase
 	
 	    virtual qint64 size() const;
 	    virtual qint64 bytesAvailable();
+	    qint64 readAvailable(char * data, qint64 maxSize);
+	    int handle() const;
 	
 	    virtual void ungetChar(char c);
 	
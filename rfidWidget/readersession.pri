@@ -0,0 +1,48 @@
+#-------------------------------------------------
+#
+# 读卡器会话：串口收发、拆帧、命令调度、寻卡链与读写块、多通道与停车记录，只依赖 QtCore
+# 界面程序、无界面程序和静态库 readersession 共用这份源文件列表
+#
+#-------------------------------------------------
+
+INCLUDEPATH += $$PWD/..
+
+SOURCES += $$PWD/IEEE1443Package.cpp \
+    $$PWD/qextserialbase.cpp \
+    $$PWD/posix_qextserialport.cpp \
+    $$PWD/FrameTrace.cpp \
+    $$PWD/ReaderIoThread.cpp \
+    $$PWD/FrameDecoder.cpp \
+    $$PWD/EscapeKernel.cpp \
+    $$PWD/PrebuiltFrame.cpp \
+    $$PWD/LaneMetrics.cpp \
+    $$PWD/CommandScheduler.cpp \
+    $$PWD/ReaderSession.cpp \
+    $$PWD/TagInfo.cpp \
+    $$PWD/CardTable.cpp \
+    $$PWD/ParkingStore.cpp \
+    $$PWD/ParkingJournal.cpp \
+    $$PWD/LanePool.cpp \
+    $$PWD/TagCache.cpp \
+    $$PWD/Tariff.cpp
+
+HEADERS += $$PWD/IEEE1443Package.h \
+    $$PWD/qextserialbase.h \
+    $$PWD/posix_qextserialport.h \
+    $$PWD/SpscRing.h \
+    $$PWD/FrameTrace.h \
+    $$PWD/ReaderIoThread.h \
+    $$PWD/FrameDecoder.h \
+    $$PWD/EscapeKernel.h \
+    $$PWD/PrebuiltFrame.h \
+    $$PWD/LaneMetrics.h \
+    $$PWD/CommandScheduler.h \
+    $$PWD/ReaderSession.h \
+    $$PWD/TagInfo.h \
+    $$PWD/CardUid.h \
+    $$PWD/CardTable.h \
+    $$PWD/ParkingStore.h \
+    $$PWD/ParkingJournal.h \
+    $$PWD/LanePool.h \
+    $$PWD/TagCache.h \
+    $$PWD/Tariff.h
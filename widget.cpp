@@ -1,16 +1,49 @@
 #include "widget.h"
 #include "ui_widget.h"
 #include <rfidWidget/IEEE14443ControlWidget.h>
+#include <rfidWidget/ParkingStore.h>
+#include <rfidWidget/ParkingJournal.h>
 #include <QVBoxLayout>
+#include <QTabWidget>
 
-Widget::Widget(QWidget *parent) :
+Widget::Widget(const QStringList &ports, QWidget *parent) :
     QWidget(parent),
     ui(new Ui::Widget)
 {
     ui->setupUi(this);
     QVBoxLayout *layout = new QVBoxLayout(this);
     layout->setContentsMargins(0, 0, 0, 0);
-    layout->addWidget(new IEEE14443ControlWidget(this));
+    //各通道共用一份停车记录：入口通道进场、出口通道出场
+    //重放预写日志，恢复重启前在场的车辆
+    ParkingStore *store = new ParkingStore(this);
+    QString journalPath = ParkingJournal::configuredPath();
+    bool journalOk = store->openJournal(journalPath) >= 0;
+    if(ports.size() <= 1)
+    {
+        IEEE14443ControlWidget *lane = new IEEE14443ControlWidget(ports.value(0, "/dev/ttyS0"), store, this);
+        lanes.append(lane);
+        layout->addWidget(lane);
+    }
+    else
+    {
+        //多通道：每个串口一页
+        QTabWidget *tabs = new QTabWidget(this);
+        for(int i = 0; i < ports.size(); i++)
+        {
+            IEEE14443ControlWidget *lane = new IEEE14443ControlWidget(ports.at(i), store, tabs);
+            lanes.append(lane);
+            tabs->addTab(lane, ports.at(i));
+        }
+        layout->addWidget(tabs);
+    }
+    //日志打不开时照常运行，但重启后在场车辆会丢失，每条通道都提示
+    if(!journalOk)
+    {
+        qWarning("journal %s unavailable, parking records will not survive a restart",
+                 journalPath.toLocal8Bit().constData());
+        for(int i = 0; i < lanes.size(); i++)
+            lanes.at(i)->postWarning(tr("停车记录"), tr("无法打开日志 %1，重启后在场记录会丢失").arg(journalPath));
+    }
     setLayout(layout);
 }
 
@@ -18,3 +51,17 @@ Widget::~Widget()
 {
     delete ui;
 }
+
+// 功能：显示事件：打开所有通道，不在当前页的通道也要读卡。
+void Widget::showEvent(QShowEvent *)
+{
+    for(int i = 0; i < lanes.size(); i++)
+        lanes.at(i)->startReader();
+}
+
+// 功能：隐藏事件：关闭所有通道（不在当前页的通道收不到自己的隐藏事件）。
+void Widget::hideEvent(QHideEvent *)
+{
+    for(int i = 0; i < lanes.size(); i++)
+        lanes.at(i)->stop();
+}
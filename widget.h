@@ -2,21 +2,30 @@
 #define WIDGET_H
 
 #include <QWidget>
+#include <QStringList>
+#include <QList>
 
 namespace Ui {
     class Widget;
 }
 
+class IEEE14443ControlWidget;
+
 class Widget : public QWidget
 {
     Q_OBJECT
 
 public:
-    explicit Widget(QWidget *parent = 0);
+    explicit Widget(const QStringList &ports = QStringList("/dev/ttyS0"), QWidget *parent = 0);
     ~Widget();
 
+protected:
+    void showEvent(QShowEvent *);
+    void hideEvent(QHideEvent *);
+
 private:
     Ui::Widget *ui;
+    QList<IEEE14443ControlWidget *> lanes;//每个串口一条通道
 };
 
 #endif // WIDGET_H